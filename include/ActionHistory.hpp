@@ -0,0 +1,137 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef ACTIONHISTORY_HPP
+#define ACTIONHISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+#include "Role.hpp"
+
+class Player;
+
+struct ActionRecord {
+    ActionType action;
+    Player* actor;
+    Player* target;
+    bool was_blocked;
+    Player* blocker;                     // Who blocked the action, nullptr if unknown or not blocked
+    int turn;                            // Turn the action was taken on, modulo 65536
+
+    ActionRecord(ActionType a, Player* act, Player* targ)
+        : action(a), actor(act), target(targ), was_blocked(false), blocker(nullptr), turn(0) {}
+};
+
+// How a game stores an action: 32 bits with players as seats.
+// Bits 0-2 action, 3 blocked, 4-7 actor seat + 1, 8-11 target seat + 1, 12-15 blocker seat + 1,
+// 16-31 turn.
+struct PackedAction {
+    uint32_t bits;
+
+    static PackedAction make(ActionType action, int actor, int target, int turn) {
+        return PackedAction{static_cast<uint32_t>(action) | (static_cast<uint32_t>(actor + 1) << 4) |
+                            (static_cast<uint32_t>(target + 1) << 8) | (static_cast<uint32_t>(turn & 0xffff) << 16)};
+    }
+
+    ActionType action() const { return static_cast<ActionType>(bits & 7); }
+    bool blocked() const { return (bits >> 3) & 1; }
+    int actor() const { return static_cast<int>((bits >> 4) & 15) - 1; }
+    int target() const { return static_cast<int>((bits >> 8) & 15) - 1; }
+    int blocker() const { return static_cast<int>((bits >> 12) & 15) - 1; }
+    int turn() const { return static_cast<int>(bits >> 16); }
+
+    void set_blocked(int blocker_seat) { bits = (bits & ~0xf008u) | 8u | (static_cast<uint32_t>(blocker_seat + 1) << 12); }
+    // False for bits no record can have
+    bool is_valid(int player_count) const {
+        return (bits & 7) < ACTION_TYPE_COUNT && actor() < player_count && target() < player_count &&
+               blocker() < player_count;
+    }
+};
+
+// A game's action records. Unbounded by default; with a limit it keeps only the newest
+// records in a ring, so its memory stays fixed however long the game runs. Records are
+// indexed by their position in the whole game: size() counts every record ever added and
+// the retained ones are [first_index(), size()). Each actor's latest action of every type is
+// indexed, so "whom did seat 2 last arrest" needs no scan.
+class ActionHistory {
+private:
+    std::vector<PackedAction> records;
+    size_t limit;                        // 0 = unbounded
+    size_t head;                         // Slot of the oldest retained record
+    size_t total;
+    Player* seats[MAX_PLAYERS];          // Decodes seats back into players
+    uint64_t latest[MAX_PLAYERS][ACTION_TYPE_COUNT]; // Index + 1 of each actor's latest action, 0 = none
+
+    size_t slot(size_t index) const { return (head + index - first_index()) % records.size(); }
+    ActionRecord decode(PackedAction packed) const;
+    void index_record(size_t index, PackedAction packed);
+
+public:
+    class const_iterator {
+    private:
+        const ActionHistory* history;
+        size_t index;
+
+    public:
+        const_iterator(const ActionHistory* h, size_t i) : history(h), index(i) {}
+        ActionRecord operator*() const { return (*history)[index]; }
+        const_iterator& operator++() { ++index; return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    };
+
+    ActionHistory();
+
+    // Seats the records refer to; set whenever the game's players change
+    void set_seats(const std::vector<Player*>& players);
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    size_t first_index() const { return total - records.size(); }
+    size_t retained() const { return records.size(); }
+    size_t get_limit() const { return limit; }
+    bool is_full() const { return limit > 0 && records.size() == limit; }
+
+    // index must be a retained record
+    PackedAction packed(size_t index) const { return records[slot(index)]; }
+    ActionRecord operator[](size_t index) const { return decode(packed(index)); }
+    ActionRecord back() const { return decode(packed(total - 1)); }
+    PackedAction packed_back() const { return packed(total - 1); }
+    PackedAction oldest() const { return records[head]; }
+
+    const_iterator begin() const { return const_iterator(this, first_index()); }
+    const_iterator end() const { return const_iterator(this, total); }
+
+    // Index of the actor's latest action of this type, -1 if it never took one
+    int64_t last_action_index(int actor_seat, ActionType action) const {
+        return static_cast<int64_t>(latest[actor_seat][static_cast<int>(action)]) - 1;
+    }
+    // Target of the actor's latest action of this type, -1 if none or no longer retained
+    int last_target(int actor_seat, ActionType action) const;
+
+    // When full, the oldest record is overwritten
+    void push_back(PackedAction record);
+    void mark_last_blocked(int blocker_seat);
+    void clear();
+    // Keeps the newest new_limit records (0 = unbounded); the others are dropped
+    void set_limit(size_t new_limit);
+    // Replaces the history with records numbered from first
+    void assign(size_t first, const std::vector<PackedAction>& all);
+};
+
+// A record read back from a history spill file, with players as seats (-1 = none)
+struct SpilledRecord {
+    ActionType action;
+    int actor;
+    int target;
+    bool was_blocked;
+    int blocker;
+    int turn;
+};
+
+// Reads every record a game spilled to path, oldest first
+std::vector<SpilledRecord> read_history_spill(const std::string& path);
+
+#endif // ACTIONHISTORY_HPP
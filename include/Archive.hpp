@@ -0,0 +1,188 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+#include "Rules.hpp"
+#include "Simulator.hpp"
+
+const uint16_t NEVER_SANCTIONED = 0xffff;
+
+// One finished game: its summary columns and the turns to replay it
+struct ArchivedGame {
+    uint8_t player_count;
+    int8_t roles[MAX_PLAYERS];           // -1 for seats beyond player_count
+    int8_t winner;                       // -1 if the turn limit was hit
+    uint16_t turns;
+    uint16_t action_counts[ACTION_TYPE_COUNT];
+    int16_t final_coins[MAX_PLAYERS];
+    uint16_t first_sanctioned[MAX_PLAYERS]; // Turn a seat was first sanctioned on
+    std::vector<RecordedTurn> replay;
+    std::vector<uint16_t> checksums;     // Low 16 bits of the state checksum after each turn
+};
+
+// Plays a game between uniformly random players, as simulate_game does, and records it
+ArchivedGame play_archived_game(const GameRules& rules, const std::vector<RoleType>& roles, std::mt19937_64& rng,
+                                int max_turns = 1000);
+// Fills the summary columns of record from a game that has ended after the given turns
+void summarize_game(const Game& game, int turns, ArchivedGame& record);
+
+// Where a replayed game first disagrees with its archived record
+struct Divergence {
+    int turn;                            // Replay turn, or the turn count for a mismatched summary
+    std::string reason;
+};
+
+// Re-executes an archived game through Game and Player. Returns true if every recorded move
+// is among legal_moves when its turn comes (and every recorded skip still has no legal
+// move), every turn leaves the game with the recorded state checksum, and the game ends with
+// the archived winner, coins, action counts and sanction turns; otherwise fills divergence.
+bool revalidate_game(const GameRules& rules, const ArchivedGame& record, Divergence& divergence);
+
+// Conditions on a game; all must hold
+struct GameFilter {
+    uint8_t players = 0;                 // Exact player count, 0 = any
+    uint16_t min_turns = 0;
+    uint16_t max_turns = 0xffff;
+    int8_t with_role = -1;               // Some seat has this role, -1 = any
+    int8_t action = -1;                  // At least min_action_count actions of this type, -1 = any
+    uint16_t min_action_count = 0;
+    int16_t min_final_coins = INT16_MIN; // Some seated player finished with coins in this range
+    int16_t max_final_coins = INT16_MAX;
+};
+
+// Index of one archive block, stored ahead of its columns so readers can skip the block
+// without touching them. The key set (six roles, six action types) is small enough that the
+// membership filter is exact: one bit per key, so it never reports a false positive.
+struct BlockSummary {
+    uint64_t present;                    // Bit r: a game has role r; bit 8 + a: a game took action a
+    uint16_t min_turns;
+    uint16_t max_turns;
+    int16_t min_coins;                   // Final coins over every seated player
+    int16_t max_coins;
+
+    // False only if no game of the block can match the filter
+    bool may_match(const GameFilter& filter) const;
+};
+
+struct RoleStats {
+    uint64_t seats = 0;                  // Seats that held the role
+    uint64_t wins = 0;
+
+    double win_rate() const { return seats ? static_cast<double>(wins) / seats : 0.0; }
+};
+
+// Finished games stored column by column. Columns are padded to whole blocks of BLOCK rows
+// and every query scans them a block at a time with fixed-length loops, which compilers turn
+// into SIMD code; no row is ever materialized.
+class GameColumns {
+public:
+    static const size_t BLOCK = 64;
+
+private:
+    size_t rows;
+    std::vector<uint8_t> player_count;   // 0 in padding rows
+    std::vector<int8_t> roles[MAX_PLAYERS];
+    std::vector<int8_t> winner;
+    std::vector<uint16_t> turns;
+    std::vector<uint16_t> action_counts[ACTION_TYPE_COUNT];
+    std::vector<int16_t> final_coins[MAX_PLAYERS];
+    std::vector<uint16_t> first_sanctioned[MAX_PLAYERS];
+
+    static size_t row_bytes();
+    void reserve_rows(size_t count);
+    void select(const GameFilter& filter, size_t start, uint8_t keep[BLOCK]) const;
+
+    // Visits every column in file order
+    template <typename Visitor>
+    void for_each_column(Visitor&& visit) {
+        visit(player_count);
+        for (auto& column : roles) visit(column);
+        visit(winner);
+        visit(turns);
+        for (auto& column : action_counts) visit(column);
+        for (auto& column : final_coins) visit(column);
+        for (auto& column : first_sanctioned) visit(column);
+    }
+
+    friend class ArchiveWriter;
+    friend class ArchiveReader;
+
+public:
+    GameColumns() : rows(0) {}
+
+    void append(const ArchivedGame& game);
+    size_t size() const { return rows; }
+    void clear();
+
+    uint64_t count(const GameFilter& filter) const;
+    double mean_turns(const GameFilter& filter) const;
+    // Seats holding the role in matching games and how many of them won; with
+    // sanctioned_before, only seats first sanctioned before that turn
+    RoleStats role_stats(RoleType role, const GameFilter& filter = GameFilter(),
+                         uint16_t sanctioned_before = NEVER_SANCTIONED) const;
+};
+
+// Replay archive file: a header with the rules, then blocks of up to block_games games.
+// A block stores its BlockSummary, each summary column for its games in turn, then the
+// games' replays and their per-turn checksums. The summaries only prune well when similar games share blocks, e.g. an
+// archive written one table configuration at a time.
+class ArchiveWriter {
+private:
+    std::FILE* file;
+    size_t block_games;
+    std::vector<ArchivedGame> pending;
+
+    void write_block();
+
+public:
+    ArchiveWriter(const std::string& path, const GameRules& rules, size_t games_per_block = 4096);
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    void add(const ArchivedGame& game);
+    // Writes the last block; throws std::runtime_error if any write failed
+    void close();
+};
+
+// Read-only, memory-mapped replay archive
+class ArchiveReader {
+private:
+    void* mapping;
+    size_t mapping_size;
+    GameRules rules;
+    std::vector<size_t> blocks;          // Offset of each block
+    size_t games;
+
+    const uint8_t* block_data(size_t block, uint32_t& count) const;
+    void append_block(size_t block, GameColumns& columns) const;
+
+public:
+    explicit ArchiveReader(const std::string& path);
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    const GameRules& get_rules() const { return rules; }
+    size_t block_count() const { return blocks.size(); }
+    size_t game_count() const { return games; }
+
+    BlockSummary summary(size_t block) const;
+
+    // Decodes every game of a block, replays included
+    void read_block(size_t block, std::vector<ArchivedGame>& out) const;
+    // Appends the summary columns of every block that may hold games matching the filter,
+    // without decoding replays, and returns how many blocks were loaded. Queries with the same
+    // filter then give the same answers as over the whole archive.
+    size_t load_columns(GameColumns& columns, const GameFilter& filter = GameFilter()) const;
+};
+
+#endif // ARCHIVE_HPP
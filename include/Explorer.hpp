@@ -0,0 +1,194 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef EXPLORER_HPP
+#define EXPLORER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Game.hpp"
+#include "GameState.hpp"
+#include "Role.hpp"
+#include "Rules.hpp"
+
+// Packs a game state into 64 bits for exhaustive exploration.
+// Each seat takes 10 bits (coins:5, active:1, sanctioned:1, last arrested seat:3), followed
+// by the current seat (3 bits) and the extra-turn flag. Roles are fixed for one exploration
+// and the treasury never influences play, so neither is part of the key. Eliminated players
+// are cleared so states that only differ in dead seats share one key.
+class StateCodec {
+private:
+    std::vector<RoleType> roles;
+
+public:
+    static const int MAX_COINS = 31;
+
+    explicit StateCodec(const std::vector<RoleType>& seat_roles);
+
+    // Returns false if a player holds more coins than the key can store
+    bool encode(const GameState& state, uint64_t& key) const;
+    GameState decode(uint64_t key) const;
+    size_t player_count() const { return roles.size(); }
+};
+
+// Lock-free open-addressing hash set of non-zero 64-bit keys with a fixed capacity.
+// Insertion claims an empty slot with a single compare-and-swap.
+class ConcurrentStateSet {
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    size_t mask;
+    std::atomic<size_t> count;
+
+public:
+    explicit ConcurrentStateSet(size_t min_capacity);
+
+    bool insert(uint64_t key);           // True if the key was new, throws when the set is full
+    bool contains(uint64_t key) const { return find(key) != capacity(); }
+    // Slot holding the key, capacity() if absent. Keys never move, so slots can index
+    // per-state arrays once insertion is over.
+    size_t find(uint64_t key) const;
+    uint64_t key_at(size_t slot) const { return slots[slot].load(std::memory_order_relaxed); }
+    size_t size() const { return count.load(); }
+    size_t capacity() const { return mask + 1; }
+};
+
+// Counters gathered while expanding states
+struct ExpansionCounters {
+    uint64_t transitions = 0;
+    uint64_t terminal = 0;               // States where the game is over
+    uint64_t coin_overflows = 0;         // Successors dropped because coins do not fit the key
+    uint64_t rejected_moves = 0;         // Legal moves the players refused, e.g. a payment they cannot make
+    int max_coins = 0;
+
+    void merge(const ExpansionCounters& other);
+};
+
+// Generates successor states with the real Player/Game rules on a private scratch game
+class StateExpander {
+private:
+    StateCodec codec;
+    Game game;
+
+    void record(std::vector<uint64_t>& successors, ExpansionCounters& counters);
+
+public:
+    StateExpander(const std::vector<RoleType>& roles, const GameRules& rules);
+
+    uint64_t initial_key() const;
+    // Appends the state after each legal move, once with the action standing and once per
+    // player who could block it
+    void expand(uint64_t key, std::vector<uint64_t>& successors, ExpansionCounters& counters);
+    const StateCodec& get_codec() const { return codec; }
+};
+
+// Sorted run of unique state keys on disk, stored as varint-encoded deltas.
+// Runs are only ever written and read front to back.
+class RunWriter {
+private:
+    std::FILE* file;
+    std::vector<uint8_t> buffer;
+    uint64_t previous;
+    uint64_t count;
+
+    void flush();
+
+public:
+    explicit RunWriter(const std::string& path);
+    ~RunWriter();
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    void write(uint64_t key);            // Keys must be written in increasing order
+    void close();                        // Throws if any write failed; the file is closed either way
+    uint64_t size() const { return count; }
+};
+
+class RunReader {
+private:
+    std::FILE* file;
+    std::vector<uint8_t> buffer;
+    size_t position;
+    size_t length;
+    uint64_t previous;
+
+    bool refill();
+
+public:
+    explicit RunReader(const std::string& path);
+    ~RunReader();
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    bool next(uint64_t& key);            // False at the end of the run
+};
+
+struct ExplorerOptions {
+    std::vector<RoleType> roles;         // Role of each seat (2-6 seats)
+    GameRules rules;
+    int threads = 0;                     // 0 uses every core
+    size_t max_states = size_t(1) << 22; // Capacity of the visited set
+    int max_levels = -1;                 // Stop after this many BFS levels, -1 for no limit
+    bool check_cycles = true;            // Look for cycles after a complete in-memory run
+
+    // Disk-backed exploration
+    std::string disk_directory;          // Where level and run files are kept
+    size_t run_buffer_states = size_t(1) << 23; // Successors buffered in memory before a run is written
+};
+
+struct LevelStats {
+    int level;
+    uint64_t frontier;                   // States expanded at this level
+    uint64_t transitions;
+    uint64_t new_states;                 // States first reached from this level
+    uint64_t revisits;                   // Transitions into already visited states
+    uint64_t terminal;
+    double seconds;
+};
+
+struct ExplorerReport {
+    std::vector<LevelStats> levels;
+    uint64_t states = 0;
+    ExpansionCounters counters;
+    uint64_t revisits = 0;
+    bool complete = false;               // True if every reachable state was visited
+    bool cycles_checked = false;
+    uint64_t cyclic_states = 0;          // States on a cycle or reachable from one; 0 means every game ends
+};
+
+// Parallel breadth-first exploration of all states reachable from the start of a game.
+// After a complete run the state graph is peeled from its sources (Kahn's algorithm, with a
+// 4-byte in-degree per visited-set slot); states that never peel off lie on a cycle or behind
+// one, so some sequence of legal moves from them never ends the game.
+class StateExplorer {
+private:
+    ExplorerOptions options;
+
+    uint64_t count_cyclic_states(const ConcurrentStateSet& visited,
+                                 std::vector<std::unique_ptr<StateExpander>>& expanders);
+
+public:
+    explicit StateExplorer(const ExplorerOptions& explorer_options);
+
+    ExplorerReport run(const std::function<void(const LevelStats&)>& on_level = nullptr);
+};
+
+// Breadth-first exploration that keeps the visited set on disk.
+// Successors of a level are sorted in memory-sized runs, merged, and deduplicated by one
+// streaming pass against the sorted visited file, so all I/O is sequential.
+class DiskStateExplorer {
+private:
+    ExplorerOptions options;
+
+    std::string path(const std::string& name, int level, int run = -1) const;
+
+public:
+    explicit DiskStateExplorer(const ExplorerOptions& explorer_options);
+
+    ExplorerReport run(const std::function<void(const LevelStats&)>& on_level = nullptr);
+};
+
+#endif // EXPLORER_HPP
@@ -0,0 +1,152 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef FULLRULES_HPP
+#define FULLRULES_HPP
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "GameState.hpp"
+#include "Role.hpp"
+#include "Rules.hpp"
+#include "Simulator.hpp"
+
+// Multiset of role cards packed into one word, 5 bits of count per role.
+// Drawing picks a uniformly random card in constant time (six counts are scanned).
+class CourtDeck {
+private:
+    uint32_t counts;
+
+public:
+    static const int COUNT_BITS = 5;
+    static const int MAX_COPIES = 31;
+
+    CourtDeck() : counts(0) {}
+    static CourtDeck standard(int copies);
+
+    int count(RoleType role) const {
+        return (counts >> (static_cast<int>(role) * COUNT_BITS)) & MAX_COPIES;
+    }
+    int size() const;
+    void add(RoleType role);
+    void remove(RoleType role);
+    RoleType draw(std::mt19937_64& rng);
+    uint32_t packed() const { return counts; }
+};
+
+// Moves of the full ruleset. Actions tied to a role are claims: anyone may play them and
+// anyone may challenge them.
+//   TAX          2 coins, blockable by a claimed Governor
+//   GOVERNOR_TAX claim Governor, 3 coins
+//   INVEST       claim Baron, pay 3 and get 6
+//   EXCHANGE     claim Spy, draw two court cards and return two
+//   ARREST       take a coin, blockable by the target claiming Spy or Merchant
+//   BRIBE        extra turn, blockable by a claimed Judge
+//   SANCTION     no gather or tax on the target's next turn
+//   COUP         target loses an influence, blockable by the target claiming General (paying 5)
+enum class FullAction {
+    GATHER,
+    TAX,
+    GOVERNOR_TAX,
+    INVEST,
+    EXCHANGE,
+    ARREST,
+    BRIBE,
+    SANCTION,
+    COUP
+};
+
+struct FullMove {
+    FullAction action;
+    int target;                          // Seat index of the target, -1 if the move has none
+
+    FullMove(FullAction a, int targ = -1) : action(a), target(targ) {}
+
+    bool operator==(const FullMove& other) const { return action == other.action && target == other.target; }
+};
+
+// One seat: two influence cards held inline, bit i of lost set once card i is revealed
+struct FullPlayer {
+    int32_t coins;
+    RoleType cards[2];
+    uint8_t lost;
+    int8_t last_arrested;
+    bool sanctioned;
+
+    bool is_alive() const { return lost != 3; }
+    int influence() const { return 2 - ((lost & 1) + (lost >> 1)); }
+    bool holds(RoleType role) const {
+        return (!(lost & 1) && cards[0] == role) || (!(lost & 2) && cards[1] == role);
+    }
+};
+
+class FullRulesGame;
+
+// Decisions taken outside the mover's own choice of move
+class FullPolicy {
+public:
+    virtual ~FullPolicy() = default;
+
+    virtual bool challenge(const FullRulesGame& game, int challenger, int claimant, RoleType claim) = 0;
+    virtual bool block(const FullRulesGame& game, int blocker, const FullMove& move, int actor, RoleType claim) = 0;
+    virtual int lose_influence(const FullRulesGame& game, int seat) = 0; // Card slot (0 or 1) to reveal
+    // Reorders cards so the first keep of them are kept; the rest go back to the deck
+    virtual void exchange(const FullRulesGame& game, int seat, RoleType* cards, int count, int keep) = 0;
+};
+
+// Challenges and blocks with fixed probabilities, everything else uniformly at random
+class RandomFullPolicy : public FullPolicy {
+private:
+    std::mt19937_64& rng;
+    double challenge_rate;
+    double block_rate;
+
+public:
+    RandomFullPolicy(std::mt19937_64& random, double challenge_probability = 0.1, double block_probability = 0.25);
+
+    bool challenge(const FullRulesGame& game, int challenger, int claimant, RoleType claim) override;
+    bool block(const FullRulesGame& game, int blocker, const FullMove& move, int actor, RoleType claim) override;
+    int lose_influence(const FullRulesGame& game, int seat) override;
+    void exchange(const FullRulesGame& game, int seat, RoleType* cards, int count, int keep) override;
+};
+
+// The full ruleset: two hidden influence cards per player dealt from a court deck, claims
+// and challenges, blocks, exchange, and elimination once both cards are lost.
+// The whole game is a fixed-size value, so copying it or playing it allocates nothing.
+// Coins come from an unlimited bank; the treasury of the simple mode is not modelled.
+class FullRulesGame {
+private:
+    GameRules rules;
+    CourtDeck deck;
+    FullPlayer players[MAX_PLAYERS];
+    uint8_t player_count;
+    uint8_t current_player;
+    bool extra_turn;
+
+    bool resolve_claim(int claimant, RoleType claim, FullPolicy& policy, std::mt19937_64& rng);
+    bool resolve_block(const FullMove& move, FullPolicy& policy, std::mt19937_64& rng);
+    void exchange(int seat, FullPolicy& policy, std::mt19937_64& rng);
+    void advance_turn();
+
+public:
+    FullRulesGame(const GameRules& game_rules, int seats, std::mt19937_64& rng, int copies_per_role = 3);
+
+    void legal_moves(std::vector<FullMove>& moves) const;
+    // Plays a move for the current player, with challenges and blocks decided by the policy
+    void play(const FullMove& move, FullPolicy& policy, std::mt19937_64& rng);
+    void lose_influence(int seat, FullPolicy& policy);
+
+    int get_player_count() const { return player_count; }
+    int get_current_player_index() const { return current_player; }
+    const FullPlayer& get_player(int seat) const { return players[seat]; }
+    const CourtDeck& get_deck() const { return deck; }
+    const GameRules& get_rules() const { return rules; }
+    int alive_count() const;
+    bool is_over() const { return alive_count() <= 1; }
+    int winner() const;                  // Seat of the last player alive, -1 if the game is not over
+};
+
+// Plays one full-rules game between random players
+SimulationResult simulate_full_game(const GameRules& rules, int seats, std::mt19937_64& rng, int max_turns = 1000);
+
+#endif // FULLRULES_HPP
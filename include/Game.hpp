@@ -3,23 +3,20 @@
 #ifndef GAME_HPP
 #define GAME_HPP
 
+#include <cstdint>
+#include <cstdio>
 #include <vector>
 #include <memory>
 #include <string>
+#include <functional>
+#include "ActionHistory.hpp"
+#include "PlayerStats.hpp"
 #include "Role.hpp"
+#include "Rules.hpp"
+#include "GameState.hpp"
 
 class Player;
 
-struct ActionRecord {
-    ActionType action;
-    Player* actor;
-    Player* target;
-    bool was_blocked;
-    
-    ActionRecord(ActionType a, Player* act, Player* targ) 
-        : action(a), actor(act), target(targ), was_blocked(false) {}
-};
-
 class Game {
 private:
     std::vector<std::shared_ptr<Player>> players;
@@ -27,10 +24,38 @@ private:
     int treasury_coins;
     bool game_active;
     bool extra_turn_allowed;
-    std::vector<ActionRecord> action_history;
+    int turn_number;                     // next_turn calls so far, stamped on action records
+    ActionHistory action_history;
+    PlayerStats player_stats[MAX_PLAYERS];
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> history_spill; // Receives records the ring drops
+    GameRules rules;
+    bool roles_hidden;
+    bool coins_hidden;
+    uint8_t coin_reveals[MAX_PLAYERS];   // Bit t of entry o: seat o may see seat t's coins
+    uint64_t history_prefix_hash;        // Hash of every history record except the last
+    uint64_t table_checksum;             // Parts of state_checksum(capture_state()) as of the last event
+    uint64_t seat_checksums[MAX_PLAYERS];
+    uint64_t state_checksum;             // XOR of the parts above
+    uint8_t blocker_index[ACTION_TYPE_COUNT]; // Per action type, bit s set if seat s's role can block it
+    int last_actor_seat;
+    int last_target_seat;
+    GameState undo_state;                // State before the last action a block can undo
+    bool undo_available;
+    
+    void spill_record(PackedAction record);
+    PlayerState player_state(size_t seat) const;
+    void refresh_table_checksum();
+    void refresh_seat_checksum(int seat);
+    void refresh_state_checksum();
+    void split_blocker_mask(uint8_t parts[2]) const;
+    Player* pop_eligible_blocker(uint8_t parts[2]) const;
     
 public:
     Game();
+    explicit Game(const GameRules& game_rules);
+    ~Game();
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
     
     void add_player(std::shared_ptr<Player> player);
     void start_game();
@@ -46,24 +71,91 @@ public:
     int get_treasury_coins() const { return treasury_coins; }
     
     // Turn management
+    int get_turn_number() const { return turn_number; }
     void allow_extra_turn() { extra_turn_allowed = true; }
     bool is_extra_turn_allowed() const { return extra_turn_allowed; }
     void reset_extra_turn() { extra_turn_allowed = false; }
     
     // Action history
-    void add_action_to_history(ActionType action, Player* actor, Player* target);
+    // target_led: the target was the actor's richest opponent before the action moved any
+    // coins (see is_richest_opponent), for the actor's PlayerStats
+    void add_action_to_history(ActionType action, Player* actor, Player* target, bool target_led = false);
+    // True if no other active opponent of the actor has more coins than the target
+    bool is_richest_opponent(const Player* actor, const Player* target) const;
     bool can_block_last_action(Player* blocker);
-    void block_last_action();
+    void block_last_action(Player* blocker = nullptr);
+    const ActionHistory& get_action_history() const { return action_history; }
+    // Tendencies of a seat, maintained as actions and blocks are recorded; saved with the
+    // game and reset with the history
+    const PlayerStats& get_player_stats(size_t seat) const { return player_stats[seat]; }
+    void clear_action_history();
+    // Keeps only the newest limit records in memory (0 = all). With a spill path, older
+    // records are appended to that file as they drop out; without one they are discarded and
+    // a previous spill file is closed. read_history_spill reads a closed spill back.
+    void set_history_limit(size_t limit, const std::string& spill_path = "");
+    
+    // Reaction window: after an action, every player able to block it is offered the block
+    // in seat order starting after the actor. The first to accept blocks the action and its
+    // effect is undone. Arrests and coups can only be blocked by their target, and nothing
+    // can be blocked once next_turn has been called.
+    // A seat's blockers are indexed by action type. Player::set_role calls role_changed, so a
+    // role changed mid-game is picked up at once (a player shared between games only
+    // notifies the game it was seated in last).
+    void refresh_blocker_index();
+    void role_changed(Player* player);
+    void save_undo_point();              // Called by actions before applying an undoable effect
+    uint8_t eligible_blocker_mask() const;
+    std::vector<Player*> eligible_blockers() const;
+    Player* run_reaction_window(const std::function<bool(Player& blocker, const ActionRecord& action)>& wants_to_block);
+    void resolve_block(Player* blocker);
+    
+    uint64_t get_public_history_hash() const;
+    
+    // Lockstep checksum: state_checksum(capture_state()) as of the last start, action, block,
+    // elimination, turn advance or restore. Two copies of a game that agree on it agree on
+    // everything that decides how the game continues. Each event only rehashes what it can
+    // change: an action its actor, its target and the table; a turn advance the table, the
+    // seats whose sanctions it lifts and the new current player (e.g. a Merchant's bonus);
+    // an investment the Baron.
+    // Changes made straight through Player setters show up once their seat is rehashed.
+    uint64_t get_state_checksum() const { return state_checksum; }
+    
+    // Hidden information
+    void set_hidden_information(bool hide_roles, bool hide_coins);
+    bool are_roles_hidden() const { return roles_hidden; }
+    bool are_coins_hidden() const { return coins_hidden; }
+    void reveal_coins(Player* observer, Player* target);
+    bool are_coins_revealed(int observer_seat, int target_seat) const;
     
     // Player management
     std::shared_ptr<Player> get_current_player();
     void eliminate_player(Player* player);
+    // A Baron's investment. Throws std::runtime_error if the player is not a seated Baron or
+    // cannot pay for it.
+    void invest(Player* baron);
     void check_forced_coup();
     void clear_sanctions();
     
+    // Compact state snapshot (players must already be seated to restore)
+    GameState capture_state() const;
+    void restore_state(const GameState& state);
+    
+    // Binary save of the whole game: rules, players, retained history, hidden information and the
+    // pending block's undo point. Player pointers are stored as seat indices. max_records
+    // keeps only the newest records of the history (at least 1 for a pending block to be
+    // undone); indices still count from the start of the game. load() replaces the players
+    // with new ones built from the save; it throws std::runtime_error on a corrupt save and
+    // leaves the game untouched.
+    void save(std::vector<uint8_t>& out, size_t max_records = SIZE_MAX) const;
+    void load(const uint8_t* data, size_t size);
+    
     // Getters
+    const GameRules& get_rules() const { return rules; }
     bool is_game_active() const { return game_active; }
     std::vector<std::shared_ptr<Player>> get_players() const { return players; }
+    size_t get_player_count() const { return players.size(); }
+    Player* get_player_at(size_t seat) const { return players[seat].get(); }
+    int get_current_player_index() const { return current_player_index; }
 };
 
 #endif // GAME_HPP
\ No newline at end of file
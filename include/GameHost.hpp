@@ -0,0 +1,154 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef GAMEHOST_HPP
+#define GAMEHOST_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Game.hpp"
+#include "Journal.hpp"
+#include "Simulator.hpp"
+#include "Snapshot.hpp"
+#include "Spectator.hpp"
+#include "Timeline.hpp"
+#include "TimerWheel.hpp"
+
+struct HostOptions {
+    uint64_t tick_ms = 10;               // Timer resolution
+    uint64_t turn_timeout_ms = 30000;    // A player who does not move in time gathers
+    uint64_t block_window_ms = 5000;     // How long blockers may react to an action
+    size_t keyframe_interval = 0;        // Turns between timeline keyframes, 0 = no timeline
+    size_t history_limit = 0;            // Action records each game keeps in memory, 0 = all
+};
+
+enum class HostEventType {
+    MOVE_PLAYED,
+    AUTO_MOVE,                           // Played for a player whose turn timed out
+    BLOCKED,
+    GAME_OVER
+};
+
+struct HostEvent {
+    HostEventType type;
+    uint64_t game_id;
+    int seat;                            // Mover, blocker, or winner
+    Move move;
+    uint64_t checksum;                   // The game's state checksum right after the event
+};
+
+struct HostStats {
+    uint64_t moves = 0;
+    uint64_t turn_timeouts = 0;
+    uint64_t windows_opened = 0;
+    uint64_t windows_expired = 0;
+    uint64_t blocks = 0;
+    uint64_t checkpoints = 0;
+};
+
+// Runs many games for a server. Every game is either waiting for its current player's move
+// or holding a reaction window open after a blockable action, and exactly one timer of a
+// shared timer wheel watches it. The event loop calls advance() with the current time;
+// timed-out turns are played as a gather (or the forced coup), and expired windows let the
+// action stand.
+class GameHost {
+private:
+    enum class Phase {
+        AWAITING_MOVE,
+        REACTION,
+        FINISHED
+    };
+
+    struct HostedGame {
+        Game game;
+        Phase phase;
+        Move pending;                    // Action whose reaction window is open
+        int blocker;                     // Seat that blocked pending, -1 if none
+        TimerWheel::TimerId timer;
+        std::unique_ptr<SpectatorFeed> feed; // Created by the first spectator
+        std::shared_ptr<SnapshotPublisher> snapshot; // Latest state, shared with readers on other threads
+        std::unique_ptr<GameTimeline> timeline; // Turns played since the game came to this host
+
+        explicit HostedGame(const GameRules& rules);
+    };
+
+    HostOptions options;
+    TimerWheel wheel;
+    std::vector<std::unique_ptr<HostedGame>> games;
+    std::vector<uint64_t> free_ids;
+    HostStats stats;
+    std::function<void(const HostEvent&)> listener;
+
+    std::unique_ptr<Journal> journal;
+    std::string journal_directory;
+    JournalOptions journal_options;
+    uint64_t journal_generation;
+    uint64_t records_since_checkpoint;
+
+    HostedGame& hosted(uint64_t id) const;
+    uint64_t ticks(uint64_t ms) const { return (ms + options.tick_ms - 1) / options.tick_ms; }
+    void emit(HostEventType type, uint64_t id, int seat, const Move& move);
+    void start_turn(uint64_t id);
+    void finish_move(uint64_t id);
+    void on_timer(uint64_t payload);
+    void publish(HostedGame& hosted_game);
+    uint64_t install(std::unique_ptr<HostedGame> hosted_game, uint64_t id);
+    void log(uint8_t type, const std::vector<uint8_t>& payload);
+    void replay(uint8_t type, const uint8_t* payload, size_t size);
+    void restore_game(const uint8_t* payload, size_t size);
+
+public:
+    explicit GameHost(const HostOptions& host_options = HostOptions(), uint64_t start_ms = 0);
+
+    uint64_t create_game(const std::vector<RoleType>& roles, const GameRules& rules = GameRules::defaults());
+    void remove_game(uint64_t id);
+    const Game& get_game(uint64_t id) const { return hosted(id).game; }
+    bool is_reaction_open(uint64_t id) const { return hosted(id).phase == Phase::REACTION; }
+
+    // Live migration between hosts: detach_game saves a game between turns (not while a
+    // reaction window is open) and removes it; adopt_game hosts a saved game under a new id
+    std::vector<uint8_t> detach_game(uint64_t id);
+    uint64_t adopt_game(const std::vector<uint8_t>& save);
+
+    // Both throw std::invalid_argument for a move or block that is not allowed right now
+    void submit_move(uint64_t id, int seat, const Move& move);
+    void submit_block(uint64_t id, int seat);
+
+    // Fires every timer due by now_ms; called from the event loop
+    void advance(uint64_t now_ms);
+
+    // The returned publisher may be read from any thread without locking; the host thread
+    // publishes to it after every state change. Readers share ownership, so it stays valid
+    // (holding the last published state) after the game is removed or detached.
+    std::shared_ptr<const SnapshotPublisher> get_snapshot(uint64_t id) const { return hosted(id).snapshot; }
+
+    // Support access to past turns, when keyframe_interval is set: rebuilds into out the game
+    // as it was after the given number of turns played on this host
+    size_t get_turn_count(uint64_t id) const;
+    void game_at_turn(uint64_t id, size_t turn, Game& out) const;
+
+    // Spectators get a keyframe, then one shared delta frame per state change
+    uint64_t watch(uint64_t id, const SpectatorFeed::Sender& send);
+    bool unwatch(uint64_t id, uint64_t subscription);
+
+    // Rebuilds the games saved in directory (the latest checkpoint, then the journal written
+    // after it) and journals every later change there. Returns the number of games restored.
+    // Checkpoints hold a full save of every game, so restored games keep their names, retained
+    // history and statistics; they start fresh turn timers. A change is durable once the
+    // journal's next group commit has run.
+    size_t open_journal(const std::string& directory, const JournalOptions& options = JournalOptions());
+    // Saves every game and starts a new, empty journal. Only the saves are taken here; the
+    // checkpoint file is written and synced on the journal's committer thread, and a failed
+    // write stops the journal like any other write error.
+    void checkpoint();
+    // Returns once every change so far, and every checkpoint started, is on disk
+    void sync_journal();
+
+    void set_listener(const std::function<void(const HostEvent&)>& on_event) { listener = on_event; }
+    const HostStats& get_stats() const { return stats; }
+    size_t pending_timers() const { return wheel.size(); }
+};
+
+#endif // GAMEHOST_HPP
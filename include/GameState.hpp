@@ -0,0 +1,53 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef GAMESTATE_HPP
+#define GAMESTATE_HPP
+
+#include <cstdint>
+
+const int MAX_PLAYERS = 6;
+
+// Compact copy of one player's state. Pointers are replaced by seat indices.
+struct PlayerState {
+    int32_t coins;
+    int8_t role;                         // RoleType value, -1 if the player has no role
+    int8_t last_arrested;                // Seat of the last arrested player, -1 if none
+    bool active;
+    bool sanctioned;
+};
+
+// Compact, trivially copyable copy of everything that decides how a game continues.
+// Names and action history are not part of it.
+struct GameState {
+    int32_t treasury;
+    uint8_t player_count;
+    uint8_t current_player;
+    bool game_active;
+    bool extra_turn;
+    PlayerState players[MAX_PLAYERS];
+};
+
+// A state with its players relabelled into canonical order, plus the relabelling used
+struct CanonicalState {
+    GameState state;
+    uint8_t original_seat[MAX_PLAYERS];  // Canonical seat -> seat in the original state
+    uint8_t canonical_seat[MAX_PLAYERS]; // Seat in the original state -> canonical seat
+};
+
+// Puts the current player in seat 0 and sorts the other players by (role, coins, flags),
+// remapping every last-arrested seat. States that only differ by which seat an opponent
+// sits in share one canonical form. Seating order among opponents is dropped, so with
+// three or more players only use it for tables where turn order between them does not matter.
+CanonicalState canonicalize(const GameState& state);
+
+// Hash of every field of the state (padding bytes are ignored)
+uint64_t hash_state(const GameState& state);
+
+// Lockstep checksum of a state: the XOR of a hash of the table fields and one hash per seated
+// player, so a game can keep it current by swapping out the hash of the part that changed
+uint64_t checksum_table(int32_t treasury, uint8_t player_count, uint8_t current_player, bool game_active,
+                        bool extra_turn);
+uint64_t checksum_seat(int seat, const PlayerState& player);
+uint64_t state_checksum(const GameState& state);
+
+#endif // GAMESTATE_HPP
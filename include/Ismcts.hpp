@@ -0,0 +1,69 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef ISMCTS_HPP
+#define ISMCTS_HPP
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Game.hpp"
+#include "GameState.hpp"
+#include "Simulator.hpp"
+
+// Samples full game states that agree with everything one seat has observed.
+// A hidden opponent role is drawn uniformly from the roles consistent with the public
+// history: a player recorded as blocking an action must hold a role able to block it.
+// Hidden coin counts are estimated by replaying the public coin flows of the history,
+// with taxes worth more when the sampled role is a Governor. Flows the history does not
+// record (Baron investments, Merchant bonuses) are missed by the estimate.
+class Determinizer {
+private:
+    GameState observed;                  // Hidden roles and coins are cleared
+    std::vector<std::vector<RoleType>> candidates; // Per seat, empty when the role is visible
+    std::vector<bool> coins_hidden;
+    std::vector<int> estimated_coins;    // Public coin estimate for a non-Governor
+    std::vector<int> taxes;              // Unblocked taxes collected by each seat
+    int governor_tax_bonus;
+
+public:
+    Determinizer(const Game& game, int observer_seat);
+
+    const std::vector<RoleType>& candidate_roles(int seat) const { return candidates[seat]; }
+    GameState sample(std::mt19937_64& rng) const;
+};
+
+struct IsmctsOptions {
+    int iterations = 2000;               // Iterations per thread
+    int threads = 0;                     // 0 uses every core
+    double exploration = 0.7;            // UCB exploration constant
+    int rollout_turns = 200;             // Random playout length before scoring a draw
+    uint64_t seed = 1;
+};
+
+struct IsmctsReport {
+    Move move = Move(MoveType::GATHER);
+    uint64_t iterations = 0;
+    double seconds = 0;
+    double iterations_per_second = 0;
+    std::vector<std::pair<Move, uint64_t>> root_visits; // Visits of each root move, summed over threads
+};
+
+// Single-observer information-set Monte Carlo tree search for the player to move.
+// Every iteration samples a determinization and walks one tree shared by all samples,
+// considering only the moves legal in that sample; a move's exploration term counts how
+// often it was available instead of how often its parent was visited. Each thread searches
+// its own tree and the root visit counts are summed (root parallelisation).
+class IsmctsBot {
+private:
+    IsmctsOptions options;
+    uint64_t searches;                   // Varies the seeds between calls
+
+public:
+    explicit IsmctsBot(const IsmctsOptions& bot_options = IsmctsOptions());
+
+    // Never reads roles or coins the player to move cannot see
+    Move choose_move(const Game& game, IsmctsReport* report = nullptr);
+};
+
+#endif // ISMCTS_HPP
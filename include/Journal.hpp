@@ -0,0 +1,76 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct JournalOptions {
+    uint64_t commit_interval_us = 2000;  // Appends wait at most this long to share one fdatasync
+    size_t commit_batch_bytes = 1 << 16; // Pending bytes that start a commit early
+    uint64_t snapshot_every = 100000;    // Records between automatic host checkpoints, 0 = never
+};
+
+// Append-only log with group commit. append() only copies the record into a memory buffer;
+// a committer thread writes the buffer out and calls fdatasync once per batch, so many
+// records share one disk flush. Each record is framed as
+// [u32 payload size][u8 type][payload][u32 checksum], and a reader stops at the first torn
+// or corrupt record, which is where a crash cut the log off.
+class Journal {
+private:
+    int fd;
+    std::string path;
+    JournalOptions options;
+
+    std::mutex mutex;
+    std::condition_variable wake_committer;
+    std::condition_variable committed_signal;
+    std::vector<uint8_t> pending;
+    uint64_t appended_records;
+    uint64_t durable_records;
+    uint64_t sync_count;
+    bool stopping;
+    bool failed;
+    bool started;                        // before_commits has run
+    std::function<void()> before_commits;
+    std::thread committer;
+
+    void commit_loop();
+
+public:
+    // before_commits, if given, runs on the committer thread before the first record is
+    // written; records appended meanwhile wait in memory, and a throw stops the journal
+    Journal(const std::string& file_path, const JournalOptions& journal_options = JournalOptions(),
+            std::function<void()> before_commits = nullptr);
+    ~Journal();                          // Commits what is pending
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void append(uint8_t type, const uint8_t* payload, size_t size);
+    void append(uint8_t type, const std::vector<uint8_t>& payload) { append(type, payload.data(), payload.size()); }
+
+    // Returns once before_commits has run and every record appended so far is on disk
+    void sync();
+
+    uint64_t get_appended() const { return appended_records; }
+    uint64_t get_sync_count();
+
+    // Calls on_record for every intact record of a journal file and returns how many there
+    // were. A missing file has none. intact_bytes receives the length of the intact prefix,
+    // so a torn tail can be cut off before appending again.
+    static uint64_t read(const std::string& file_path,
+                         const std::function<void(uint8_t type, const uint8_t* payload, size_t size)>& on_record,
+                         uint64_t* intact_bytes = nullptr);
+
+    // Frames one record into out, as append() does; used for snapshot files too
+    static void frame(uint8_t type, const uint8_t* payload, size_t size, std::vector<uint8_t>& out);
+};
+
+#endif // JOURNAL_HPP
@@ -19,22 +19,26 @@ private:
     bool is_active;                      // Is player still in the game?
     bool is_sanctioned;                  // Is player sanctioned (cannot use economic actions)?
     Player* last_arrested_target;        // Track last arrest target to prevent consecutive arrests
+    Game* game;                          // Game the player was last seated in, told about role changes
     
 public:
-    // Constructor - creates a player with 2 starting coins
-    Player(const std::string& player_name);
+    // Constructor - creates a player with 2 starting coins (or the given rule value)
+    Player(const std::string& player_name, int starting_coins = 2);
     
     // Getter methods - return player information
-    std::string get_name() const { return name; }
+    const std::string& get_name() const { return name; }
     int get_coins() const { return coins; }
     bool is_player_active() const { return is_active; }
     bool is_player_sanctioned() const { return is_sanctioned; }
-    std::shared_ptr<Role> get_role() const { return role; }
+    const std::shared_ptr<Role>& get_role() const { return role; }
+    Game* get_game() const { return game; }
     
     // Setter methods - modify player state
-    void set_role(std::shared_ptr<Role> new_role);
+    void set_role(std::shared_ptr<Role> new_role); // Also updates who can block in the player's game
+    void set_game(Game* seated_game) { game = seated_game; } // Called by Game when seating the player
     void add_coins(int amount);          // Throws exception if amount is negative
     void remove_coins(int amount);       // Throws exception if not enough coins
+    void set_coins(int amount);          // Throws exception if amount is negative
     void set_active(bool active) { is_active = active; }
     void set_sanctioned(bool sanctioned) { is_sanctioned = sanctioned; }
     void set_last_arrested(Player* target) { last_arrested_target = target; }
@@ -0,0 +1,48 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef PLAYERSTATS_HPP
+#define PLAYERSTATS_HPP
+
+#include <cstdint>
+#include "GameState.hpp"
+#include "Role.hpp"
+
+// Tendencies of one seat for opponent modelling. The game updates them in O(1) as actions
+// and blocks are recorded, so bots read them instead of scanning the action history.
+struct PlayerStats {
+    static const int WINDOW = 16;        // Actions in the recent window
+
+    uint32_t actions;                    // Actions taken
+    uint32_t counts[ACTION_TYPE_COUNT];  // Actions taken per type
+    uint32_t targeted;                   // Actions taken against another seat
+    uint32_t targets[MAX_PLAYERS];       // Targeted actions per target seat
+    uint32_t leader_targeted;            // Targeted actions against the richest opponent
+    uint32_t blocked;                    // Own actions that were blocked
+    uint32_t blocks;                     // Blocks made
+    uint64_t recent;                     // Last WINDOW action types, 4 bits each, newest lowest
+    uint8_t recent_counts[ACTION_TYPE_COUNT];
+
+    // target_leads: before the action, the target had at least as many coins as every other
+    // active opponent
+    void record(ActionType action, int target_seat, bool target_leads);
+    // False if the recent window holds something other than action types
+    bool is_valid() const;
+
+    uint32_t recent_actions() const { return actions < WINDOW ? actions : WINDOW; }
+    double rate(ActionType action) const {
+        return actions ? static_cast<double>(counts[static_cast<int>(action)]) / actions : 0.0;
+    }
+    // Share of the last WINDOW actions that had this type
+    double recent_rate(ActionType action) const {
+        return actions ? static_cast<double>(recent_counts[static_cast<int>(action)]) / recent_actions() : 0.0;
+    }
+    // Share of targeted actions aimed at the seat
+    double target_rate(int seat) const {
+        return targeted ? static_cast<double>(targets[seat]) / targeted : 0.0;
+    }
+    double leader_target_rate() const {
+        return targeted ? static_cast<double>(leader_targeted) / targeted : 0.0;
+    }
+};
+
+#endif // PLAYERSTATS_HPP
@@ -0,0 +1,43 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef PLAYERVIEW_HPP
+#define PLAYERVIEW_HPP
+
+#include <cstdint>
+#include <string>
+#include "Game.hpp"
+
+// What one seat can observe of a game. The view only references the game, so building
+// one is free and it always reflects the current position.
+// In hidden mode an opponent's role is only visible once the opponent is eliminated, and
+// (if coins are hidden too) an opponent's coins only after a Spy of the observer saw them.
+class PlayerView {
+private:
+    const Game& game;
+    int observer;
+
+public:
+    static const int HIDDEN = -2;        // Returned for roles and coins the observer cannot see
+
+    PlayerView(const Game& observed_game, int observer_seat);
+
+    int get_observer() const { return observer; }
+    size_t get_player_count() const { return game.get_player_count(); }
+    int get_current_player_index() const { return game.get_current_player_index(); }
+    int get_treasury_coins() const { return game.get_treasury_coins(); }
+
+    std::string name(int seat) const;
+    bool is_active(int seat) const;
+    bool is_sanctioned(int seat) const;
+
+    bool is_role_visible(int seat) const;
+    bool is_coins_visible(int seat) const;
+    int role(int seat) const;            // RoleType value, HIDDEN, or -1 if the player has no role
+    int coins(int seat) const;           // Coins, or HIDDEN
+
+    // Hash of everything this seat can observe, including the public action history.
+    // Two positions share a key exactly when the observer cannot tell them apart.
+    uint64_t information_set_key() const;
+};
+
+#endif // PLAYERVIEW_HPP
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <memory>
+#include "Rules.hpp"
 
 class Player;
 class Game;
@@ -27,6 +28,8 @@ enum class ActionType {
     COUP
 };
 
+const int ACTION_TYPE_COUNT = 6;
+
 class Role {
 protected:
     RoleType type;
@@ -59,7 +62,9 @@ public:
     
     void special_ability(Player& player, Game& game) override;
     int see_coins(Player& target);
-    void block_arrest(Player& target);
+    int see_coins(Player& spy, Player& target, Game& game); // Also reveals target's coins to spy in hidden mode
+    void block_arrest(Player& spy, Game& game); // Blocks the arrest just made against the spy
+    bool can_block_action(ActionType action, Player* actor, Player* target) override;
 };
 
 class Baron : public Role {
@@ -67,7 +72,7 @@ public:
     Baron() : Role(RoleType::BARON, "Baron") {}
     
     void special_ability(Player& player, Game& game) override;
-    void invest(Player& player);
+    void invest(Player& player, const GameRules& rules = GameRules::defaults());
 };
 
 class General : public Role {
@@ -76,6 +81,7 @@ public:
     
     void special_ability(Player& player, Game& game) override;
     bool block_coup(Player& defender, Player& attacker, Game& game);
+    bool can_block_action(ActionType action, Player* actor, Player* target) override;
 };
 
 class Judge : public Role {
@@ -91,7 +97,10 @@ public:
     Merchant() : Role(RoleType::MERCHANT, "Merchant") {}
     
     void special_ability(Player& player, Game& game) override;
-    void start_turn_bonus(Player& player);
+    void start_turn_bonus(Player& player, const GameRules& rules = GameRules::defaults());
 };
 
+// Creates the Role object for a role type
+std::shared_ptr<Role> make_role(RoleType type);
+
 #endif // ROLE_HPP
\ No newline at end of file
@@ -0,0 +1,96 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef RULECOMPARISON_HPP
+#define RULECOMPARISON_HPP
+
+#include <ostream>
+#include <vector>
+#include "Role.hpp"
+#include "Rules.hpp"
+#include "Simulator.hpp"
+
+// Win/appearance counts per role over a set of simulated games
+struct RoleTally {
+    static const int ROLES = 6;
+
+    long games = 0;
+    long draws = 0;
+    long appearances[ROLES] = {};
+    long wins[ROLES] = {};
+
+    // Counts one game played with the given seat roles
+    void add(const std::vector<RoleType>& roles, const SimulationResult& result);
+    void merge(const RoleTally& other);
+
+    static const char* role_name(int role);
+};
+
+// Outcome of the stopping rule for one role
+enum class Verdict {
+    UNDECIDED,
+    A_BETTER,
+    B_BETTER,
+    EQUIVALENT
+};
+
+const char* verdict_name(Verdict verdict);
+
+// Posterior summary of p_B - p_A for one role, using Beta(wins + 1, losses + 1) posteriors
+struct RoleComparison {
+    double rate_a;
+    double rate_b;
+    double diff;
+    double diff_sd;
+    double prob_b_better;                // P(p_B > p_A | data)
+
+    RoleComparison(long wins_a, long trials_a, long wins_b, long trials_b);
+
+    // A or B once the posterior puts at most alpha on the other side, EQUIVALENT once the
+    // 99% interval of the difference lies inside +-margin
+    Verdict verdict(double alpha, double margin) const;
+};
+
+struct ComparisonOptions {
+    int players = 4;
+    int threads = 0;                     // 0 for one per core
+    int batch = 256;                     // Pairs per thread per round
+    long min_games = 2000;
+    long max_games = 1000000;
+    int max_turns = 1000;
+    unsigned long seed = 1;
+    int role = -1;                       // Only decide this role, -1 for all roles
+    double alpha = 0.01;                 // Posterior error allowed when declaring a winner
+    double margin = 0.01;                // Win-rate differences below this count as equal
+};
+
+// The sequential stopping rule: true once min_games are in and every role considered
+// has a verdict other than UNDECIDED
+bool comparison_settled(const RoleTally& a, const RoleTally& b, const ComparisonOptions& options);
+
+// Compares two rule variants in paired batches (same seats, roles and random stream for
+// both) until the stopping rule is met or max_games is reached
+class ComparisonRunner {
+private:
+    ComparisonOptions options;
+    GameRules rules_a;
+    GameRules rules_b;
+    RoleTally tally_a;
+    RoleTally tally_b;
+
+    void run_pairs(long pairs, unsigned long seed, RoleTally& out_a, RoleTally& out_b) const;
+
+public:
+    ComparisonRunner(const GameRules& a, const GameRules& b, const ComparisonOptions& opts);
+
+    void run();
+    bool settled() const { return comparison_settled(tally_a, tally_b, options); }
+
+    const RoleTally& get_tally_a() const { return tally_a; }
+    const RoleTally& get_tally_b() const { return tally_b; }
+    RoleComparison compare(int role) const;
+
+    // One tab separated row per role considered
+    void write_table(std::ostream& out) const;
+};
+
+#endif // RULECOMPARISON_HPP
@@ -0,0 +1,37 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef RULES_HPP
+#define RULES_HPP
+
+// GameRules collects the balance constants used by Player, Role and Game.
+// The defaults are the standard rules; the simulator varies them for balance sweeps.
+struct GameRules {
+    int starting_coins = 2;              // Coins every player starts with
+    int starting_treasury = 50;          // Coins in the treasury when the game is created
+
+    int gather_amount = 1;               // Coins taken by gather
+    int tax_amount = 2;                  // Coins taken by tax
+    int governor_tax_amount = 3;         // Coins taken by tax when the player is a Governor
+    int bribe_cost = 4;                  // Price of an extra turn
+    int arrest_amount = 1;               // Coins taken from the arrested player
+    int sanction_cost = 3;               // Price of sanctioning another player
+    int coup_cost = 7;                   // Price of eliminating another player
+    int forced_coup_threshold = 10;      // Coins at turn start that force a coup
+
+    int baron_invest_cost = 3;           // Coins a Baron pays to invest
+    int baron_invest_return = 6;         // Coins a Baron gets back from investing
+    int baron_sanction_compensation = 1; // Coins a Baron receives when sanctioned
+    int general_block_cost = 5;          // Coins a General pays to block a coup
+    int judge_sanction_penalty = 1;      // Extra coins paid to the treasury when sanctioning a Judge
+    int merchant_bonus_threshold = 3;    // Coins a Merchant needs at turn start for the bonus
+    int merchant_bonus = 1;              // Coins a Merchant gets at turn start
+    int merchant_arrest_penalty = 2;     // Coins an arrested Merchant pays to the treasury
+
+    // Shared instance used when no game-specific rules are available
+    static const GameRules& defaults() {
+        static const GameRules rules;
+        return rules;
+    }
+};
+
+#endif // RULES_HPP
@@ -0,0 +1,91 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <random>
+#include <functional>
+#include "Game.hpp"
+#include "Role.hpp"
+#include "Rules.hpp"
+
+class Player;
+
+// Moves a player can choose on their turn (INVEST is the Baron's ability)
+enum class MoveType {
+    GATHER,
+    TAX,
+    BRIBE,
+    ARREST,
+    SANCTION,
+    COUP,
+    INVEST
+};
+
+struct Move {
+    MoveType type;
+    int target;                          // Seat index of the target, -1 if the move has none
+
+    Move(MoveType t, int targ = -1) : type(t), target(targ) {}
+
+    bool operator==(const Move& other) const { return type == other.type && target == other.target; }
+};
+
+// One turn as played, enough to play it again: the move (-1 for a turn skipped because
+// nothing was legal) and the seat that blocked it
+struct RecordedTurn {
+    int8_t move;
+    int8_t target;
+    int8_t blocker;                      // -1 if the move was not blocked
+};
+
+// Result of one simulated game
+struct SimulationResult {
+    int winner;                          // Seat index of the winner, -1 if the turn limit was hit
+    int turns;                           // Number of turns played
+};
+
+// Seat index of a player in the game, -1 if the player is not seated
+int seat_of(const Game& game, const Player* player);
+
+// All moves the current player may legally make; only coups when a coup is forced
+std::vector<Move> legal_moves(const Game& game);
+bool is_legal_move(const Game& game, const Move& move);
+
+// The move played for a player who does not choose one: gather if possible, otherwise the
+// first legal move (a forced coup). Throws if nothing is legal.
+Move default_move(const Game& game);
+
+// Decides whether an eligible player blocks the action just played
+typedef std::function<bool(Player& blocker, const ActionRecord& action)> BlockDecision;
+
+// Blocks only coups: a General targeted by a coup blocks it whenever they can pay for it
+bool block_coups_only(Player& blocker, const ActionRecord& action);
+
+// True for moves that are followed by a reaction window (tax, bribe, arrest, coup)
+bool opens_reaction_window(MoveType type);
+
+// Players who may block the move just played, in the order the window asks them; empty
+// when the move opens no window or nobody can block it
+std::vector<Player*> reaction_blockers(const Game& game, const Move& move);
+
+// The three steps of a move, for callers that run the reaction window themselves:
+// play_action applies the action, complete_move eliminates the target of an unblocked
+// coup and advances the turn.
+void play_action(Game& game, const Move& move);
+void complete_move(Game& game, const Move& move);
+
+// Plays a move for the current player, runs the reaction window and advances the turn
+void apply_move(Game& game, const Move& move, const BlockDecision& decide = block_coups_only);
+
+// Plays a recorded turn for the current player
+void replay_turn(Game& game, const RecordedTurn& turn);
+
+// Plays one game between uniformly random players with the given seat roles
+SimulationResult simulate_game(const GameRules& rules, const std::vector<RoleType>& roles,
+                               std::mt19937_64& rng, int max_turns = 1000);
+
+#endif // SIMULATOR_HPP
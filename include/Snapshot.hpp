@@ -0,0 +1,41 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Game.hpp"
+#include "GameState.hpp"
+
+// Seqlock around a GameState, for observers on other threads. One writer publishes copies
+// of the state and never waits. Readers copy without taking a lock and retry if a publish
+// overlapped their copy. The state is kept as relaxed atomic words, so a torn read is
+// detected and thrown away rather than being a data race.
+class SnapshotPublisher {
+private:
+    static const size_t WORDS = (sizeof(GameState) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> sequence; // Odd while a publish is in progress
+    std::atomic<uint64_t> words[WORDS];
+
+public:
+    explicit SnapshotPublisher(const GameState& initial = GameState());
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Only one thread may publish
+    void publish(const GameState& state);
+    void publish(const Game& game) { publish(game.capture_state()); }
+
+    // One attempt; false if a publish overlapped the copy
+    bool try_read(GameState& state) const;
+    // Retries until it gets a consistent copy
+    GameState read() const;
+
+    // Number of publishes so far
+    uint64_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,75 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef SPECTATOR_HPP
+#define SPECTATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Game.hpp"
+#include "GameState.hpp"
+
+// Encoded update, shared read-only by every subscriber it is sent to
+typedef std::shared_ptr<const std::vector<uint8_t>> StateFrame;
+
+// Frame layout: type byte, varint sequence number, table mask byte, then the changed table
+// fields (current player, treasury as a zigzag varint delta, active/extra-turn flags), a
+// player mask byte and, per changed player, a field mask byte followed by its changed
+// fields (coins as a zigzag varint delta, active/sanctioned flags, role, last arrested),
+// and finally the low 32 bits of state_checksum of the resulting state, little-endian.
+// A keyframe is the delta from an all-zero state with every field present.
+enum class FrameType : uint8_t {
+    KEYFRAME = 0,
+    DELTA = 1
+};
+
+// Appends the frame that turns before into after; a null before encodes a keyframe
+void encode_state_frame(const GameState* before, const GameState& after, uint64_t sequence,
+                        std::vector<uint8_t>& out);
+
+// Applies a frame to a spectator's copy of the state and returns its sequence number.
+// A keyframe replaces the state. Throws std::runtime_error on a malformed frame or when the
+// decoded state does not match the frame's checksum (e.g. a delta applied after a lost frame);
+// the state is left untouched either way.
+uint64_t apply_state_frame(GameState& state, const uint8_t* data, size_t size);
+
+// Streams one game to any number of spectators. publish() encodes the changes since the
+// previous publish once and hands the same frame to every subscriber; new subscribers
+// start from a keyframe of the current state. Spectators see the open table, coins and
+// roles included.
+class SpectatorFeed {
+public:
+    typedef std::function<void(const StateFrame& frame)> Sender;
+
+private:
+    struct Subscriber {
+        uint64_t id;
+        Sender send;
+    };
+
+    const Game& game;
+    GameState last;
+    uint64_t sequence;
+    uint64_t next_id;
+    StateFrame keyframe;                 // Keyframe of last, built when a subscriber joins
+    std::vector<Subscriber> subscribers;
+    uint64_t frames_encoded;
+    uint64_t bytes_encoded;
+
+public:
+    explicit SpectatorFeed(const Game& watched);
+
+    uint64_t subscribe(const Sender& send);
+    bool unsubscribe(uint64_t id);
+    size_t subscriber_count() const { return subscribers.size(); }
+
+    // Sends the changes since the last publish; false if nothing changed
+    bool publish();
+
+    uint64_t get_frames_encoded() const { return frames_encoded; }
+    uint64_t get_bytes_encoded() const { return bytes_encoded; }
+};
+
+#endif // SPECTATOR_HPP
@@ -0,0 +1,82 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+#include "Rules.hpp"
+
+// Game-theoretic value of a two-player state for the player to move
+enum class TablebaseResult {
+    UNKNOWN,                             // Not in the table (coins out of range, not two players)
+    WIN,
+    LOSS,
+    DRAW
+};
+
+// Perfect hash of every two-player state with both players active. index_of rejects states
+// outside it (unknown roles, coins past the limit), so probing a decoded state is safe.
+// Mixed radix over: role of each seat, coins of each seat, sanctions, whether each seat's
+// last arrest was the opponent, the side to move and the extra-turn flag.
+class TablebaseIndex {
+public:
+    static const int COIN_LIMIT = 16;    // Coins 0..15 per player
+    static const uint32_t STATE_COUNT = 6 * 6 * COIN_LIMIT * COIN_LIMIT * 2 * 2 * 2 * 2 * 2 * 2;
+
+    static bool index_of(const GameState& state, uint32_t& index);
+    static GameState state_at(uint32_t index);
+};
+
+// Fingerprint of a rule set, stored in tablebase files so a table is only used with the
+// rules it was solved for
+uint64_t rules_hash(const GameRules& rules);
+
+// Solves every indexed state by parallel retrograde analysis with the default rules. After a
+// blockable move the opponent chooses whether to block it (a General only if they can pay),
+// so a move is only as good as the opponent's best reaction.
+class TablebaseGenerator {
+private:
+    GameRules rules;
+    std::vector<uint8_t> values;         // One TablebaseResult per state
+    size_t out_of_table_moves;           // Move outcomes (move and reaction) that cannot be indexed
+    size_t out_of_table_states;          // States with at least one such outcome
+
+public:
+    explicit TablebaseGenerator(const GameRules& game_rules = GameRules::defaults());
+
+    void generate(int threads = 0);
+    TablebaseResult value(uint32_t index) const { return static_cast<TablebaseResult>(values[index]); }
+    size_t count(TablebaseResult result) const;
+
+    // Successors outside the table (e.g. coins past COIN_LIMIT) are scored as draws, so the
+    // values of the states that reach them are approximate; all other values are exact
+    size_t get_out_of_table_moves() const { return out_of_table_moves; }
+    size_t get_out_of_table_states() const { return out_of_table_states; }
+
+    // File layout: 32-byte header (including the rules hash), then 2 bits per state, four
+    // states per byte
+    void write(const std::string& path) const;
+};
+
+// Read-only, memory-mapped tablebase file; probing a state is one index computation and one load
+class Tablebase {
+private:
+    void* mapping;
+    size_t mapping_size;
+    const uint8_t* packed;
+
+public:
+    // Throws std::runtime_error if the file was generated for other rules
+    explicit Tablebase(const std::string& path, const GameRules& rules = GameRules::defaults());
+    ~Tablebase();
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    TablebaseResult probe(const GameState& state) const;
+};
+
+#endif // TABLEBASE_HPP
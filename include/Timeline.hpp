@@ -0,0 +1,43 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Game.hpp"
+#include "Simulator.hpp"
+
+// Turn-by-turn log of a game with a save (keyframe) every keyframe_interval turns.
+// Any turn is rebuilt by loading the keyframe at or before it and replaying at most
+// keyframe_interval - 1 turns, so a longer interval costs less memory and more replay.
+// Keyframes keep only the newest action record, so each costs the same however long the
+// game has run; a rebuilt game's history starts at its keyframe's last record.
+class GameTimeline {
+private:
+    static const size_t KEYFRAME_RECORDS = 1;
+
+    size_t interval;
+    std::vector<RecordedTurn> turns;
+    std::vector<std::vector<uint8_t>> keyframes; // Keyframe k is the game after k * interval turns
+
+    void append(const Game& game, const RecordedTurn& turn);
+
+public:
+    // Starts recording from the game as it is now (turn 0)
+    explicit GameTimeline(const Game& start, size_t keyframe_interval = 32);
+
+    // Records one finished turn; game is the live game after the turn was completed
+    void record(const Game& game, const Move& move, int blocker_seat = -1);
+    void record_skip(const Game& game);
+
+    size_t turn_count() const { return turns.size(); }
+    size_t keyframe_count() const { return keyframes.size(); }
+    size_t memory_bytes() const;
+
+    // Rebuilds into out the game as it was after the given number of turns
+    void materialize(size_t turn, Game& out) const;
+};
+
+#endif // TIMELINE_HPP
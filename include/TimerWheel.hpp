@@ -0,0 +1,61 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Hierarchical timing wheel: four levels of 256 slots, each level 256 times coarser than
+// the one below. A timer lives in an intrusive list of its slot, so scheduling and
+// cancelling are O(1). Timers further out than the top level can reach wait in an overflow
+// list until the top level wraps. Timers on coarse levels move down a level when their slot
+// comes up, and fire from level 0 on their exact tick.
+class TimerWheel {
+public:
+    typedef uint64_t TimerId;            // 0 is never a valid id
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const uint32_t SLOTS = 1u << SLOT_BITS;
+    static const uint32_t NIL = 0xFFFFFFFFu;
+    static const uint32_t OVERFLOW_LIST = LEVELS * SLOTS;
+    static const uint32_t FREE_LIST = OVERFLOW_LIST + 1;
+
+    struct Node {
+        uint64_t deadline;
+        uint64_t payload;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t generation;
+        uint32_t list;                   // level * SLOTS + slot, OVERFLOW_LIST or FREE_LIST
+    };
+
+    std::vector<Node> nodes;
+    uint32_t free_head;
+    uint32_t heads[LEVELS * SLOTS + 1]; // One list per slot, then the overflow list
+    uint64_t current;
+    size_t count;
+
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void cascade(int level);
+
+public:
+    explicit TimerWheel(uint64_t start_tick = 0);
+
+    // Fires on the first advance that reaches current tick + delay (at least one tick ahead)
+    TimerId schedule(uint64_t delay_ticks, uint64_t payload);
+    bool cancel(TimerId id);             // False if the timer already fired or was cancelled
+
+    // Moves time forward to now, calling on_expire(payload) for every timer that becomes
+    // due, in tick order. Callbacks may schedule and cancel timers.
+    void advance(uint64_t now, const std::function<void(uint64_t payload)>& on_expire);
+
+    uint64_t now() const { return current; }
+    size_t size() const { return count; }
+};
+
+#endif // TIMERWHEEL_HPP
@@ -0,0 +1,158 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef TURNPIPELINE_HPP
+#define TURNPIPELINE_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Game.hpp"
+#include "Simulator.hpp"
+
+class TurnPipeline;
+
+// A question the game asks one seat: its next move, or whether it blocks the last action
+struct InputRequest {
+    enum Kind { MOVE, BLOCK };
+    // Illegal answers in a row after which the seat's default move is played for it
+    static const int MAX_REJECTED = 8;
+
+    Kind kind;
+    const Game* game;
+    int seat;
+    int rejected;                        // Illegal answers so far to this MOVE question
+    Move move;                           // Answer to MOVE
+    bool block;                          // Answer to BLOCK
+    bool quit;                           // Answer that stops the game where it is
+    std::coroutine_handle<> waiting;
+    TurnPipeline* pipeline;
+};
+
+// Where a seat's decisions come from. answer() either fills the request at once and returns
+// true, or keeps it and returns false; the game then stays suspended until the source
+// answers and calls TurnPipeline::schedule(request.waiting).
+class SeatInput {
+public:
+    virtual ~SeatInput() = default;
+    virtual bool answer(InputRequest& request) = 0;
+};
+
+// Decides immediately through callbacks (bots, simulations, local console prompts)
+class BotInput : public SeatInput {
+private:
+    std::function<Move(const Game&, int seat)> choose;
+    std::function<bool(const Game&, int seat)> decide_block;
+
+public:
+    // Without a block callback the bot only blocks coups aimed at it
+    explicit BotInput(const std::function<Move(const Game&, int seat)>& choose_move,
+                      const std::function<bool(const Game&, int seat)>& block = nullptr);
+    bool answer(InputRequest& request) override;
+};
+
+// Replays a fixed list of moves and block answers; waits forever once they run out
+class ReplayInput : public SeatInput {
+private:
+    std::vector<Move> moves;
+    std::vector<bool> blocks;
+    size_t next_move;
+    size_t next_block;
+
+public:
+    ReplayInput(const std::vector<Move>& replay_moves, const std::vector<bool>& replay_blocks = {});
+    bool answer(InputRequest& request) override;
+};
+
+// Reads moves written one per line as "<move> [target seat]", e.g. "tax" or "arrest 2"
+std::vector<Move> read_move_file(const std::string& path);
+
+// Answers pushed from outside (a socket reader, GUI clicks) for one seat of one game.
+// Thread-safe: a push from any thread wakes the suspended game. Block questions are answered by the optional callback
+// when one is given, otherwise from pushed answers.
+class QueuedInput : public SeatInput {
+private:
+    std::mutex mutex;
+    std::deque<Move> moves;
+    std::deque<bool> blocks;
+    InputRequest* waiting;
+    bool quit_pending;
+    std::function<bool(const Game&, int seat)> decide_block;
+
+    bool take(InputRequest& request);    // Caller holds the mutex
+
+public:
+    explicit QueuedInput(const std::function<bool(const Game&, int seat)>& block = nullptr);
+
+    void push_move(const Move& move);
+    void push_block(bool block);
+    void push_quit();
+    bool is_waiting();
+    bool answer(InputRequest& request) override;
+};
+
+// Coroutine that plays one game; suspended while a seat has not answered
+class GameTask {
+public:
+    struct promise_type {
+        std::exception_ptr error;
+
+        static void* operator new(size_t size);
+        static void operator delete(void* frame, size_t size);
+
+        GameTask get_return_object() { return GameTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    explicit GameTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+    GameTask(GameTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    GameTask& operator=(GameTask&&) = delete;
+    GameTask(const GameTask&) = delete;
+    ~GameTask();
+
+    std::coroutine_handle<promise_type> get_handle() const { return handle; }
+    bool done() const { return handle.done(); }
+    static size_t frame_bytes();         // Size of one game coroutine frame
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Drives any number of games on a few threads. A game runs until it needs an answer that is
+// not available, then suspends; schedule() puts it back on the run queue.
+class TurnPipeline {
+private:
+    struct Entry {
+        Game* game;
+        std::vector<SeatInput*> seats;
+        std::unique_ptr<GameTask> task;
+    };
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::mutex mutex;
+    std::condition_variable ready_signal;
+    std::deque<std::coroutine_handle<>> ready;
+    size_t running;                      // Games being resumed right now
+
+public:
+    TurnPipeline();
+
+    // Game and seat inputs must outlive the pipeline; seats[i] answers for seat i
+    void add_game(Game& game, const std::vector<SeatInput*>& seats);
+    void schedule(std::coroutine_handle<> game);
+
+    // Resumes ready games on the given number of threads until none is ready. Returns the
+    // number of games that have finished (or quit) so far; rethrows a game's exception.
+    size_t run(int threads = 1);
+    size_t game_count() const { return entries.size(); }
+};
+
+#endif // TURNPIPELINE_HPP
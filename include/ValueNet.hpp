@@ -0,0 +1,81 @@
+// yaacovkrawiec@gmail.com
+
+#ifndef VALUENET_HPP
+#define VALUENET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+
+class Game;
+
+// Features per seat slot: active, coins, sanctioned, is current player, role one-hot (6)
+const int SEAT_FEATURES = 10;
+// Six seat slots, then treasury, extra turn, player count and the slot the viewer last arrested
+const int FEATURE_COUNT = MAX_PLAYERS * SEAT_FEATURES + 4;
+
+// Encodes a state as seen by one seat. Slot 0 is the viewer and the other seats follow in
+// turn order, so the same position looks the same from every chair; empty slots are zero.
+// Counts are clamped to 0..127. The state holds every role, so with hidden roles encode a
+// determinized state.
+void encode_features(const GameState& state, int seat, int8_t out[FEATURE_COUNT]);
+
+// One fully connected layer, weights row-major (outputs x inputs) as most trainers store them
+struct DenseLayer {
+    size_t inputs;
+    size_t outputs;
+    std::vector<float> weights;
+    std::vector<float> biases;
+};
+
+// Weights file: "CVN1", u32 layer count, then per layer u32 inputs, u32 outputs, the weights
+// and the biases as little-endian float32. Throws std::runtime_error on a malformed file.
+std::vector<DenseLayer> read_value_net(const std::string& path);
+void write_value_net(const std::string& path, const std::vector<DenseLayer>& layers);
+
+enum class SimdLevel {
+    SCALAR,
+    AVX2,                                // AVX2 with FMA
+    AVX512                               // AVX-512F
+};
+
+// The best level this CPU runs
+SimdLevel detect_simd();
+
+// Small MLP that scores a position for the viewing seat: ReLU between layers and a sigmoid on
+// the single output, so values are win probabilities. Layers take FEATURE_COUNT inputs first
+// and end with one output. Weights are kept transposed and padded to whole vectors, and
+// positions are evaluated a few at a time so each weight load feeds several of them. The
+// kernel is picked at run time from detect_simd().
+class ValueNet {
+public:
+    static const size_t MAX_WIDTH = 512; // Widest layer accepted
+    static const size_t TILE = 4;        // Positions sharing each weight load
+
+private:
+    struct Layer {
+        size_t inputs;
+        size_t outputs;                  // Padded to a multiple of 16
+        std::vector<float> weights;      // Transposed: inputs x padded outputs
+        std::vector<float> biases;       // Padded outputs
+    };
+
+    std::vector<Layer> layers;
+    SimdLevel simd;
+
+public:
+    explicit ValueNet(const std::vector<DenseLayer>& dense_layers);
+    explicit ValueNet(const std::string& path) : ValueNet(read_value_net(path)) {}
+
+    SimdLevel get_simd() const { return simd; }
+    // Throws std::invalid_argument if the CPU lacks the level
+    void set_simd(SimdLevel level);
+
+    // Scores count positions of FEATURE_COUNT features each
+    void evaluate(const int8_t* features, size_t count, float* values) const;
+    float evaluate(const Game& game, int seat) const;
+};
+
+#endif // VALUENET_HPP
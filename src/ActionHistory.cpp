@@ -0,0 +1,101 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/ActionHistory.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+ActionHistory::ActionHistory() : limit(0), head(0), total(0), seats(), latest() {
+}
+
+void ActionHistory::set_seats(const std::vector<Player*>& players) {
+    std::fill(seats, seats + MAX_PLAYERS, nullptr);
+    std::copy(players.begin(), players.begin() + std::min<size_t>(players.size(), MAX_PLAYERS), seats);
+}
+
+ActionRecord ActionHistory::decode(PackedAction packed) const {
+    auto player_at = [this](int seat) { return seat >= 0 ? seats[seat] : nullptr; };
+    ActionRecord record(packed.action(), player_at(packed.actor()), player_at(packed.target()));
+    record.was_blocked = packed.blocked();
+    record.blocker = player_at(packed.blocker());
+    record.turn = packed.turn();
+    return record;
+}
+
+void ActionHistory::index_record(size_t index, PackedAction packed) {
+    if (packed.actor() >= 0) {
+        latest[packed.actor()][static_cast<int>(packed.action())] = index + 1;
+    }
+}
+
+int ActionHistory::last_target(int actor_seat, ActionType action) const {
+    int64_t index = last_action_index(actor_seat, action);
+    if (index < static_cast<int64_t>(first_index())) {
+        return -1;
+    }
+    return packed(index).target();
+}
+
+void ActionHistory::push_back(PackedAction record) {
+    if (is_full()) {
+        records[head] = record;
+        head = (head + 1) % limit;
+    } else {
+        records.push_back(record);
+    }
+    index_record(total, record);
+    total++;
+}
+
+void ActionHistory::mark_last_blocked(int blocker_seat) {
+    records[slot(total - 1)].set_blocked(blocker_seat);
+}
+
+void ActionHistory::clear() {
+    records.clear();
+    head = 0;
+    total = 0;
+    std::memset(latest, 0, sizeof(latest));
+}
+
+void ActionHistory::set_limit(size_t new_limit) {
+    std::vector<PackedAction> kept;
+    size_t keep = new_limit > 0 ? std::min(new_limit, records.size()) : records.size();
+    kept.reserve(new_limit > 0 ? new_limit : records.size());
+    for (size_t i = total - keep; i < total; ++i) {
+        kept.push_back(packed(i));
+    }
+    records.swap(kept);
+    limit = new_limit;
+    head = 0;
+}
+
+void ActionHistory::assign(size_t first, const std::vector<PackedAction>& all) {
+    clear();
+    size_t keep = limit > 0 ? std::min(limit, all.size()) : all.size();
+    records.assign(all.end() - keep, all.end());
+    total = first + all.size();
+    for (size_t i = 0; i < all.size(); ++i) {
+        index_record(first + i, all[i]);
+    }
+}
+
+std::vector<SpilledRecord> read_history_spill(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Cannot open history spill " + path);
+    }
+    std::vector<SpilledRecord> spilled;
+    PackedAction packed;
+    while (std::fread(&packed.bits, sizeof(packed.bits), 1, file) == 1) {
+        if (!packed.is_valid(MAX_PLAYERS)) {
+            std::fclose(file);
+            throw std::runtime_error("Corrupt history spill " + path);
+        }
+        spilled.push_back(SpilledRecord{packed.action(), packed.actor(), packed.target(), packed.blocked(),
+                                        packed.blocker(), packed.turn()});
+    }
+    std::fclose(file);
+    return spilled;
+}
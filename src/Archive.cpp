@@ -0,0 +1,572 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Archive.hpp"
+#include "../include/Player.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t GameColumns::BLOCK;
+
+namespace {
+
+const uint32_t ARCHIVE_MAGIC = 0x33414743; // "CGA3"
+const size_t HEADER_BYTES = sizeof(ARCHIVE_MAGIC) + sizeof(GameRules);
+
+static_assert(sizeof(RecordedTurn) == 3, "Replays store three bytes per turn");
+static_assert(sizeof(BlockSummary) == 16 && std::is_trivially_copyable<BlockSummary>::value,
+              "Block summaries are stored as raw bytes");
+
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+void seat_players(Game& game, const GameRules& rules, const std::vector<RoleType>& roles) {
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("P" + std::to_string(i + 1), rules.starting_coins);
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.start_game();
+}
+
+std::string mismatch(const std::string& what, int replayed, int archived) {
+    return what + " is " + std::to_string(replayed) + ", archived " + std::to_string(archived);
+}
+
+// First difference between the summary of a replayed game and the archived one, or ""
+std::string compare_summaries(const ArchivedGame& replayed, const ArchivedGame& archived) {
+    if (replayed.turns != archived.turns) return mismatch("Turn count", replayed.turns, archived.turns);
+    if (replayed.winner != archived.winner) return mismatch("Winner", replayed.winner, archived.winner);
+    for (int seat = 0; seat < archived.player_count; ++seat) {
+        std::string who = "Seat " + std::to_string(seat);
+        if (replayed.final_coins[seat] != archived.final_coins[seat]) {
+            return mismatch(who + " final coins", replayed.final_coins[seat], archived.final_coins[seat]);
+        }
+        if (replayed.first_sanctioned[seat] != archived.first_sanctioned[seat]) {
+            return mismatch(who + " first sanction turn", replayed.first_sanctioned[seat],
+                            archived.first_sanctioned[seat]);
+        }
+    }
+    for (int action = 0; action < ACTION_TYPE_COUNT; ++action) {
+        if (replayed.action_counts[action] != archived.action_counts[action]) {
+            return mismatch("Count of action " + std::to_string(action), replayed.action_counts[action],
+                            archived.action_counts[action]);
+        }
+    }
+    return "";
+}
+
+} // namespace
+
+ArchivedGame play_archived_game(const GameRules& rules, const std::vector<RoleType>& roles, std::mt19937_64& rng,
+                                int max_turns) {
+    if (max_turns > 0xffff) {
+        throw std::invalid_argument("Archived games are limited to 65535 turns");
+    }
+    Game game(rules);
+    seat_players(game, rules, roles);
+
+    ArchivedGame record;
+    int turns = 0;
+    while (game.is_game_active() && turns < max_turns) {
+        std::vector<Move> moves = legal_moves(game);
+        if (moves.empty()) {
+            game.next_turn();
+            record.replay.push_back(RecordedTurn{-1, -1, -1});
+        } else {
+            Move move = moves[rng() % moves.size()];
+            play_action(game, move);
+            Player* blocker = opens_reaction_window(move.type) ? game.run_reaction_window(block_coups_only) : nullptr;
+            complete_move(game, move);
+            record.replay.push_back(RecordedTurn{static_cast<int8_t>(move.type), static_cast<int8_t>(move.target),
+                                                 static_cast<int8_t>(seat_of(game, blocker))});
+        }
+        record.checksums.push_back(static_cast<uint16_t>(game.get_state_checksum()));
+        turns++;
+    }
+    summarize_game(game, turns, record);
+    return record;
+}
+
+void summarize_game(const Game& game, int turns, ArchivedGame& record) {
+    record.player_count = static_cast<uint8_t>(game.get_player_count());
+    record.winner = -1;
+    record.turns = static_cast<uint16_t>(turns);
+    std::fill(record.action_counts, record.action_counts + ACTION_TYPE_COUNT, 0);
+    for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+        bool seated = seat < record.player_count;
+        Player* player = seated ? game.get_player_at(seat) : nullptr;
+        record.roles[seat] = player && player->get_role() ? static_cast<int8_t>(player->get_role()->get_type()) : -1;
+        record.final_coins[seat] = player ? static_cast<int16_t>(player->get_coins()) : 0;
+        record.first_sanctioned[seat] = NEVER_SANCTIONED;
+        if (player && !game.is_game_active() && player->is_player_active()) {
+            record.winner = static_cast<int8_t>(seat);
+        }
+    }
+
+    const ActionHistory& history = game.get_action_history();
+    for (size_t i = history.first_index(); i < history.size(); ++i) {
+        PackedAction action = history.packed(i);
+        record.action_counts[static_cast<int>(action.action())]++;
+        if (action.action() == ActionType::SANCTION && action.target() >= 0) {
+            uint16_t& first = record.first_sanctioned[action.target()];
+            first = std::min<uint16_t>(first, static_cast<uint16_t>(action.turn()));
+        }
+    }
+}
+
+bool revalidate_game(const GameRules& rules, const ArchivedGame& record, Divergence& divergence) {
+    auto diverged = [&divergence](int turn, const std::string& reason) {
+        divergence.turn = turn;
+        divergence.reason = reason;
+        return false;
+    };
+    if (record.player_count < 2 || record.player_count > MAX_PLAYERS) {
+        return diverged(0, "Invalid player count " + std::to_string(record.player_count));
+    }
+    std::vector<RoleType> roles;
+    for (int seat = 0; seat < record.player_count; ++seat) {
+        if (record.roles[seat] < 0 || record.roles[seat] > static_cast<int>(RoleType::MERCHANT)) {
+            return diverged(0, "Invalid role at seat " + std::to_string(seat));
+        }
+        roles.push_back(static_cast<RoleType>(record.roles[seat]));
+    }
+
+    Game game(rules);
+    int turn = 0;
+    try {
+        seat_players(game, rules, roles);
+        for (; turn < static_cast<int>(record.replay.size()); ++turn) {
+            const RecordedTurn& recorded = record.replay[turn];
+            if (!game.is_game_active()) {
+                return diverged(turn, "Game is already over");
+            }
+            if (recorded.target >= record.player_count || recorded.blocker >= record.player_count) {
+                return diverged(turn, "Recorded seat out of range");
+            }
+            // A skip is only recorded when nothing was legal, so a legal move now is a divergence.
+            // Moves are checked up front since some illegal ones, like an unaffordable
+            // investment, would not throw when played.
+            std::vector<Move> moves = legal_moves(game);
+            if (recorded.move < 0 && !moves.empty()) {
+                return diverged(turn, "Recorded skip, but a move is legal");
+            }
+            if (recorded.move >= 0 &&
+                std::find(moves.begin(), moves.end(), Move(static_cast<MoveType>(recorded.move), recorded.target)) ==
+                    moves.end()) {
+                return diverged(turn, "Recorded move is not legal");
+            }
+            replay_turn(game, recorded);
+            if (turn < static_cast<int>(record.checksums.size()) &&
+                static_cast<uint16_t>(game.get_state_checksum()) != record.checksums[turn]) {
+                return diverged(turn, "State checksum differs");
+            }
+        }
+    } catch (const std::exception& e) {
+        return diverged(turn, std::string("Recorded turn rejected: ") + e.what());
+    }
+
+    ArchivedGame replayed;
+    summarize_game(game, turn, replayed);
+    std::string difference = compare_summaries(replayed, record);
+    if (!difference.empty()) {
+        return diverged(turn, difference);
+    }
+    return true;
+}
+
+void GameColumns::reserve_rows(size_t count) {
+    size_t padded = (count + BLOCK - 1) / BLOCK * BLOCK;
+    if (padded > player_count.size()) {
+        for_each_column([padded](auto& column) { column.resize(padded); });
+    }
+}
+
+size_t GameColumns::row_bytes() {
+    size_t bytes = 0;
+    GameColumns().for_each_column([&bytes](auto& column) { bytes += sizeof(column[0]); });
+    return bytes;
+}
+
+void GameColumns::append(const ArchivedGame& game) {
+    reserve_rows(rows + 1);
+    player_count[rows] = game.player_count;
+    winner[rows] = game.winner;
+    turns[rows] = game.turns;
+    for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+        roles[seat][rows] = game.roles[seat];
+        final_coins[seat][rows] = game.final_coins[seat];
+        first_sanctioned[seat][rows] = game.first_sanctioned[seat];
+    }
+    for (int action = 0; action < ACTION_TYPE_COUNT; ++action) {
+        action_counts[action][rows] = game.action_counts[action];
+    }
+    rows++;
+}
+
+void GameColumns::clear() {
+    for_each_column([](auto& column) { column.clear(); });
+    rows = 0;
+}
+
+void GameColumns::select(const GameFilter& filter, size_t start, uint8_t keep[BLOCK]) const {
+    // Bitwise rather than logical operators keep the loops free of branches
+    const uint8_t* players = &player_count[start];
+    const uint16_t* length = &turns[start];
+    uint8_t any_players = filter.players == 0;
+    for (size_t i = 0; i < BLOCK; ++i) {
+        keep[i] = (players[i] != 0) & (any_players | (players[i] == filter.players)) &
+                  (length[i] >= filter.min_turns) & (length[i] <= filter.max_turns);
+    }
+    if (filter.with_role >= 0) {
+        uint8_t present[BLOCK] = {};
+        for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+            const int8_t* role = &roles[seat][start];
+            for (size_t i = 0; i < BLOCK; ++i) {
+                present[i] |= role[i] == filter.with_role;
+            }
+        }
+        for (size_t i = 0; i < BLOCK; ++i) {
+            keep[i] &= present[i];
+        }
+    }
+    if (filter.action >= 0) {
+        const uint16_t* counts = &action_counts[filter.action][start];
+        for (size_t i = 0; i < BLOCK; ++i) {
+            keep[i] &= counts[i] >= filter.min_action_count;
+        }
+    }
+    if (filter.min_final_coins != INT16_MIN || filter.max_final_coins != INT16_MAX) {
+        uint8_t in_range[BLOCK] = {};
+        for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+            const int8_t* role = &roles[seat][start];
+            const int16_t* coins = &final_coins[seat][start];
+            for (size_t i = 0; i < BLOCK; ++i) {
+                in_range[i] |= (role[i] >= 0) & (coins[i] >= filter.min_final_coins) &
+                               (coins[i] <= filter.max_final_coins);
+            }
+        }
+        for (size_t i = 0; i < BLOCK; ++i) {
+            keep[i] &= in_range[i];
+        }
+    }
+}
+
+uint64_t GameColumns::count(const GameFilter& filter) const {
+    uint64_t total = 0;
+    uint8_t keep[BLOCK];
+    for (size_t start = 0; start < rows; start += BLOCK) {
+        select(filter, start, keep);
+        uint32_t matches = 0;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            matches += keep[i];
+        }
+        total += matches;
+    }
+    return total;
+}
+
+double GameColumns::mean_turns(const GameFilter& filter) const {
+    uint64_t games = 0;
+    uint64_t total = 0;
+    uint8_t keep[BLOCK];
+    for (size_t start = 0; start < rows; start += BLOCK) {
+        select(filter, start, keep);
+        const uint16_t* length = &turns[start];
+        uint32_t matches = 0;
+        uint32_t sum = 0;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            matches += keep[i];
+            sum += keep[i] * length[i];
+        }
+        games += matches;
+        total += sum;
+    }
+    return games ? static_cast<double>(total) / games : 0.0;
+}
+
+RoleStats GameColumns::role_stats(RoleType role, const GameFilter& filter, uint16_t sanctioned_before) const {
+    RoleStats stats;
+    uint8_t keep[BLOCK];
+    int8_t wanted = static_cast<int8_t>(role);
+    uint8_t any_sanction = sanctioned_before == NEVER_SANCTIONED;
+    for (size_t start = 0; start < rows; start += BLOCK) {
+        select(filter, start, keep);
+        const int8_t* won = &winner[start];
+        uint32_t seats = 0;
+        uint32_t wins = 0;
+        for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+            const int8_t* held = &roles[seat][start];
+            const uint16_t* sanctioned = &first_sanctioned[seat][start];
+            for (size_t i = 0; i < BLOCK; ++i) {
+                uint8_t hit = keep[i] & (held[i] == wanted) & (any_sanction | (sanctioned[i] < sanctioned_before));
+                seats += hit;
+                wins += hit & (won[i] == seat);
+            }
+        }
+        stats.seats += seats;
+        stats.wins += wins;
+    }
+    return stats;
+}
+
+bool BlockSummary::may_match(const GameFilter& filter) const {
+    if (filter.with_role >= 0 && !((present >> filter.with_role) & 1)) {
+        return false;
+    }
+    if (filter.action >= 0 && filter.min_action_count > 0 && !((present >> (8 + filter.action)) & 1)) {
+        return false;
+    }
+    return filter.min_turns <= max_turns && filter.max_turns >= min_turns && filter.min_final_coins <= max_coins &&
+           filter.max_final_coins >= min_coins;
+}
+
+ArchiveWriter::ArchiveWriter(const std::string& path, const GameRules& rules, size_t games_per_block)
+    : file(std::fopen(path.c_str(), "wb")), block_games(games_per_block) {
+    if (!file) {
+        throw std::runtime_error("Cannot create archive " + path);
+    }
+    if (block_games == 0) {
+        std::fclose(file);
+        throw std::invalid_argument("Archive blocks need at least one game");
+    }
+    std::vector<uint8_t> header;
+    put(header, ARCHIVE_MAGIC);
+    put(header, rules);
+    if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        std::fclose(file);
+        throw std::runtime_error("Failed writing archive " + path);
+    }
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (file) {
+        try {
+            close();
+        } catch (const std::runtime_error&) {
+            // Destructors cannot report a failed write; call close() to see it
+        }
+    }
+}
+
+void ArchiveWriter::add(const ArchivedGame& game) {
+    if (game.replay.size() != game.turns) {
+        throw std::invalid_argument("Archived game replay does not match its turn count");
+    }
+    if (game.checksums.size() != game.replay.size()) {
+        throw std::invalid_argument("Archived game needs one checksum per turn");
+    }
+    pending.push_back(game);
+    if (pending.size() >= block_games) {
+        write_block();
+    }
+}
+
+void ArchiveWriter::write_block() {
+    // [u32 bytes after this field][u32 games][summary][each column][u32 replay offsets, games + 1]
+    // [turns][u16 checksums, one per turn]
+    GameColumns columns;
+    BlockSummary summary{0, 0xffff, 0, INT16_MAX, INT16_MIN};
+    for (const ArchivedGame& game : pending) {
+        columns.append(game);
+        summary.min_turns = std::min(summary.min_turns, game.turns);
+        summary.max_turns = std::max(summary.max_turns, game.turns);
+        for (int seat = 0; seat < game.player_count; ++seat) {
+            summary.present |= uint64_t(1) << game.roles[seat];
+            summary.min_coins = std::min(summary.min_coins, game.final_coins[seat]);
+            summary.max_coins = std::max(summary.max_coins, game.final_coins[seat]);
+        }
+        for (int action = 0; action < ACTION_TYPE_COUNT; ++action) {
+            if (game.action_counts[action] > 0) {
+                summary.present |= uint64_t(1) << (8 + action);
+            }
+        }
+    }
+    uint32_t count = static_cast<uint32_t>(pending.size());
+    std::vector<uint8_t> block(sizeof(uint32_t));
+    put(block, count);
+    put(block, summary);
+    columns.for_each_column([&block, count](auto& column) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(column.data());
+        block.insert(block.end(), bytes, bytes + count * sizeof(column[0]));
+    });
+    uint32_t offset = 0;
+    for (const ArchivedGame& game : pending) {
+        put(block, offset);
+        offset += static_cast<uint32_t>(game.replay.size());
+    }
+    put(block, offset);
+    for (const ArchivedGame& game : pending) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(game.replay.data());
+        block.insert(block.end(), bytes, bytes + game.replay.size() * sizeof(RecordedTurn));
+    }
+    for (const ArchivedGame& game : pending) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(game.checksums.data());
+        block.insert(block.end(), bytes, bytes + game.checksums.size() * sizeof(uint16_t));
+    }
+    uint32_t size = static_cast<uint32_t>(block.size() - sizeof(uint32_t));
+    std::memcpy(block.data(), &size, sizeof(size));
+
+    pending.clear();
+    if (std::fwrite(block.data(), 1, block.size(), file) != block.size()) {
+        throw std::runtime_error("Failed writing archive block");
+    }
+}
+
+void ArchiveWriter::close() {
+    if (!file) {
+        return;
+    }
+    bool ok = true;
+    try {
+        if (!pending.empty()) {
+            write_block();
+        }
+    } catch (const std::runtime_error&) {
+        ok = false;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    if (!ok) {
+        throw std::runtime_error("Failed writing archive");
+    }
+}
+
+ArchiveReader::ArchiveReader(const std::string& path) : mapping(nullptr), mapping_size(0), games(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open archive " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < HEADER_BYTES) {
+        ::close(fd);
+        throw std::runtime_error("Not an archive: " + path);
+    }
+    mapping_size = static_cast<size_t>(info.st_size);
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Cannot map archive " + path);
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping);
+    if (get<uint32_t>(data) != ARCHIVE_MAGIC) {
+        ::munmap(mapping, mapping_size);
+        throw std::runtime_error("Not an archive: " + path);
+    }
+    rules = get<GameRules>(data + sizeof(ARCHIVE_MAGIC));
+
+    // Check every block's framing up front so reads never run past the mapping
+    size_t row_bytes = GameColumns::row_bytes();
+    size_t offset = HEADER_BYTES;
+    while (offset < mapping_size) {
+        size_t left = mapping_size - offset;
+        uint32_t size = left >= 8 ? get<uint32_t>(data + offset) : 0;
+        uint32_t count = left >= 8 ? get<uint32_t>(data + offset + 4) : 0;
+        size_t fixed = sizeof(uint32_t) + sizeof(BlockSummary) + static_cast<size_t>(count) * (row_bytes + sizeof(uint32_t)) +
+                       sizeof(uint32_t);
+        bool intact = left >= 8 && size <= left - sizeof(uint32_t) && fixed <= size;
+        if (intact) {
+            uint32_t turns = get<uint32_t>(data + offset + 4 + fixed - sizeof(uint32_t));
+            intact = fixed + static_cast<size_t>(turns) * (sizeof(RecordedTurn) + sizeof(uint16_t)) == size;
+        }
+        if (!intact) {
+            ::munmap(mapping, mapping_size);
+            throw std::runtime_error("Corrupt archive block in " + path);
+        }
+        blocks.push_back(offset);
+        games += count;
+        offset += sizeof(uint32_t) + size;
+    }
+}
+
+ArchiveReader::~ArchiveReader() {
+    if (mapping) {
+        ::munmap(mapping, mapping_size);
+    }
+}
+
+BlockSummary ArchiveReader::summary(size_t block) const {
+    return get<BlockSummary>(static_cast<const uint8_t*>(mapping) + blocks.at(block) + 2 * sizeof(uint32_t));
+}
+
+const uint8_t* ArchiveReader::block_data(size_t block, uint32_t& count) const {
+    const uint8_t* data = static_cast<const uint8_t*>(mapping) + blocks.at(block);
+    count = get<uint32_t>(data + sizeof(uint32_t));
+    return data + 2 * sizeof(uint32_t) + sizeof(BlockSummary);
+}
+
+void ArchiveReader::append_block(size_t block, GameColumns& columns) const {
+    uint32_t count;
+    const uint8_t* at = block_data(block, count);
+    size_t first = columns.rows;
+    columns.reserve_rows(first + count);
+    columns.for_each_column([&at, first, count](auto& column) {
+        std::memcpy(&column[first], at, count * sizeof(column[0]));
+        at += count * sizeof(column[0]);
+    });
+    columns.rows += count;
+}
+
+size_t ArchiveReader::load_columns(GameColumns& columns, const GameFilter& filter) const {
+    size_t loaded = 0;
+    for (size_t block = 0; block < blocks.size(); ++block) {
+        if (summary(block).may_match(filter)) {
+            append_block(block, columns);
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+void ArchiveReader::read_block(size_t block, std::vector<ArchivedGame>& out) const {
+    uint32_t count;
+    const uint8_t* at = block_data(block, count);
+    GameColumns columns;
+    append_block(block, columns);
+    at += static_cast<size_t>(count) * GameColumns::row_bytes();
+    const uint8_t* offsets = at;
+    const uint8_t* turns = offsets + (count + 1) * sizeof(uint32_t);
+    const uint8_t* checksums = turns + get<uint32_t>(offsets + count * sizeof(uint32_t)) * sizeof(RecordedTurn);
+
+    out.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        ArchivedGame& game = out[i];
+        game.player_count = columns.player_count[i];
+        game.winner = columns.winner[i];
+        game.turns = columns.turns[i];
+        for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+            game.roles[seat] = columns.roles[seat][i];
+            game.final_coins[seat] = columns.final_coins[seat][i];
+            game.first_sanctioned[seat] = columns.first_sanctioned[seat][i];
+        }
+        for (int action = 0; action < ACTION_TYPE_COUNT; ++action) {
+            game.action_counts[action] = columns.action_counts[action][i];
+        }
+        uint32_t begin = get<uint32_t>(offsets + i * sizeof(uint32_t));
+        uint32_t end = get<uint32_t>(offsets + (i + 1) * sizeof(uint32_t));
+        if (begin > end || end > get<uint32_t>(offsets + count * sizeof(uint32_t))) {
+            throw std::runtime_error("Corrupt archive replay offsets");
+        }
+        game.replay.resize(end - begin);
+        std::memcpy(game.replay.data(), turns + begin * sizeof(RecordedTurn), (end - begin) * sizeof(RecordedTurn));
+        game.checksums.resize(end - begin);
+        std::memcpy(game.checksums.data(), checksums + begin * sizeof(uint16_t), (end - begin) * sizeof(uint16_t));
+    }
+}
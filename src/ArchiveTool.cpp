@@ -0,0 +1,139 @@
+// yaacovkrawiec@gmail.com
+
+// Replay archive generator and query tool.
+// With --out it plays games between random players with random roles and archives them;
+// --per-table N plays N games with each random table, so blocks hold similar games.
+// With --in it loads the summary columns of the blocks that may match the filters (the
+// others are skipped by their block summaries) and reports, for the matching games, their
+// number, their mean length and every role's win rate.
+//
+// Examples:
+//   ./coup_archive --out games.cga --games 1000000 --players 4
+//   ./coup_archive --in games.cga --sanctioned-before 10
+//   ./coup_archive --out tables.cga --games 1000000 --players 3 --per-table 4096
+//   ./coup_archive --in tables.cga --with General --min-turns 200
+
+#include "../include/Archive.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char* ROLE_NAMES[] = {"Governor", "Spy", "Baron", "General", "Judge", "Merchant"};
+
+int8_t parse_role(const std::string& name) {
+    for (int r = 0; r < 6; ++r) {
+        if (name == ROLE_NAMES[r]) return static_cast<int8_t>(r);
+    }
+    throw std::invalid_argument("Unknown role " + name);
+}
+
+void print_usage() {
+    std::cerr << "Usage: coup_archive --out FILE [--games N] [--players N] [--per-table N] [--turn-limit N]\n"
+              << "                    [--seed N]\n"
+              << "       coup_archive --in FILE [--players N] [--min-turns N] [--max-turns N]\n"
+              << "                    [--with ROLE] [--min-coins N] [--max-coins N] [--sanctioned-before TURN]\n"
+              << "Roles: Governor Spy Baron General Judge Merchant\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string output;
+    std::string input;
+    long games = 100000;
+    int players = 4;                     // Generated seats; a filter only when given
+    int turn_limit = 1000;
+    long per_table = 1;
+    uint64_t seed = 1;
+    GameFilter filter;
+    uint16_t sanctioned_before = NEVER_SANCTIONED;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--out") output = next();
+            else if (arg == "--in") input = next();
+            else if (arg == "--games") games = std::stol(next());
+            else if (arg == "--players") filter.players = static_cast<uint8_t>(players = std::stoi(next()));
+            else if (arg == "--per-table") per_table = std::max(1L, std::stol(next()));
+            else if (arg == "--turn-limit") turn_limit = std::stoi(next());
+            else if (arg == "--seed") seed = std::stoull(next());
+            else if (arg == "--min-turns") filter.min_turns = static_cast<uint16_t>(std::stoi(next()));
+            else if (arg == "--max-turns") filter.max_turns = static_cast<uint16_t>(std::stoi(next()));
+            else if (arg == "--with") filter.with_role = parse_role(next());
+            else if (arg == "--min-coins") filter.min_final_coins = static_cast<int16_t>(std::stoi(next()));
+            else if (arg == "--max-coins") filter.max_final_coins = static_cast<int16_t>(std::stoi(next()));
+            else if (arg == "--sanctioned-before") sanctioned_before = static_cast<uint16_t>(std::stoi(next()));
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (output.empty() == input.empty()) {
+            throw std::invalid_argument("Give exactly one of --out and --in");
+        }
+        if (players < 2 || players > 6) {
+            throw std::invalid_argument("--players must be 2 to 6");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    try {
+        if (!output.empty()) {
+            GameRules rules = GameRules::defaults();
+            ArchiveWriter writer(output, rules);
+            std::mt19937_64 rng(seed);
+            std::vector<RoleType> roles;
+            for (long g = 0; g < games; ++g) {
+                if (g % per_table == 0) {
+                    roles.clear();
+                    for (int seat = 0; seat < players; ++seat) {
+                        roles.push_back(static_cast<RoleType>(rng() % 6));
+                    }
+                }
+                writer.add(play_archived_game(rules, roles, rng, turn_limit));
+            }
+            writer.close();
+            std::cout << "archived " << games << " games to " << output << "\n";
+            return 0;
+        }
+
+        ArchiveReader reader(input);
+        GameColumns columns;
+        size_t blocks = reader.load_columns(columns, filter);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t matching = columns.count(filter);
+        double mean = columns.mean_turns(filter);
+        RoleStats stats[6];
+        for (int r = 0; r < 6; ++r) {
+            stats[r] = columns.role_stats(static_cast<RoleType>(r), filter, sanctioned_before);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "blocks read: " << blocks << " of " << reader.block_count() << "\n"
+                  << "games:       " << matching << " of " << reader.game_count() << "\n"
+                  << "mean turns:  " << std::fixed << std::setprecision(1) << mean << "\n";
+        for (int r = 0; r < 6; ++r) {
+            std::cout << std::left << std::setw(13) << ROLE_NAMES[r] << std::right << std::setprecision(3)
+                      << stats[r].win_rate() << "  (" << stats[r].wins << " / " << stats[r].seats << ")\n";
+        }
+        // Eight scans: the count, the mean and one per role
+        std::cout << "scan rate:   " << std::setprecision(0) << (seconds > 0 ? 8 * columns.size() / seconds : 0)
+                  << " games/second\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+// yaacovkrawiec@gmail.com
+
+// ISMCTS benchmark.
+// Plays hidden-role games with an ISMCTS bot in seat 1 against uniformly random players
+// and reports the bot's win rate and search throughput.
+//
+// Example:
+//   ./coup_bot --roles Governor,Baron,Judge --games 20 --iterations 2000 --hide-coins
+
+#include "../include/Ismcts.hpp"
+#include "../include/Player.hpp"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* ROLE_NAMES[] = {"Governor", "Spy", "Baron", "General", "Judge", "Merchant"};
+
+std::vector<RoleType> parse_roles(const std::string& list) {
+    std::vector<RoleType> roles;
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        bool found = false;
+        for (int r = 0; r < 6; ++r) {
+            if (name == ROLE_NAMES[r]) {
+                roles.push_back(static_cast<RoleType>(r));
+                found = true;
+            }
+        }
+        if (!found) {
+            throw std::invalid_argument("Unknown role " + name);
+        }
+    }
+    return roles;
+}
+
+void print_usage() {
+    std::cerr << "Usage: coup_bot --roles R1,R2[,...] [--games N] [--iterations N] [--threads N]\n"
+              << "                [--hide-coins] [--max-turns N] [--seed N]\n"
+              << "Roles: Governor Spy Baron General Judge Merchant\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<RoleType> roles;
+    IsmctsOptions options;
+    int games = 10;
+    int max_turns = 300;
+    bool hide_coins = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--roles") roles = parse_roles(next());
+            else if (arg == "--games") games = std::stoi(next());
+            else if (arg == "--iterations") options.iterations = std::stoi(next());
+            else if (arg == "--threads") options.threads = std::stoi(next());
+            else if (arg == "--hide-coins") hide_coins = true;
+            else if (arg == "--max-turns") max_turns = std::stoi(next());
+            else if (arg == "--seed") options.seed = std::stoull(next());
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (roles.size() < 2 || roles.size() > 6) {
+            throw std::invalid_argument("--roles needs 2 to 6 roles");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    IsmctsBot bot(options);
+    std::mt19937_64 rng(options.seed);
+    int wins = 0;
+    int finished = 0;
+    uint64_t iterations = 0;
+    double seconds = 0;
+    try {
+        for (int g = 0; g < games; ++g) {
+            Game game;
+            for (size_t i = 0; i < roles.size(); ++i) {
+                auto player = std::make_shared<Player>("P" + std::to_string(i + 1));
+                player->set_role(make_role(roles[i]));
+                game.add_player(player);
+            }
+            game.set_hidden_information(true, hide_coins);
+            game.start_game();
+
+            for (int turn = 0; turn < max_turns && game.is_game_active(); ++turn) {
+                std::vector<Move> moves = legal_moves(game);
+                if (moves.empty()) {
+                    game.next_turn();
+                } else if (game.get_current_player_index() == 0) {
+                    IsmctsReport report;
+                    apply_move(game, bot.choose_move(game, &report));
+                    iterations += report.iterations;
+                    seconds += report.seconds;
+                } else {
+                    apply_move(game, moves[rng() % moves.size()]);
+                }
+            }
+
+            if (!game.is_game_active()) {
+                finished++;
+                wins += game.get_player_at(0)->is_player_active();
+            }
+            std::cout << "game " << g + 1 << ": "
+                      << (game.is_game_active() ? "unfinished" : game.winner() + " wins") << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "\nbot wins:           " << wins << " / " << finished << " finished games\n"
+              << "random baseline:    " << std::fixed << std::setprecision(3) << 1.0 / roles.size() << "\n"
+              << "search iterations:  " << iterations << "\n"
+              << "iterations/second:  " << std::setprecision(0) << (seconds > 0 ? iterations / seconds : 0) << "\n";
+    return 0;
+}
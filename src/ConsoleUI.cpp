@@ -3,6 +3,8 @@
 #include "../include/Game.hpp"
 #include "../include/Player.hpp"
 #include "../include/Role.hpp"
+#include "../include/PlayerView.hpp"
+#include "../include/TurnPipeline.hpp"
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -10,10 +12,12 @@
 #include <limits>
 #include <iomanip>
 
-class ConsoleUI {
+class ConsoleUI : public SeatInput {
 private:
     Game game;
     std::vector<std::shared_ptr<Player>> players;
+    std::string last_message;           // Outcome of the previous move
+    std::string last_color;
     
     // Display separator line
     void print_line(char c = '-', int width = 50) {
@@ -47,12 +51,15 @@ private:
         print_line('=', 50);
     }
     
-    // Display player status
+    // Display player status as seen by the player whose turn it is (everything once the game is over)
     void display_players() {
         std::cout << "\n";
         print_colored("PLAYERS STATUS:\n", "cyan");
         print_line();
         
+        PlayerView view(game, game.get_current_player_index());
+        bool reveal_all = !game.is_game_active();
+        
         for (size_t i = 0; i < players.size(); ++i) {
             std::cout << std::setw(2) << i + 1 << ". ";
             
@@ -64,18 +71,24 @@ private:
             } else {
                 // Coins
                 std::cout << " | Coins: ";
+                int coins = reveal_all ? players[i]->get_coins() : view.coins(i);
+                std::string coin_text = coins == PlayerView::HIDDEN ? "?" : std::to_string(coins);
                 std::string coin_color = "white";
-                if (players[i]->get_coins() >= 10) coin_color = "red";
-                else if (players[i]->get_coins() >= 7) coin_color = "yellow";
-                else if (players[i]->get_coins() >= 4) coin_color = "green";
+                if (coins >= 10) coin_color = "red";
+                else if (coins >= 7) coin_color = "yellow";
+                else if (coins >= 4) coin_color = "green";
                 
-                print_colored(std::to_string(players[i]->get_coins()), coin_color);
-                std::cout << std::setw(3 - std::to_string(players[i]->get_coins()).length()) << "";
+                print_colored(coin_text, coin_color);
+                std::cout << std::setw(3 - coin_text.length()) << "";
                 
                 // Role
                 if (players[i]->get_role()) {
                     std::cout << " | ";
-                    print_colored(players[i]->get_role()->get_name(), "magenta");
+                    if (reveal_all || view.is_role_visible(i)) {
+                        print_colored(players[i]->get_role()->get_name(), "magenta");
+                    } else {
+                        print_colored("???", "magenta");
+                    }
                 }
                 
                 // Status
@@ -117,11 +130,14 @@ private:
         
         std::vector<Player*> valid_targets;
         int index = 1;
+        PlayerView view(game, game.get_current_player_index());
         
-        for (auto& player : players) {
+        for (size_t seat = 0; seat < players.size(); ++seat) {
+            auto& player = players[seat];
             if (player->is_player_active() && player.get() != current) {
+                int coins = view.coins(seat);
                 std::cout << index << ". " << player->get_name() 
-                         << " (" << player->get_coins() << " coins)\n";
+                         << " (" << (coins == PlayerView::HIDDEN ? "?" : std::to_string(coins)) << " coins)\n";
                 valid_targets.push_back(player.get());
                 index++;
             }
@@ -137,6 +153,20 @@ private:
         return valid_targets[choice - 1];
     }
     
+    // Reaction window question for one eligible blocker
+    bool ask_block(int seat) {
+        static const char* ACTION_NAMES[] = {"gather", "tax", "bribe", "arrest", "sanction", "coup"};
+        const ActionRecord& action = game.get_action_history().back();
+        print_colored("\n" + players[seat]->get_name() + ", block " + action.actor->get_name() + "'s " +
+                      ACTION_NAMES[static_cast<int>(action.action)] + "? (1 = yes, 0 = no): ", "yellow");
+        bool block = get_input(0, 1) == 1;
+        if (block) {
+            last_message += " Blocked by " + players[seat]->get_name() + ".";
+            last_color = "red";
+        }
+        return block;
+    }
+    
     // Display action menu
     void display_menu() {
         auto current = game.get_current_player();
@@ -185,99 +215,114 @@ private:
                 print_colored(std::to_string(option++) + ". Invest (Baron: 3 coins -> 6 coins)\n", "magenta");
             }
         }
+        if (current->get_role() && current->get_role()->get_type() == RoleType::SPY && game.are_coins_hidden()) {
+            print_colored(std::to_string(option++) + ". Spy (See a player's coins - free)\n", "magenta");
+        }
         
         print_line();
         std::cout << "0. Exit Game\n";
         std::cout << "\nYour choice: ";
     }
     
-    // Process action
-    bool process_action(int choice) {
+    // Seat index of a target chosen from the target menu, -1 if there is none
+    int select_target_seat(Player* current) {
+        Player* target = select_target(current);
+        return target ? seat_of(game, target) : -1;
+    }
+    
+    // Turns a menu choice into a move. Returns false when the choice does not end the turn
+    // (an invalid choice, a missing target or the Spy's free look at a player's coins).
+    bool choose_move(int choice, Move& move) {
         auto current = game.get_current_player();
-        if (!current) return false;
+        std::string name = current->get_name();
+        int actual_choice = 1;
+        last_color = "green";
         
-        try {
-            bool action_performed = false;
-            
-            // Map choice to actual action based on available options
-            int actual_choice = 1;
-            
-            if (choice == 0) return false;
-            
-            if (choice == actual_choice++) { // Gather
-                current->gather(game);
-                print_colored("\n✓ " + current->get_name() + " gathered 1 coin.\n", "green");
-                action_performed = true;
-            }
-            else if (choice == actual_choice++) { // Tax
-                current->tax(game);
-                print_colored("\n✓ " + current->get_name() + " used tax.\n", "green");
-                action_performed = true;
-            }
-            else if (choice == actual_choice++) { // Arrest
-                Player* target = select_target(current.get());
-                if (target) {
-                    current->arrest(*target, game);
-                    print_colored("\n✓ " + current->get_name() + " arrested " + 
-                                target->get_name() + ".\n", "green");
-                    action_performed = true;
-                }
-            }
-            else if (current->get_coins() >= 3 && choice == actual_choice++) { // Sanction
-                Player* target = select_target(current.get());
-                if (target) {
-                    current->sanction(*target, game);
-                    print_colored("\n✓ " + current->get_name() + " sanctioned " + 
-                                target->get_name() + ".\n", "green");
-                    action_performed = true;
-                }
-            }
-            else if (current->get_coins() >= 4 && choice == actual_choice++) { // Bribe
-                current->bribe(game);
-                print_colored("\n✓ " + current->get_name() + " paid bribe for extra turn.\n", "green");
-                return true; // Don't advance turn
-            }
-            else if (current->get_coins() >= 7 && choice == actual_choice++) { // Coup
-                Player* target = select_target(current.get());
-                if (target) {
-                    current->coup(*target, game);
-                    game.eliminate_player(target);
-                    print_colored("\n✓ " + current->get_name() + " performed COUP on " + 
-                                target->get_name() + "!\n", "yellow");
-                    action_performed = true;
-                }
+        if (choice == actual_choice++) { // Gather
+            move = Move(MoveType::GATHER);
+            last_message = "✓ " + name + " gathered 1 coin.";
+        }
+        else if (choice == actual_choice++) { // Tax
+            move = Move(MoveType::TAX);
+            last_message = "✓ " + name + " used tax.";
+        }
+        else if (choice == actual_choice++) { // Arrest
+            move = Move(MoveType::ARREST, select_target_seat(current.get()));
+            if (move.target < 0) return false;
+            last_message = "✓ " + name + " arrested " + players[move.target]->get_name() + ".";
+        }
+        else if (current->get_coins() >= 3 && choice == actual_choice++) { // Sanction
+            move = Move(MoveType::SANCTION, select_target_seat(current.get()));
+            if (move.target < 0) return false;
+            last_message = "✓ " + name + " sanctioned " + players[move.target]->get_name() + ".";
+        }
+        else if (current->get_coins() >= 4 && choice == actual_choice++) { // Bribe
+            move = Move(MoveType::BRIBE);
+            last_message = "✓ " + name + " paid bribe for extra turn.";
+        }
+        else if (current->get_coins() >= 7 && choice == actual_choice++) { // Coup
+            move = Move(MoveType::COUP, select_target_seat(current.get()));
+            if (move.target < 0) return false;
+            last_message = "✓ " + name + " performed COUP on " + players[move.target]->get_name() + "!";
+            last_color = "yellow";
+        }
+        else if (current->get_role() && current->get_role()->get_type() == RoleType::BARON &&
+                current->get_coins() >= 3 && choice == actual_choice++) { // Baron invest
+            move = Move(MoveType::INVEST);
+            last_message = "✓ " + name + " (Baron) invested 3 coins and got 6 back.";
+        }
+        else if (current->get_role() && current->get_role()->get_type() == RoleType::SPY &&
+                game.are_coins_hidden() && choice == actual_choice++) { // Spy on coins
+            auto spy = std::dynamic_pointer_cast<Spy>(current->get_role());
+            Player* target = select_target(current.get());
+            if (spy && target) {
+                int coins = spy->see_coins(*current, *target, game);
+                print_colored("\n✓ " + target->get_name() + " has " + std::to_string(coins) + " coins.\n", "green");
+                std::cout << "\nPress Enter to continue...";
+                std::cin.get();
             }
-            else if (current->get_role() && current->get_role()->get_type() == RoleType::BARON &&
-                    current->get_coins() >= 3 && choice == actual_choice++) { // Baron invest
-                auto baron = std::dynamic_pointer_cast<Baron>(current->get_role());
-                if (baron) {
-                    baron->invest(*current);
-                    print_colored("\n✓ " + current->get_name() + " (Baron) invested 3 coins and got 6 back.\n", "green");
-                    action_performed = true;
-                }
+            return false;
+        }
+        else {
+            last_message = "Invalid choice!";
+            last_color = "red";
+            return false;
+        }
+        return true;
+    }
+    
+public:
+    // Every seat is played at this terminal, so each question is answered right away
+    bool answer(InputRequest& request) override {
+        if (request.kind == InputRequest::BLOCK) {
+            request.block = ask_block(request.seat);
+            return true;
+        }
+        
+        if (request.rejected) {
+            last_message = "✗ That move is not allowed right now.";
+            last_color = "red";
+        }
+        while (true) {
+            display_header();
+            display_players();
+            if (!last_message.empty()) {
+                print_colored(last_message + "\n", last_color);
             }
-            else {
-                print_colored("\nInvalid choice!\n", "red");
+            display_menu();
+            
+            int max_choice = 7; // Adjust based on available actions
+            int choice = get_input(0, max_choice);
+            if (choice == 0) {
+                request.quit = true;
                 return true;
             }
-            
-            if (action_performed) {
-                game.next_turn();
+            if (choose_move(choice, request.move)) {
+                return true;
             }
-            
-            std::cout << "\nPress Enter to continue...";
-            std::cin.get();
-            
-        } catch (const std::exception& e) {
-            print_colored("\n✗ Error: " + std::string(e.what()) + "\n", "red");
-            std::cout << "Press Enter to continue...";
-            std::cin.get();
         }
-        
-        return true;
     }
     
-public:
     void run() {
         // Initialize game
         display_header();
@@ -289,6 +334,10 @@ public:
         std::cout << "Number of players (2-6): ";
         int num_players = get_input(2, 6);
         
+        std::cout << "Hidden information (0 = open, 1 = hide roles, 2 = hide roles and coins): ";
+        int hidden = get_input(0, 2);
+        game.set_hidden_information(hidden >= 1, hidden == 2);
+        
         std::cout << "\n";
         print_colored("Available Roles:\n", "yellow");
         std::cout << "1. Governor - Tax gives 3 coins, can block tax\n";
@@ -327,17 +376,10 @@ public:
         
         game.start_game();
         
-        // Game loop
-        bool running = true;
-        while (running && game.is_game_active()) {
-            display_header();
-            display_players();
-            display_menu();
-            
-            int max_choice = 7; // Adjust based on available actions
-            int choice = get_input(0, max_choice);
-            running = process_action(choice);
-        }
+        // Game loop: the pipeline asks this console for every move and block
+        TurnPipeline pipeline;
+        pipeline.add_game(game, std::vector<SeatInput*>(players.size(), this));
+        pipeline.run();
         
         // Game over
         if (!game.is_game_active()) {
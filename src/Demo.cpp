@@ -85,9 +85,8 @@ int main() {
     
     // Bob uses Baron's invest ability
     if (bob->get_coins() >= 3) {
-        auto baron = std::dynamic_pointer_cast<Baron>(bob->get_role());
-        if (baron) {
-            baron->invest(*bob);
+        if (std::dynamic_pointer_cast<Baron>(bob->get_role())) {
+            game.invest(bob.get());
             std::cout << "Bob (Baron) invests 3 coins and gets 6 back" << std::endl;
             std::cout << "Bob coins after invest: " << bob->get_coins() << std::endl;
         }
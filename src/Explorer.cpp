@@ -0,0 +1,700 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Explorer.hpp"
+#include "../include/Player.hpp"
+#include "../include/Simulator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int SEAT_BITS = 10;
+const uint64_t NO_TARGET = 7;
+
+uint64_t mix_key(uint64_t key) {
+    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+// Runs work(t) for t in [0, thread_count), t = 0 on the calling thread, and rethrows the
+// first failure once every worker is done
+void run_workers(size_t thread_count, const std::function<void(size_t)>& work) {
+    std::exception_ptr failure;
+    std::mutex failure_mutex;
+    auto guarded = [&](size_t t) {
+        try {
+            work(t);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+            if (!failure) failure = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; ++t) {
+        workers.emplace_back(guarded, t);
+    }
+    guarded(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+} // namespace
+
+StateCodec::StateCodec(const std::vector<RoleType>& seat_roles) : roles(seat_roles) {
+    if (roles.size() < 2 || roles.size() > (size_t)MAX_PLAYERS) {
+        throw std::invalid_argument("Exploration needs 2-6 players");
+    }
+}
+
+bool StateCodec::encode(const GameState& state, uint64_t& key) const {
+    key = 0;
+    for (size_t i = 0; i < roles.size(); ++i) {
+        const PlayerState& ps = state.players[i];
+        if (!ps.active) {
+            continue;
+        }
+        if (ps.coins < 0 || ps.coins > MAX_COINS) {
+            return false;
+        }
+        uint64_t target = NO_TARGET;
+        if (ps.last_arrested >= 0 && state.players[ps.last_arrested].active) {
+            target = ps.last_arrested;
+        }
+        uint64_t seat = (uint64_t)ps.coins | (1ULL << 5) | ((uint64_t)ps.sanctioned << 6) | (target << 7);
+        key |= seat << (i * SEAT_BITS);
+    }
+    key |= (uint64_t)state.current_player << 60;
+    key |= (uint64_t)state.extra_turn << 63;
+    return true;
+}
+
+GameState StateCodec::decode(uint64_t key) const {
+    GameState state{};
+    state.player_count = static_cast<uint8_t>(roles.size());
+    state.current_player = static_cast<uint8_t>((key >> 60) & 7);
+    state.extra_turn = (key >> 63) & 1;
+
+    int active_count = 0;
+    for (size_t i = 0; i < roles.size(); ++i) {
+        uint64_t seat = (key >> (i * SEAT_BITS)) & ((1ULL << SEAT_BITS) - 1);
+        PlayerState& ps = state.players[i];
+        ps.role = static_cast<int8_t>(roles[i]);
+        ps.coins = static_cast<int32_t>(seat & 31);
+        ps.active = (seat >> 5) & 1;
+        ps.sanctioned = (seat >> 6) & 1;
+        uint64_t target = (seat >> 7) & 7;
+        ps.last_arrested = target == NO_TARGET ? -1 : static_cast<int8_t>(target);
+        if (ps.active) {
+            active_count++;
+        }
+    }
+    state.game_active = active_count > 1;
+    return state;
+}
+
+ConcurrentStateSet::ConcurrentStateSet(size_t min_capacity) : count(0) {
+    size_t capacity = 1024;
+    while (capacity < min_capacity) {
+        capacity <<= 1;
+    }
+    slots.reset(new std::atomic<uint64_t>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+}
+
+bool ConcurrentStateSet::insert(uint64_t key) {
+    if (key == 0) {
+        throw std::invalid_argument("Zero is reserved for empty slots");
+    }
+    size_t index = mix_key(key) & mask;
+    for (size_t probe = 0; probe <= mask; ++probe) {
+        uint64_t current = slots[index].load(std::memory_order_relaxed);
+        if (current == key) {
+            return false;
+        }
+        if (current == 0) {
+            uint64_t expected = 0;
+            if (slots[index].compare_exchange_strong(expected, key, std::memory_order_relaxed)) {
+                // Keep a little headroom so probe chains stay short
+                if (count.fetch_add(1, std::memory_order_relaxed) + 1 > capacity() - capacity() / 8) {
+                    throw std::runtime_error("Visited set is full; raise the state capacity");
+                }
+                return true;
+            }
+            if (expected == key) {
+                return false;
+            }
+        }
+        index = (index + 1) & mask;
+    }
+    throw std::runtime_error("Visited set is full; raise the state capacity");
+}
+
+size_t ConcurrentStateSet::find(uint64_t key) const {
+    size_t index = mix_key(key) & mask;
+    for (size_t probe = 0; probe <= mask; ++probe) {
+        uint64_t current = slots[index].load(std::memory_order_relaxed);
+        if (current == key) return index;
+        if (current == 0) return capacity();
+        index = (index + 1) & mask;
+    }
+    return capacity();
+}
+
+void ExpansionCounters::merge(const ExpansionCounters& other) {
+    transitions += other.transitions;
+    terminal += other.terminal;
+    coin_overflows += other.coin_overflows;
+    rejected_moves += other.rejected_moves;
+    if (other.max_coins > max_coins) {
+        max_coins = other.max_coins;
+    }
+}
+
+StateExpander::StateExpander(const std::vector<RoleType>& roles, const GameRules& rules)
+    : codec(roles), game(rules) {
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("P" + std::to_string(i + 1), rules.starting_coins);
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.start_game();
+    // Only the record a block may undo is needed; restore_state does not clear the history
+    game.set_history_limit(1);
+}
+
+uint64_t StateExpander::initial_key() const {
+    uint64_t key;
+    if (!codec.encode(game.capture_state(), key)) {
+        throw std::runtime_error("Starting coins do not fit the state key");
+    }
+    return key;
+}
+
+void StateExpander::record(std::vector<uint64_t>& successors, ExpansionCounters& counters) {
+    GameState next = game.capture_state();
+    counters.transitions++;
+    for (size_t i = 0; i < next.player_count; ++i) {
+        if (next.players[i].coins > counters.max_coins) counters.max_coins = next.players[i].coins;
+    }
+    uint64_t key;
+    if (codec.encode(next, key)) {
+        successors.push_back(key);
+    } else {
+        counters.coin_overflows++;
+    }
+}
+
+void StateExpander::expand(uint64_t key, std::vector<uint64_t>& successors, ExpansionCounters& counters) {
+    GameState base = codec.decode(key);
+    if (!base.game_active) {
+        counters.terminal++;
+        return;
+    }
+
+    game.restore_state(base);
+    std::vector<Move> moves = legal_moves(game);
+    if (moves.empty()) {
+        // No legal move - the turn passes
+        game.next_turn();
+        record(successors, counters);
+        return;
+    }
+    for (const Move& move : moves) {
+        // The window asks blockers in order and the first willing one blocks, so every subset
+        // of willing blockers leads to the action standing or to one blocker's block
+        std::vector<Player*> blockers;
+        game.restore_state(base);
+        try {
+            play_action(game, move);
+            blockers = reaction_blockers(game, move);
+            complete_move(game, move);
+        } catch (const std::runtime_error&) {
+            // Coins never go below zero because Player refuses the payment; a legal move it
+            // refuses means legal_moves and the rules disagree
+            counters.rejected_moves++;
+            continue;
+        }
+        record(successors, counters);
+        for (size_t b = 0; b < blockers.size(); ++b) {
+            game.restore_state(base);
+            play_action(game, move);
+            game.resolve_block(reaction_blockers(game, move)[b]);
+            complete_move(game, move);
+            record(successors, counters);
+        }
+    }
+}
+
+StateExplorer::StateExplorer(const ExplorerOptions& explorer_options) : options(explorer_options) {
+}
+
+ExplorerReport StateExplorer::run(const std::function<void(const LevelStats&)>& on_level) {
+    size_t thread_count = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+
+    std::vector<std::unique_ptr<StateExpander>> expanders;
+    for (size_t t = 0; t < thread_count; ++t) {
+        expanders.push_back(std::make_unique<StateExpander>(options.roles, options.rules));
+    }
+
+    ConcurrentStateSet visited(options.max_states + options.max_states / 4);
+    ExplorerReport report;
+    std::vector<uint64_t> frontier = {expanders[0]->initial_key()};
+    visited.insert(frontier[0]);
+
+    const size_t CHUNK = 1024;
+    for (int level = 0; !frontier.empty(); ++level) {
+        if (options.max_levels >= 0 && level >= options.max_levels) {
+            break;
+        }
+        auto started = std::chrono::steady_clock::now();
+        std::atomic<size_t> cursor(0);
+        std::vector<std::vector<uint64_t>> next(thread_count);
+        std::vector<ExpansionCounters> counters(thread_count);
+        std::vector<uint64_t> revisits(thread_count, 0);
+
+        std::exception_ptr failure;
+        std::mutex failure_mutex;
+
+        // Workers claim chunks of the frontier and keep only successors they inserted first
+        auto expand_chunks = [&](size_t t) {
+            std::vector<uint64_t> successors;
+            size_t begin;
+            while ((begin = cursor.fetch_add(CHUNK)) < frontier.size()) {
+                size_t end = std::min(begin + CHUNK, frontier.size());
+                for (size_t i = begin; i < end; ++i) {
+                    successors.clear();
+                    expanders[t]->expand(frontier[i], successors, counters[t]);
+                    for (uint64_t successor : successors) {
+                        if (visited.insert(successor)) {
+                            next[t].push_back(successor);
+                        } else {
+                            revisits[t]++;
+                        }
+                    }
+                }
+            }
+        };
+        auto work = [&](size_t t) {
+            try {
+                expand_chunks(t);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (!failure) failure = std::current_exception();
+                cursor.store(frontier.size());
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < thread_count; ++t) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+
+        LevelStats stats{level, frontier.size(), 0, 0, 0, 0, 0.0};
+        std::vector<uint64_t> merged;
+        for (size_t t = 0; t < thread_count; ++t) {
+            merged.insert(merged.end(), next[t].begin(), next[t].end());
+            stats.transitions += counters[t].transitions;
+            stats.terminal += counters[t].terminal;
+            stats.revisits += revisits[t];
+            report.counters.merge(counters[t]);
+        }
+        stats.new_states = merged.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        report.levels.push_back(stats);
+        report.revisits += stats.revisits;
+        if (on_level) {
+            on_level(stats);
+        }
+        frontier.swap(merged);
+    }
+
+    report.states = visited.size();
+    report.complete = frontier.empty();
+    if (report.complete && options.check_cycles) {
+        report.cyclic_states = count_cyclic_states(visited, expanders);
+        report.cycles_checked = true;
+    }
+    return report;
+}
+
+uint64_t StateExplorer::count_cyclic_states(const ConcurrentStateSet& visited,
+                                            std::vector<std::unique_ptr<StateExpander>>& expanders) {
+    const size_t capacity = visited.capacity();
+    const size_t CHUNK = 1024;
+    std::unique_ptr<std::atomic<uint32_t>[]> in_degree(new std::atomic<uint32_t>[capacity]);
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        in_degree[slot].store(0, std::memory_order_relaxed);
+    }
+
+    // 1. Count the transitions into every state; successors that did not fit the key are not
+    //    in the set and are skipped
+    std::atomic<size_t> cursor(0);
+    run_workers(expanders.size(), [&](size_t t) {
+        std::vector<uint64_t> successors;
+        ExpansionCounters ignored;
+        size_t begin;
+        while ((begin = cursor.fetch_add(CHUNK)) < capacity) {
+            for (size_t slot = begin; slot < std::min(begin + CHUNK, capacity); ++slot) {
+                uint64_t key = visited.key_at(slot);
+                if (key == 0) continue;
+                successors.clear();
+                expanders[t]->expand(key, successors, ignored);
+                for (uint64_t successor : successors) {
+                    size_t target = visited.find(successor);
+                    if (target != capacity) in_degree[target].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    });
+    std::vector<uint64_t> layer;
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        if (visited.key_at(slot) != 0 && in_degree[slot].load(std::memory_order_relaxed) == 0) {
+            layer.push_back(slot);
+        }
+    }
+
+    // 2. Peel states without predecessors level by level; removing a state releases its
+    //    successors, and whatever is left can be revisited forever
+    uint64_t peeled = 0;
+    while (!layer.empty()) {
+        peeled += layer.size();
+        std::vector<std::vector<uint64_t>> next(expanders.size());
+        cursor.store(0);
+        run_workers(expanders.size(), [&](size_t t) {
+            std::vector<uint64_t> successors;
+            ExpansionCounters ignored;
+            size_t begin;
+            while ((begin = cursor.fetch_add(CHUNK)) < layer.size()) {
+                for (size_t i = begin; i < std::min(begin + CHUNK, layer.size()); ++i) {
+                    successors.clear();
+                    expanders[t]->expand(visited.key_at(layer[i]), successors, ignored);
+                    for (uint64_t successor : successors) {
+                        size_t target = visited.find(successor);
+                        if (target != capacity && in_degree[target].fetch_sub(1, std::memory_order_relaxed) == 1) {
+                            next[t].push_back(target);
+                        }
+                    }
+                }
+            }
+        });
+        layer.clear();
+        for (auto& part : next) {
+            layer.insert(layer.end(), part.begin(), part.end());
+        }
+    }
+    return visited.size() - peeled;
+}
+
+RunWriter::RunWriter(const std::string& path) : file(std::fopen(path.c_str(), "wb")), previous(0), count(0) {
+    if (!file) {
+        throw std::runtime_error("Cannot create run file " + path);
+    }
+    buffer.reserve(1 << 20);
+}
+
+RunWriter::~RunWriter() {
+    if (file) {
+        try {
+            close();
+        } catch (const std::runtime_error&) {
+            // Destructors cannot report a failed write; call close() to see it
+        }
+    }
+}
+
+void RunWriter::flush() {
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        throw std::runtime_error("Failed writing run file");
+    }
+    buffer.clear();
+}
+
+void RunWriter::write(uint64_t key) {
+    if (count > 0 && key <= previous) {
+        throw std::invalid_argument("Run keys must be strictly increasing");
+    }
+    // Sorted keys are close together, so their deltas fit in a few varint bytes
+    uint64_t delta = key - previous;
+    previous = key;
+    count++;
+    while (delta >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(delta));
+    if (buffer.size() >= (1 << 20) - 16) {
+        flush();
+    }
+}
+
+void RunWriter::close() {
+    if (!file) {
+        return;
+    }
+    bool ok = true;
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+        ok = false;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    if (!ok) {
+        throw std::runtime_error("Failed writing run file");
+    }
+}
+
+RunReader::RunReader(const std::string& path)
+    : file(std::fopen(path.c_str(), "rb")), buffer(1 << 20), position(0), length(0), previous(0) {
+    if (!file) {
+        throw std::runtime_error("Cannot open run file " + path);
+    }
+}
+
+RunReader::~RunReader() {
+    std::fclose(file);
+}
+
+bool RunReader::refill() {
+    length = std::fread(buffer.data(), 1, buffer.size(), file);
+    position = 0;
+    return length > 0;
+}
+
+bool RunReader::next(uint64_t& key) {
+    uint64_t delta = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (position == length && !refill()) {
+            if (shift > 0) {
+                throw std::runtime_error("Truncated run file");
+            }
+            return false;
+        }
+        uint8_t byte = buffer[position++];
+        delta |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    previous += delta;
+    key = previous;
+    return true;
+}
+
+DiskStateExplorer::DiskStateExplorer(const ExplorerOptions& explorer_options) : options(explorer_options) {
+    if (options.disk_directory.empty()) {
+        throw std::invalid_argument("Disk exploration needs a directory");
+    }
+    std::filesystem::create_directories(options.disk_directory);
+}
+
+std::string DiskStateExplorer::path(const std::string& name, int level, int run) const {
+    std::string file = options.disk_directory + "/" + name + "_" + std::to_string(level);
+    if (run >= 0) {
+        file += "_" + std::to_string(run);
+    }
+    return file + ".run";
+}
+
+ExplorerReport DiskStateExplorer::run(const std::function<void(const LevelStats&)>& on_level) {
+    size_t thread_count = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+
+    std::vector<std::unique_ptr<StateExpander>> expanders;
+    for (size_t t = 0; t < thread_count; ++t) {
+        expanders.push_back(std::make_unique<StateExpander>(options.roles, options.rules));
+    }
+
+    uint64_t initial = expanders[0]->initial_key();
+    {
+        RunWriter level(path("level", 0));
+        level.write(initial);
+        RunWriter visited(path("visited", 0));
+        visited.write(initial);
+    }
+
+    ExplorerReport report;
+    uint64_t frontier_size = 1;
+    uint64_t visited_count = 1;
+    const size_t READ_CHUNK = 1 << 16;
+    int level = 0;
+    for (; frontier_size > 0; ++level) {
+        if (options.max_levels >= 0 && level >= options.max_levels) {
+            break;
+        }
+        auto started = std::chrono::steady_clock::now();
+        LevelStats stats{level, frontier_size, 0, 0, 0, 0, 0.0};
+
+        // 1. Expand the frontier in chunks and spill sorted runs of successors
+        std::vector<uint64_t> buffer;
+        std::vector<uint64_t> chunk;
+        int runs = 0;
+        uint64_t successor_count = 0;
+        auto write_run = [&]() {
+            std::sort(buffer.begin(), buffer.end());
+            buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+            RunWriter writer(path("run", level, runs++));
+            for (uint64_t key : buffer) {
+                writer.write(key);
+            }
+            buffer.clear();
+        };
+        {
+            RunReader frontier(path("level", level));
+            uint64_t key;
+            bool more = true;
+            while (more) {
+                chunk.clear();
+                while (chunk.size() < READ_CHUNK && (more = frontier.next(key))) {
+                    chunk.push_back(key);
+                }
+                if (chunk.empty()) {
+                    break;
+                }
+
+                std::atomic<size_t> cursor(0);
+                std::vector<std::vector<uint64_t>> successors(thread_count);
+                std::vector<ExpansionCounters> counters(thread_count);
+                std::exception_ptr failure;
+                std::mutex failure_mutex;
+                auto work = [&](size_t t) {
+                    try {
+                        size_t i;
+                        while ((i = cursor.fetch_add(1)) < chunk.size()) {
+                            expanders[t]->expand(chunk[i], successors[t], counters[t]);
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(failure_mutex);
+                        if (!failure) failure = std::current_exception();
+                        cursor.store(chunk.size());
+                    }
+                };
+                std::vector<std::thread> workers;
+                for (size_t t = 1; t < thread_count; ++t) {
+                    workers.emplace_back(work, t);
+                }
+                work(0);
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+                if (failure) {
+                    std::rethrow_exception(failure);
+                }
+
+                for (size_t t = 0; t < thread_count; ++t) {
+                    buffer.insert(buffer.end(), successors[t].begin(), successors[t].end());
+                    successor_count += successors[t].size();
+                    stats.transitions += counters[t].transitions;
+                    stats.terminal += counters[t].terminal;
+                    report.counters.merge(counters[t]);
+                }
+                if (buffer.size() >= options.run_buffer_states) {
+                    write_run();
+                }
+            }
+        }
+        if (!buffer.empty() || runs == 0) {
+            write_run();
+        }
+
+        // 2. Merge the runs and subtract the visited file in one sequential pass,
+        //    writing the next frontier and the grown visited file side by side
+        {
+            std::vector<std::unique_ptr<RunReader>> readers;
+            typedef std::pair<uint64_t, size_t> HeapEntry;
+            std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+            for (int r = 0; r < runs; ++r) {
+                readers.push_back(std::make_unique<RunReader>(path("run", level, r)));
+                uint64_t key;
+                if (readers.back()->next(key)) {
+                    heap.push({key, readers.size() - 1});
+                }
+            }
+
+            RunReader visited(path("visited", level));
+            RunWriter next_level(path("level", level + 1));
+            RunWriter next_visited(path("visited", level + 1));
+            uint64_t seen;
+            bool has_seen = visited.next(seen);
+            bool has_last = false;
+            uint64_t last = 0;
+            while (!heap.empty()) {
+                HeapEntry top = heap.top();
+                heap.pop();
+                uint64_t key;
+                if (readers[top.second]->next(key)) {
+                    heap.push({key, top.second});
+                }
+                if (has_last && top.first == last) {
+                    continue;
+                }
+                has_last = true;
+                last = top.first;
+
+                while (has_seen && seen < top.first) {
+                    next_visited.write(seen);
+                    has_seen = visited.next(seen);
+                }
+                if (has_seen && seen == top.first) {
+                    continue;
+                }
+                next_level.write(top.first);
+                next_visited.write(top.first);
+            }
+            while (has_seen) {
+                next_visited.write(seen);
+                has_seen = visited.next(seen);
+            }
+            frontier_size = next_level.size();
+            visited_count = next_visited.size();
+        }
+
+        std::remove(path("level", level).c_str());
+        std::remove(path("visited", level).c_str());
+        for (int r = 0; r < runs; ++r) {
+            std::remove(path("run", level, r).c_str());
+        }
+
+        stats.new_states = frontier_size;
+        stats.revisits = successor_count - frontier_size;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        report.levels.push_back(stats);
+        report.revisits += stats.revisits;
+        if (on_level) {
+            on_level(stats);
+        }
+    }
+
+    std::remove(path("level", level).c_str());
+    std::remove(path("visited", level).c_str());
+    report.states = visited_count;
+    report.complete = frontier_size == 0;
+    return report;
+}
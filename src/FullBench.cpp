@@ -0,0 +1,105 @@
+// yaacovkrawiec@gmail.com
+
+// Full-rules simulation throughput benchmark.
+// Plays random games of the simple mode (simulate_game, random seat roles) and of the full
+// ruleset (simulate_full_game, cards dealt from the court deck) at the same table size and
+// reports turns per second for both and the slowdown of the full rules.
+//
+// Examples:
+//   ./coup_fullbench
+//   ./coup_fullbench --players 6 --games 200000
+
+#include "../include/FullRules.hpp"
+#include "../include/Simulator.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: coup_fullbench [--players N] [--games N] [--max-turns N] [--seed N]\n";
+}
+
+struct Throughput {
+    long turns = 0;
+    long draws = 0;                      // Games stopped at max_turns
+    double seconds = 0.0;
+
+    double turns_per_second() const { return seconds > 0.0 ? turns / seconds : 0.0; }
+};
+
+template <typename PlayOne>
+Throughput measure(long games, PlayOne play_one) {
+    Throughput result;
+    auto start = std::chrono::steady_clock::now();
+    for (long g = 0; g < games; ++g) {
+        SimulationResult game = play_one();
+        result.turns += game.turns;
+        result.draws += game.winner < 0;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int players = 4;
+    long games = 100000;
+    int max_turns = 1000;
+    uint64_t seed = 1;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--players") players = std::stoi(next());
+            else if (arg == "--games") games = std::stol(next());
+            else if (arg == "--max-turns") max_turns = std::stoi(next());
+            else if (arg == "--seed") seed = std::stoull(next());
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (players < 2 || players > 6) {
+            throw std::invalid_argument("Players must be between 2 and 6");
+        }
+        if (games < 1) {
+            throw std::invalid_argument("--games must be at least 1");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    const GameRules& rules = GameRules::defaults();
+    std::mt19937_64 simple_rng(seed);
+    std::vector<RoleType> roles(players);
+    Throughput simple = measure(games, [&]() {
+        for (RoleType& role : roles) {
+            role = static_cast<RoleType>(simple_rng() % 6);
+        }
+        return simulate_game(rules, roles, simple_rng, max_turns);
+    });
+    std::mt19937_64 full_rng(seed);
+    Throughput full = measure(games, [&]() { return simulate_full_game(rules, players, full_rng, max_turns); });
+
+    std::cout << std::fixed << std::setprecision(0)
+              << games << " random games per mode, " << players << " players\n"
+              << "mode\tturns\tdraws\tgames/s\tturns/s\n"
+              << "simple\t" << simple.turns << "\t" << simple.draws << "\t" << games / simple.seconds << "\t"
+              << simple.turns_per_second() << "\n"
+              << "full\t" << full.turns << "\t" << full.draws << "\t" << games / full.seconds << "\t"
+              << full.turns_per_second() << "\n"
+              << std::setprecision(2)
+              << "time per turn, full / simple: " << simple.turns_per_second() / full.turns_per_second() << "\n";
+    return 0;
+}
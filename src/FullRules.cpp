@@ -0,0 +1,372 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/FullRules.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+CourtDeck CourtDeck::standard(int copies) {
+    if (copies < 0 || copies > MAX_COPIES) {
+        throw std::invalid_argument("Invalid number of copies per role");
+    }
+    CourtDeck deck;
+    for (int r = 0; r < 6; ++r) {
+        deck.counts |= static_cast<uint32_t>(copies) << (r * COUNT_BITS);
+    }
+    return deck;
+}
+
+int CourtDeck::size() const {
+    int total = 0;
+    for (int r = 0; r < 6; ++r) {
+        total += (counts >> (r * COUNT_BITS)) & MAX_COPIES;
+    }
+    return total;
+}
+
+void CourtDeck::add(RoleType role) {
+    if (count(role) == MAX_COPIES) {
+        throw std::runtime_error("Too many copies of a role in the court deck");
+    }
+    counts += 1u << (static_cast<int>(role) * COUNT_BITS);
+}
+
+void CourtDeck::remove(RoleType role) {
+    if (count(role) == 0) {
+        throw std::runtime_error("Role is not in the court deck");
+    }
+    counts -= 1u << (static_cast<int>(role) * COUNT_BITS);
+}
+
+RoleType CourtDeck::draw(std::mt19937_64& rng) {
+    int total = size();
+    if (total == 0) {
+        throw std::runtime_error("Court deck is empty");
+    }
+    int pick = static_cast<int>(rng() % total);
+    for (int r = 0; r < 6; ++r) {
+        int copies = (counts >> (r * COUNT_BITS)) & MAX_COPIES;
+        if (pick < copies) {
+            counts -= 1u << (r * COUNT_BITS);
+            return static_cast<RoleType>(r);
+        }
+        pick -= copies;
+    }
+    throw std::logic_error("Court deck count mismatch");
+}
+
+RandomFullPolicy::RandomFullPolicy(std::mt19937_64& random, double challenge_probability, double block_probability)
+    : rng(random), challenge_rate(challenge_probability), block_rate(block_probability) {
+}
+
+bool RandomFullPolicy::challenge(const FullRulesGame& /*game*/, int /*challenger*/, int /*claimant*/, RoleType /*claim*/) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < challenge_rate;
+}
+
+bool RandomFullPolicy::block(const FullRulesGame& /*game*/, int /*blocker*/, const FullMove& /*move*/, int /*actor*/,
+                             RoleType /*claim*/) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < block_rate;
+}
+
+int RandomFullPolicy::lose_influence(const FullRulesGame& game, int seat) {
+    const FullPlayer& player = game.get_player(seat);
+    if (player.lost & 1) return 1;
+    if (player.lost & 2) return 0;
+    return static_cast<int>(rng() % 2);
+}
+
+void RandomFullPolicy::exchange(const FullRulesGame& /*game*/, int /*seat*/, RoleType* cards, int count, int /*keep*/) {
+    for (int i = count - 1; i > 0; --i) {
+        std::swap(cards[i], cards[rng() % (i + 1)]);
+    }
+}
+
+FullRulesGame::FullRulesGame(const GameRules& game_rules, int seats, std::mt19937_64& rng, int copies_per_role)
+    : rules(game_rules), deck(CourtDeck::standard(copies_per_role)), players(),
+      player_count(static_cast<uint8_t>(seats)), current_player(0), extra_turn(false) {
+    if (seats < 2 || seats > MAX_PLAYERS) {
+        throw std::invalid_argument("Full rules need 2 to 6 players");
+    }
+    // Every hand is dealt and an exchange can still draw two cards
+    if (deck.size() < 2 * seats + 2) {
+        throw std::invalid_argument("Court deck is too small for this many players");
+    }
+    for (int seat = 0; seat < seats; ++seat) {
+        FullPlayer& player = players[seat];
+        player.coins = rules.starting_coins;
+        player.cards[0] = deck.draw(rng);
+        player.cards[1] = deck.draw(rng);
+        player.lost = 0;
+        player.last_arrested = -1;
+        player.sanctioned = false;
+    }
+}
+
+void FullRulesGame::legal_moves(std::vector<FullMove>& moves) const {
+    moves.clear();
+    if (is_over()) {
+        return;
+    }
+    const FullPlayer& player = players[current_player];
+
+    if (player.coins >= rules.coup_cost) {
+        for (int seat = 0; seat < player_count; ++seat) {
+            if (seat != current_player && players[seat].is_alive()) {
+                moves.push_back(FullMove(FullAction::COUP, seat));
+            }
+        }
+        if (player.coins >= rules.forced_coup_threshold) {
+            return;
+        }
+    }
+
+    if (!player.sanctioned) {
+        moves.push_back(FullMove(FullAction::GATHER));
+        moves.push_back(FullMove(FullAction::TAX));
+        moves.push_back(FullMove(FullAction::GOVERNOR_TAX));
+    }
+    if (player.coins >= rules.baron_invest_cost) {
+        moves.push_back(FullMove(FullAction::INVEST));
+    }
+    moves.push_back(FullMove(FullAction::EXCHANGE));
+    for (int seat = 0; seat < player_count; ++seat) {
+        if (seat == current_player || !players[seat].is_alive()) {
+            continue;
+        }
+        if (player.last_arrested != seat) {
+            moves.push_back(FullMove(FullAction::ARREST, seat));
+        }
+        if (player.coins >= rules.sanction_cost) {
+            moves.push_back(FullMove(FullAction::SANCTION, seat));
+        }
+    }
+    if (player.coins >= rules.bribe_cost) {
+        moves.push_back(FullMove(FullAction::BRIBE));
+    }
+}
+
+void FullRulesGame::lose_influence(int seat, FullPolicy& policy) {
+    FullPlayer& player = players[seat];
+    if (!player.is_alive()) {
+        return;
+    }
+    int slot = player.lost ? (player.lost & 1 ? 1 : 0) : policy.lose_influence(*this, seat);
+    if (slot < 0 || slot > 1 || (player.lost >> slot) & 1) {
+        throw std::runtime_error("Policy chose an influence that is already lost");
+    }
+    player.lost |= static_cast<uint8_t>(1 << slot);
+    if (!player.is_alive()) {
+        player.sanctioned = false;
+    }
+}
+
+bool FullRulesGame::resolve_claim(int claimant, RoleType claim, FullPolicy& policy, std::mt19937_64& rng) {
+    // The first player after the claimant, in seat order, who challenges settles it
+    for (int step = 1; step < player_count; ++step) {
+        int challenger = (claimant + step) % player_count;
+        if (!players[challenger].is_alive() || !policy.challenge(*this, challenger, claimant, claim)) {
+            continue;
+        }
+        FullPlayer& player = players[claimant];
+        if (!player.holds(claim)) {
+            lose_influence(claimant, policy);
+            return false;
+        }
+        // The revealed card is shuffled back and replaced before the challenger pays
+        int slot = (!(player.lost & 1) && player.cards[0] == claim) ? 0 : 1;
+        deck.add(claim);
+        player.cards[slot] = deck.draw(rng);
+        lose_influence(challenger, policy);
+        return true;
+    }
+    return true;
+}
+
+bool FullRulesGame::resolve_block(const FullMove& move, FullPolicy& policy, std::mt19937_64& rng) {
+    int actor = current_player;
+    auto try_block = [&](int blocker, RoleType claim) {
+        return players[blocker].is_alive() && policy.block(*this, blocker, move, actor, claim);
+    };
+
+    switch (move.action) {
+        case FullAction::TAX:
+        case FullAction::BRIBE: {
+            RoleType claim = move.action == FullAction::TAX ? RoleType::GOVERNOR : RoleType::JUDGE;
+            for (int step = 1; step < player_count; ++step) {
+                int blocker = (actor + step) % player_count;
+                if (try_block(blocker, claim)) {
+                    return resolve_claim(blocker, claim, policy, rng);
+                }
+            }
+            return false;
+        }
+        case FullAction::ARREST:
+            if (try_block(move.target, RoleType::SPY)) {
+                return resolve_claim(move.target, RoleType::SPY, policy, rng);
+            }
+            if (try_block(move.target, RoleType::MERCHANT)) {
+                return resolve_claim(move.target, RoleType::MERCHANT, policy, rng);
+            }
+            return false;
+        case FullAction::COUP:
+            if (players[move.target].coins >= rules.general_block_cost && try_block(move.target, RoleType::GENERAL) &&
+                resolve_claim(move.target, RoleType::GENERAL, policy, rng)) {
+                players[move.target].coins -= rules.general_block_cost;
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void FullRulesGame::exchange(int seat, FullPolicy& policy, std::mt19937_64& rng) {
+    FullPlayer& player = players[seat];
+    RoleType cards[4];
+    int slots[2];
+    int keep = 0;
+    for (int slot = 0; slot < 2; ++slot) {
+        if (!((player.lost >> slot) & 1)) {
+            slots[keep] = slot;
+            cards[keep++] = player.cards[slot];
+        }
+    }
+    cards[keep] = deck.draw(rng);
+    cards[keep + 1] = deck.draw(rng);
+    policy.exchange(*this, seat, cards, keep + 2, keep);
+    for (int i = 0; i < keep; ++i) {
+        player.cards[slots[i]] = cards[i];
+    }
+    deck.add(cards[keep]);
+    deck.add(cards[keep + 1]);
+}
+
+void FullRulesGame::play(const FullMove& move, FullPolicy& policy, std::mt19937_64& rng) {
+    if (is_over()) {
+        throw std::runtime_error("Game is over");
+    }
+    int seat = current_player;
+    FullPlayer& actor = players[seat];
+    bool targeted = move.action == FullAction::ARREST || move.action == FullAction::SANCTION ||
+                    move.action == FullAction::COUP;
+    if (targeted && (move.target < 0 || move.target >= player_count || move.target == seat ||
+                     !players[move.target].is_alive())) {
+        throw std::invalid_argument("Invalid target");
+    }
+
+    switch (move.action) {
+        case FullAction::GATHER:
+            actor.coins += rules.gather_amount;
+            break;
+        case FullAction::TAX:
+            if (!resolve_block(move, policy, rng)) {
+                actor.coins += rules.tax_amount;
+            }
+            break;
+        case FullAction::GOVERNOR_TAX:
+            if (resolve_claim(seat, RoleType::GOVERNOR, policy, rng)) {
+                actor.coins += rules.governor_tax_amount;
+            }
+            break;
+        case FullAction::INVEST:
+            if (actor.coins < rules.baron_invest_cost) {
+                throw std::runtime_error("Not enough coins to invest");
+            }
+            if (resolve_claim(seat, RoleType::BARON, policy, rng)) {
+                actor.coins += rules.baron_invest_return - rules.baron_invest_cost;
+            }
+            break;
+        case FullAction::EXCHANGE:
+            if (resolve_claim(seat, RoleType::SPY, policy, rng)) {
+                exchange(seat, policy, rng);
+            }
+            break;
+        case FullAction::ARREST: {
+            actor.last_arrested = static_cast<int8_t>(move.target);
+            FullPlayer& target = players[move.target];
+            if (!resolve_block(move, policy, rng) && target.is_alive()) {
+                int taken = std::min(rules.arrest_amount, target.coins);
+                target.coins -= taken;
+                actor.coins += taken;
+            }
+            break;
+        }
+        case FullAction::BRIBE:
+            if (actor.coins < rules.bribe_cost) {
+                throw std::runtime_error("Not enough coins for bribe");
+            }
+            actor.coins -= rules.bribe_cost;
+            if (!resolve_block(move, policy, rng)) {
+                extra_turn = true;
+            }
+            break;
+        case FullAction::SANCTION:
+            if (actor.coins < rules.sanction_cost) {
+                throw std::runtime_error("Not enough coins for sanction");
+            }
+            actor.coins -= rules.sanction_cost;
+            players[move.target].sanctioned = true;
+            break;
+        case FullAction::COUP:
+            if (actor.coins < rules.coup_cost) {
+                throw std::runtime_error("Not enough coins for coup");
+            }
+            actor.coins -= rules.coup_cost;
+            if (!resolve_block(move, policy, rng)) {
+                lose_influence(move.target, policy);
+            }
+            break;
+    }
+    advance_turn();
+}
+
+void FullRulesGame::advance_turn() {
+    if (is_over()) {
+        return;
+    }
+    FullPlayer& player = players[current_player];
+    if (extra_turn && player.is_alive()) {
+        extra_turn = false;
+        return;
+    }
+    extra_turn = false;
+    // A sanction lasts until the end of the sanctioned player's next turn
+    player.sanctioned = false;
+    do {
+        current_player = static_cast<uint8_t>((current_player + 1) % player_count);
+    } while (!players[current_player].is_alive());
+}
+
+int FullRulesGame::alive_count() const {
+    int alive = 0;
+    for (int seat = 0; seat < player_count; ++seat) {
+        alive += players[seat].is_alive();
+    }
+    return alive;
+}
+
+int FullRulesGame::winner() const {
+    if (alive_count() != 1) {
+        return -1;
+    }
+    for (int seat = 0; seat < player_count; ++seat) {
+        if (players[seat].is_alive()) {
+            return seat;
+        }
+    }
+    return -1;
+}
+
+SimulationResult simulate_full_game(const GameRules& rules, int seats, std::mt19937_64& rng, int max_turns) {
+    FullRulesGame game(rules, seats, rng);
+    RandomFullPolicy policy(rng);
+    std::vector<FullMove> moves;
+    SimulationResult result{-1, 0};
+    while (!game.is_over() && result.turns < max_turns) {
+        game.legal_moves(moves);
+        game.play(moves[rng() % moves.size()], policy, rng);
+        result.turns++;
+    }
+    result.winner = game.winner();
+    return result;
+}
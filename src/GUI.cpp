@@ -3,7 +3,10 @@
 #include "../include/Game.hpp"
 #include "../include/Player.hpp"
 #include "../include/Role.hpp"
+#include "../include/PlayerView.hpp"
+#include "../include/TurnPipeline.hpp"
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <string>
@@ -26,9 +29,15 @@ private:
     int selected_target;
     std::string message;
     
+    // Clicks are queued as moves for the pipeline; a General targeted by a coup blocks it
+    // whenever it can pay for it
+    QueuedInput input;
+    TurnPipeline pipeline;
+    
 public:
     GameGUI(Game& g, std::vector<std::shared_ptr<Player>>& p) 
-        : window(sf::VideoMode(800, 600), "Coup Game"), game(g), players(p), selected_target(-1) {
+        : window(sf::VideoMode(800, 600), "Coup Game"), game(g), players(p), selected_target(-1),
+          input([](const Game& played, int) { return played.get_action_history().back().action == ActionType::COUP; }) {
         
         // Load font - try multiple locations
         if (!font.loadFromFile("assets/arial.ttf")) {
@@ -42,6 +51,8 @@ public:
         }
         
         initialize_ui();
+        pipeline.add_game(game, std::vector<SeatInput*>(players.size(), &input));
+        pipeline.run();
     }
     
     void initialize_ui() {
@@ -84,6 +95,8 @@ public:
     }
     
     void update_player_info() {
+        // Show the table as the player to move sees it; everything once the game is over
+        bool reveal_all = !game.is_game_active();
         for (size_t i = 0; i < players.size(); ++i) {
             std::stringstream ss;
             ss << players[i]->get_name();
@@ -91,10 +104,15 @@ public:
             if (!players[i]->is_player_active()) {
                 ss << " [ELIMINATED]";
             } else {
-                ss << " - Coins: " << players[i]->get_coins();
+                PlayerView view(game, game.get_current_player_index());
+                if (reveal_all || view.is_coins_visible(i)) {
+                    ss << " - Coins: " << players[i]->get_coins();
+                } else {
+                    ss << " - Coins: ?";
+                }
                 
                 if (players[i]->get_role()) {
-                    ss << " - Role: " << players[i]->get_role()->get_name();
+                    ss << " - Role: " << (reveal_all || view.is_role_visible(i) ? players[i]->get_role()->get_name() : "???");
                 }
                 
                 if (players[i]->is_player_sanctioned()) {
@@ -138,60 +156,36 @@ public:
         auto current_player = game.get_current_player();
         if (!current_player) return;
         
-        try {
-            switch (action_index) {
-                case 0: // Gather
-                    current_player->gather(game);
-                    message = current_player->get_name() + " gathered 1 coin";
-                    game.next_turn();
-                    break;
-                    
-                case 1: // Tax
-                    current_player->tax(game);
-                    message = current_player->get_name() + " used tax";
-                    game.next_turn();
-                    break;
-                    
-                case 2: // Bribe
-                    current_player->bribe(game);
-                    message = current_player->get_name() + " paid bribe for extra turn";
-                    break;
-                    
-                case 3: // Arrest
-                    if (selected_target >= 0 && selected_target < (int)players.size()) {
-                        current_player->arrest(*players[selected_target], game);
-                        message = current_player->get_name() + " arrested " + players[selected_target]->get_name();
-                        game.next_turn();
-                    } else {
-                        message = "Select a target first!";
-                    }
-                    break;
-                    
-                case 4: // Sanction
-                    if (selected_target >= 0 && selected_target < (int)players.size()) {
-                        current_player->sanction(*players[selected_target], game);
-                        message = current_player->get_name() + " sanctioned " + players[selected_target]->get_name();
-                        game.next_turn();
-                    } else {
-                        message = "Select a target first!";
-                    }
-                    break;
-                    
-                case 5: // Coup
-                    if (selected_target >= 0 && selected_target < (int)players.size()) {
-                        current_player->coup(*players[selected_target], game);
-                        game.eliminate_player(players[selected_target].get());
-                        message = current_player->get_name() + " performed coup on " + players[selected_target]->get_name();
-                        game.next_turn();
-                    } else {
-                        message = "Select a target first!";
-                    }
-                    break;
-            }
-        } catch (const std::exception& e) {
-            message = "Error: " + std::string(e.what());
+        static const MoveType BUTTON_MOVES[] = {MoveType::GATHER, MoveType::TAX, MoveType::BRIBE,
+                                                MoveType::ARREST, MoveType::SANCTION, MoveType::COUP};
+        MoveType type = BUTTON_MOVES[action_index];
+        bool targeted = type == MoveType::ARREST || type == MoveType::SANCTION || type == MoveType::COUP;
+        if (targeted && (selected_target < 0 || selected_target >= (int)players.size())) {
+            message = "Select a target first!";
+            return;
         }
         
+        Move move(type, targeted ? selected_target : -1);
+        std::vector<Move> moves = legal_moves(game);
+        if (std::find(moves.begin(), moves.end(), move) == moves.end()) {
+            message = "Error: that move is not allowed right now";
+            selected_target = -1;
+            return;
+        }
+        
+        static const char* DONE[] = {" gathered 1 coin", " used tax", " paid bribe for extra turn",
+                                     " arrested ", " sanctioned ", " performed coup on "};
+        message = current_player->get_name() + DONE[action_index] + (targeted ? players[move.target]->get_name() : "");
+        
+        size_t history_size = game.get_action_history().size();
+        input.push_move(move);
+        pipeline.run();
+        
+        const auto& history = game.get_action_history();
+        if (history.size() > history_size && history[history_size].was_blocked) {
+            message = history[history_size].blocker->get_name() + " blocked the " +
+                      (type == MoveType::COUP ? "coup" : "action");
+        }
         selected_target = -1;
     }
     
@@ -3,9 +3,26 @@
 #include "../include/Game.hpp"
 #include "../include/Player.hpp"
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 
-Game::Game() : current_player_index(0), treasury_coins(50), game_active(false), extra_turn_allowed(false) {
+Game::Game() : Game(GameRules::defaults()) {
+}
+
+Game::Game(const GameRules& game_rules)
+    : current_player_index(0), treasury_coins(game_rules.starting_treasury), game_active(false),
+      extra_turn_allowed(false), turn_number(0), player_stats(), history_spill(nullptr, &std::fclose), rules(game_rules), roles_hidden(false),
+      coins_hidden(false), coin_reveals(), history_prefix_hash(0), table_checksum(0), seat_checksums(), state_checksum(0), blocker_index(), last_actor_seat(-1), last_target_seat(-1),
+      undo_state(), undo_available(false) {
+}
+
+Game::~Game() {
+    for (const auto& player : players) {
+        if (player->get_game() == this) {
+            player->set_game(nullptr);
+        }
+    }
 }
 
 void Game::add_player(std::shared_ptr<Player> player) {
@@ -16,6 +33,12 @@ void Game::add_player(std::shared_ptr<Player> player) {
         throw std::runtime_error("Maximum 6 players allowed");
     }
     players.push_back(player);
+    player->set_game(this);
+    std::vector<Player*> seats;
+    for (const auto& seated : players) {
+        seats.push_back(seated.get());
+    }
+    action_history.set_seats(seats);
 }
 
 void Game::start_game() {
@@ -23,6 +46,8 @@ void Game::start_game() {
         throw std::runtime_error("Need at least 2 players to start");
     }
     game_active = true;
+    refresh_blocker_index();
+    refresh_state_checksum();
 }
 
 void Game::next_turn() {
@@ -30,6 +55,9 @@ void Game::next_turn() {
         throw std::runtime_error("Game is not active");
     }
     
+    // The turn's action can no longer be blocked
+    turn_number++;
+    undo_available = false;
     if (!extra_turn_allowed) {
         clear_sanctions();
         
@@ -42,14 +70,16 @@ void Game::next_turn() {
         if (current->get_role() && current->get_role()->get_type() == RoleType::MERCHANT) {
             auto merchant_role = std::dynamic_pointer_cast<Merchant>(current->get_role());
             if (merchant_role) {
-                merchant_role->start_turn_bonus(*current);
+                merchant_role->start_turn_bonus(*current, rules);
             }
         }
         
         check_forced_coup();
+        refresh_seat_checksum(current_player_index);
     } else {
         reset_extra_turn();
     }
+    refresh_table_checksum();
 }
 
 std::string Game::turn() const {
@@ -82,34 +112,357 @@ std::string Game::winner() const {
     return "";
 }
 
-void Game::add_action_to_history(ActionType action, Player* actor, Player* target) {
-    action_history.push_back(ActionRecord(action, actor, target));
+namespace {
+
+uint64_t mix_hash(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash *= 0xff51afd7ed558ccdULL;
+    return hash ^ (hash >> 32);
 }
 
-bool Game::can_block_last_action(Player* blocker) {
-    if (action_history.empty()) {
+int seat_index(const std::vector<std::shared_ptr<Player>>& players, const Player* player) {
+    for (size_t i = 0; i < players.size(); ++i) {
+        if (players[i].get() == player) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+uint64_t record_code(PackedAction record) {
+    return static_cast<uint64_t>(record.action()) | (static_cast<uint64_t>(record.actor() + 1) << 8) |
+           (static_cast<uint64_t>(record.target() + 1) << 16) | (static_cast<uint64_t>(record.blocked()) << 24) |
+           (static_cast<uint64_t>(record.blocker() + 1) << 32);
+}
+
+const uint32_t SAVE_MAGIC = 0x33534743; // "CGS3"
+
+static_assert(std::is_trivially_copyable<GameRules>::value && std::is_trivially_copyable<GameState>::value &&
+                  std::is_trivially_copyable<PlayerStats>::value,
+              "Saves copy rules, states and player statistics as raw bytes");
+
+// Writes into a buffer sized up front, so saving is a handful of copies
+class SaveWriter {
+private:
+    uint8_t* at;
+
+public:
+    explicit SaveWriter(uint8_t* start) : at(start) {}
+
+    template <typename T>
+    void put(const T& value) {
+        std::memcpy(at, &value, sizeof(T));
+        at += sizeof(T);
+    }
+
+    void put_bytes(const void* data, size_t size) {
+        std::memcpy(at, data, size);
+        at += size;
+    }
+};
+
+class SaveReader {
+private:
+    const uint8_t* at;
+    const uint8_t* end;
+
+public:
+    SaveReader(const uint8_t* data, size_t size) : at(data), end(data + size) {}
+
+    const uint8_t* take(size_t size) {
+        if (static_cast<size_t>(end - at) < size) {
+            throw std::runtime_error("Truncated game save");
+        }
+        const uint8_t* start = at;
+        at += size;
+        return start;
+    }
+
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    bool at_end() const { return at == end; }
+};
+
+// A saved state is only restored if every seat index and role in it is in range
+bool fits_seats(const GameState& state, int count) {
+    if (state.player_count != count || state.current_player >= std::max(count, 1)) {
         return false;
     }
-    
-    ActionRecord& last_action = action_history.back();
-    if (last_action.was_blocked) {
+    for (int i = 0; i < count; ++i) {
+        if (state.players[i].coins < 0 || state.players[i].last_arrested >= count ||
+            state.players[i].role > static_cast<int8_t>(RoleType::MERCHANT)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool Game::is_richest_opponent(const Player* actor, const Player* target) const {
+    if (!target) {
         return false;
     }
-    
-    // Check if blocker's role can block this action
-    if (blocker->get_role()) {
-        return blocker->get_role()->can_block_action(last_action.action, last_action.actor, last_action.target);
+    for (const auto& player : players) {
+        if (player.get() != actor && player->is_player_active() && player->get_coins() > target->get_coins()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Game::add_action_to_history(ActionType action, Player* actor, Player* target, bool target_led) {
+    // The last record can still be blocked, so it is only folded into the prefix hash now
+    if (!action_history.empty()) {
+        history_prefix_hash = mix_hash(history_prefix_hash, record_code(action_history.packed_back()));
+    }
+    if (history_spill && action_history.is_full()) {
+        spill_record(action_history.oldest());
+    }
+    last_actor_seat = seat_index(players, actor);
+    last_target_seat = seat_index(players, target);
+    action_history.push_back(PackedAction::make(action, last_actor_seat, last_target_seat, turn_number));
+    if (last_actor_seat >= 0) {
+        player_stats[last_actor_seat].record(action, last_target_seat, last_target_seat >= 0 && target_led);
+    }
+    // An action only touches its actor, its target and the table
+    refresh_seat_checksum(last_actor_seat);
+    refresh_seat_checksum(last_target_seat);
+    refresh_table_checksum();
+}
+
+void Game::refresh_table_checksum() {
+    uint64_t now = checksum_table(treasury_coins, static_cast<uint8_t>(players.size()),
+                                  static_cast<uint8_t>(current_player_index), game_active, extra_turn_allowed);
+    state_checksum ^= table_checksum ^ now;
+    table_checksum = now;
+}
+
+void Game::refresh_seat_checksum(int seat) {
+    if (seat < 0) {
+        return;
+    }
+    uint64_t now = checksum_seat(seat, player_state(seat));
+    state_checksum ^= seat_checksums[seat] ^ now;
+    seat_checksums[seat] = now;
+}
+
+void Game::refresh_state_checksum() {
+    // From scratch, since a load can leave fewer seats than before
+    table_checksum = 0;
+    std::fill(seat_checksums, seat_checksums + MAX_PLAYERS, 0);
+    state_checksum = 0;
+    refresh_table_checksum();
+    for (size_t seat = 0; seat < players.size(); ++seat) {
+        refresh_seat_checksum(static_cast<int>(seat));
+    }
+}
+
+uint64_t Game::get_public_history_hash() const {
+    if (action_history.empty()) {
+        return history_prefix_hash;
+    }
+    return mix_hash(history_prefix_hash, record_code(action_history.packed_back()));
+}
+
+void Game::set_hidden_information(bool hide_roles, bool hide_coins) {
+    roles_hidden = hide_roles;
+    coins_hidden = hide_coins;
+}
+
+void Game::reveal_coins(Player* observer, Player* target) {
+    int observer_seat = seat_index(players, observer);
+    int target_seat = seat_index(players, target);
+    if (observer_seat < 0 || target_seat < 0) {
+        throw std::runtime_error("Player is not in this game");
+    }
+    coin_reveals[observer_seat] |= static_cast<uint8_t>(1 << target_seat);
+}
+
+bool Game::are_coins_revealed(int observer_seat, int target_seat) const {
+    return (coin_reveals[observer_seat] >> target_seat) & 1;
+}
+
+bool Game::can_block_last_action(Player* blocker) {
+    if (action_history.empty()) {
+        return false;
     }
     
-    return false;
+    int seat = seat_index(players, blocker);
+    return seat >= 0 && blocker->is_player_active() && ((eligible_blocker_mask() >> seat) & 1);
 }
 
-void Game::block_last_action() {
+void Game::block_last_action(Player* blocker) {
     if (!action_history.empty()) {
-        action_history.back().was_blocked = true;
+        int seat = seat_index(players, blocker);
+        action_history.mark_last_blocked(seat);
+        if (last_actor_seat >= 0) {
+            player_stats[last_actor_seat].blocked++;
+        }
+        if (seat >= 0) {
+            player_stats[seat].blocks++;
+        }
     }
 }
 
+void Game::clear_action_history() {
+    action_history.clear();
+    std::fill(player_stats, player_stats + MAX_PLAYERS, PlayerStats());
+    history_prefix_hash = 0;
+    undo_available = false;
+}
+
+void Game::set_history_limit(size_t limit, const std::string& spill_path) {
+    history_spill.reset(spill_path.empty() ? nullptr : std::fopen(spill_path.c_str(), "ab"));
+    if (!spill_path.empty() && !history_spill) {
+        throw std::runtime_error("Cannot open history spill " + spill_path);
+    }
+    if (history_spill && limit > 0) {
+        size_t retained = action_history.retained();
+        for (size_t i = action_history.first_index(); retained > limit; ++i, --retained) {
+            spill_record(action_history.packed(i));
+        }
+    }
+    action_history.set_limit(limit);
+}
+
+void Game::spill_record(PackedAction record) {
+    if (std::fwrite(&record.bits, sizeof(record.bits), 1, history_spill.get()) != 1) {
+        throw std::runtime_error("Failed writing history spill");
+    }
+}
+
+void Game::refresh_blocker_index() {
+    for (int a = 0; a < ACTION_TYPE_COUNT; ++a) {
+        blocker_index[a] = 0;
+    }
+    for (size_t seat = 0; seat < players.size(); ++seat) {
+        auto role = players[seat]->get_role();
+        if (!role) {
+            continue;
+        }
+        for (int a = 0; a < ACTION_TYPE_COUNT; ++a) {
+            if (role->can_block_action(static_cast<ActionType>(a), nullptr, nullptr)) {
+                blocker_index[a] |= static_cast<uint8_t>(1 << seat);
+            }
+        }
+    }
+}
+
+void Game::role_changed(Player* player) {
+    int seat = seat_index(players, player);
+    if (seat < 0) {
+        return;
+    }
+    const auto& role = player->get_role();
+    for (int a = 0; a < ACTION_TYPE_COUNT; ++a) {
+        bool blocks = role && role->can_block_action(static_cast<ActionType>(a), nullptr, nullptr);
+        blocker_index[a] = static_cast<uint8_t>((blocker_index[a] & ~(1 << seat)) | (blocks << seat));
+    }
+    refresh_seat_checksum(seat);
+}
+
+void Game::save_undo_point() {
+    undo_state = capture_state();
+    undo_available = true;
+}
+
+uint8_t Game::eligible_blocker_mask() const {
+    if (action_history.empty() || action_history.packed_back().blocked() || last_actor_seat < 0 ||
+        action_history.packed_back().turn() != (turn_number & 0xffff)) {
+        return 0;
+    }
+    ActionType action = action_history.packed_back().action();
+    uint8_t mask = blocker_index[static_cast<int>(action)] & ~(1 << last_actor_seat);
+    if (action == ActionType::ARREST || action == ActionType::COUP) {
+        mask &= last_target_seat >= 0 ? (1 << last_target_seat) : 0;
+    }
+    return mask;
+}
+
+void Game::split_blocker_mask(uint8_t parts[2]) const {
+    // Seats after the actor come first, then the seats before it
+    uint8_t mask = eligible_blocker_mask();
+    parts[0] = mask & static_cast<uint8_t>(~((2u << last_actor_seat) - 1));
+    parts[1] = mask & static_cast<uint8_t>(~parts[0]);
+}
+
+Player* Game::pop_eligible_blocker(uint8_t parts[2]) const {
+    for (int p = 0; p < 2; ++p) {
+        while (parts[p]) {
+            int seat = __builtin_ctz(parts[p]);
+            parts[p] &= parts[p] - 1;
+            Player* player = players[seat].get();
+            if (player->is_player_active() &&
+                (action_history.packed_back().action() != ActionType::COUP || player->get_coins() >= rules.general_block_cost)) {
+                return player;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Player*> Game::eligible_blockers() const {
+    std::vector<Player*> blockers;
+    uint8_t parts[2];
+    split_blocker_mask(parts);
+    while (Player* blocker = pop_eligible_blocker(parts)) {
+        blockers.push_back(blocker);
+    }
+    return blockers;
+}
+
+Player* Game::run_reaction_window(const std::function<bool(Player& blocker, const ActionRecord& action)>& wants_to_block) {
+    uint8_t parts[2];
+    split_blocker_mask(parts);
+    ActionRecord action = action_history.back();
+    while (Player* blocker = pop_eligible_blocker(parts)) {
+        if (wants_to_block(*blocker, action)) {
+            resolve_block(blocker);
+            return blocker;
+        }
+    }
+    return nullptr;
+}
+
+void Game::resolve_block(Player* blocker) {
+    int seat = seat_index(players, blocker);
+    if (seat < 0 || !((eligible_blocker_mask() >> seat) & 1)) {
+        throw std::runtime_error("Player cannot block the last action");
+    }
+    PackedAction record = action_history.packed_back();
+    switch (record.action()) {
+        case ActionType::TAX:
+        case ActionType::ARREST:
+            if (undo_available) {
+                restore_state(undo_state);
+            }
+            break;
+        case ActionType::BRIBE:
+            // The bribe stays paid, only the extra turn is lost
+            reset_extra_turn();
+            break;
+        case ActionType::COUP: {
+            // The coup stays paid; the caller does not eliminate a target whose coup was blocked
+            auto general = std::dynamic_pointer_cast<General>(blocker->get_role());
+            if (!general || !general->block_coup(*blocker, *players[record.actor()], *this)) {
+                throw std::runtime_error("General cannot pay to block the coup");
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Action cannot be blocked");
+    }
+    undo_available = false;
+    block_last_action(blocker);
+    refresh_state_checksum();
+}
+
 std::shared_ptr<Player> Game::get_current_player() {
     if (!game_active) {
         return nullptr;
@@ -131,18 +484,219 @@ void Game::eliminate_player(Player* player) {
     if (active_count <= 1) {
         game_active = false;
     }
+    refresh_seat_checksum(seat_index(players, player));
+    refresh_table_checksum();
+}
+
+void Game::invest(Player* baron) {
+    int seat = seat_index(players, baron);
+    if (seat < 0) {
+        throw std::runtime_error("Player is not in this game");
+    }
+    auto role = std::dynamic_pointer_cast<Baron>(baron->get_role());
+    if (!role) {
+        throw std::runtime_error("Only a Baron can invest");
+    }
+    if (baron->get_coins() < rules.baron_invest_cost) {
+        throw std::runtime_error("Not enough coins to invest");
+    }
+    role->invest(*baron, rules);
+    // Not an action type, so nothing else rehashes the Baron's seat
+    refresh_seat_checksum(seat);
 }
 
 void Game::check_forced_coup() {
     auto current = players[current_player_index];
-    if (current->get_coins() >= 10) {
+    if (current->get_coins() >= rules.forced_coup_threshold) {
         // Player must perform coup this turn
         // This is enforced in the game logic
     }
 }
 
 void Game::clear_sanctions() {
-    for (auto& player : players) {
-        player->set_sanctioned(false);
+    for (size_t seat = 0; seat < players.size(); ++seat) {
+        if (players[seat]->is_player_sanctioned()) {
+            players[seat]->set_sanctioned(false);
+            refresh_seat_checksum(static_cast<int>(seat));
+        }
+    }
+}
+
+GameState Game::capture_state() const {
+    GameState state{};
+    state.treasury = treasury_coins;
+    state.player_count = static_cast<uint8_t>(players.size());
+    state.current_player = static_cast<uint8_t>(current_player_index);
+    state.game_active = game_active;
+    state.extra_turn = extra_turn_allowed;
+    
+    for (size_t i = 0; i < players.size(); ++i) {
+        state.players[i] = player_state(i);
+    }
+    return state;
+}
+
+PlayerState Game::player_state(size_t seat) const {
+    const Player& player = *players[seat];
+    PlayerState ps;
+    ps.coins = player.get_coins();
+    ps.role = player.get_role() ? static_cast<int8_t>(player.get_role()->get_type()) : -1;
+    ps.last_arrested = static_cast<int8_t>(seat_index(players, player.get_last_arrested()));
+    ps.active = player.is_player_active();
+    ps.sanctioned = player.is_player_sanctioned();
+    return ps;
+}
+
+void Game::restore_state(const GameState& state) {
+    if (state.player_count != players.size()) {
+        throw std::runtime_error("State does not match the seated players");
+    }
+    treasury_coins = state.treasury;
+    current_player_index = state.current_player;
+    game_active = state.game_active;
+    extra_turn_allowed = state.extra_turn;
+    
+    for (size_t i = 0; i < players.size(); ++i) {
+        Player& player = *players[i];
+        const PlayerState& ps = state.players[i];
+        player.set_coins(ps.coins);
+        
+        // Roles are only rebuilt when they changed, so restoring into a scratch game is cheap;
+        // set_role updates the seat's blockers
+        RoleType current_type = player.get_role() ? player.get_role()->get_type() : RoleType::GOVERNOR;
+        if (ps.role < 0) {
+            if (player.get_role()) {
+                player.set_role(nullptr);
+            }
+        } else if (!player.get_role() || current_type != static_cast<RoleType>(ps.role)) {
+            player.set_role(make_role(static_cast<RoleType>(ps.role)));
+        }
+        
+        player.set_last_arrested(ps.last_arrested >= 0 ? players[ps.last_arrested].get() : nullptr);
+        player.set_active(ps.active);
+        player.set_sanctioned(ps.sanctioned);
+    }
+    refresh_state_checksum();
+}
+
+void Game::save(std::vector<uint8_t>& out, size_t max_records) const {
+    GameState state = capture_state();
+    size_t names_size = 0;
+    for (const auto& player : players) {
+        if (player->get_name().size() > 255) {
+            throw std::invalid_argument("Player name too long to save: " + player->get_name());
+        }
+        names_size += 1 + player->get_name().size();
+    }
+
+    size_t records = std::min(action_history.retained(), max_records);
+    size_t first = action_history.size() - records;
+    size_t start = out.size();
+    out.resize(start + sizeof(SAVE_MAGIC) + sizeof(GameRules) + 2 * sizeof(GameState) + 3 + MAX_PLAYERS +
+               sizeof(history_prefix_hash) + names_size + sizeof(PlayerStats) * players.size() +
+               sizeof(uint32_t) + sizeof(uint64_t) +
+               sizeof(uint32_t) + sizeof(PackedAction) * records);
+    SaveWriter writer(out.data() + start);
+    writer.put(SAVE_MAGIC);
+    writer.put(rules);
+    writer.put(state);
+    writer.put(undo_state);
+    writer.put(static_cast<uint8_t>(roles_hidden | (coins_hidden << 1) | (undo_available << 2)));
+    writer.put(static_cast<int8_t>(last_actor_seat));
+    writer.put(static_cast<int8_t>(last_target_seat));
+    writer.put_bytes(coin_reveals, MAX_PLAYERS);
+    writer.put(history_prefix_hash);
+    for (const auto& player : players) {
+        writer.put(static_cast<uint8_t>(player->get_name().size()));
+        writer.put_bytes(player->get_name().data(), player->get_name().size());
     }
-}
\ No newline at end of file
+    writer.put_bytes(player_stats, sizeof(PlayerStats) * players.size());
+
+    // The retained history as packed records, numbered from its first index
+    writer.put(static_cast<uint32_t>(turn_number));
+    writer.put(static_cast<uint64_t>(first));
+    writer.put(static_cast<uint32_t>(records));
+    for (size_t i = first; i < action_history.size(); ++i) {
+        writer.put(action_history.packed(i));
+    }
+}
+
+void Game::load(const uint8_t* data, size_t size) {
+    // Parse everything before touching the game
+    SaveReader reader(data, size);
+    if (reader.get<uint32_t>() != SAVE_MAGIC) {
+        throw std::runtime_error("Not a game save");
+    }
+    GameRules saved_rules = reader.get<GameRules>();
+    GameState state = reader.get<GameState>();
+    GameState saved_undo = reader.get<GameState>();
+    uint8_t flags = reader.get<uint8_t>();
+    int actor_seat = reader.get<int8_t>();
+    int target_seat = reader.get<int8_t>();
+    const uint8_t* reveals = reader.take(MAX_PLAYERS);
+    uint64_t prefix_hash = reader.get<uint64_t>();
+    int count = state.player_count;
+    bool undo_saved = (flags >> 2) & 1;
+    // The undo point is restored by a later block, so it is checked as strictly as the state
+    if (count > MAX_PLAYERS || !fits_seats(state, count) || (undo_saved && !fits_seats(saved_undo, count)) ||
+        actor_seat >= count || target_seat >= count) {
+        throw std::runtime_error("Corrupt game save");
+    }
+
+    std::vector<std::shared_ptr<Player>> loaded;
+    for (int i = 0; i < count; ++i) {
+        uint8_t length = reader.get<uint8_t>();
+        const char* name = reinterpret_cast<const char*>(reader.take(length));
+        loaded.push_back(std::make_shared<Player>(std::string(name, length), saved_rules.starting_coins));
+    }
+
+    PlayerStats saved_stats[MAX_PLAYERS] = {};
+    for (int i = 0; i < count; ++i) {
+        saved_stats[i] = reader.get<PlayerStats>();
+        if (!saved_stats[i].is_valid()) {
+            throw std::runtime_error("Corrupt game save");
+        }
+    }
+
+    uint32_t saved_turn = reader.get<uint32_t>();
+    uint64_t first_index = reader.get<uint64_t>();
+    uint32_t records = reader.get<uint32_t>();
+    const uint8_t* packed = reader.take(static_cast<size_t>(records) * sizeof(PackedAction));
+    if (!reader.at_end()) {
+        throw std::runtime_error("Trailing bytes in game save");
+    }
+    std::vector<PackedAction> history(records);
+    std::memcpy(history.data(), packed, static_cast<size_t>(records) * sizeof(PackedAction));
+    for (PackedAction record : history) {
+        if (!record.is_valid(count)) {
+            throw std::runtime_error("Corrupt game save");
+        }
+    }
+
+    rules = saved_rules;
+    players.swap(loaded);
+    for (const auto& player : loaded) {
+        if (player->get_game() == this) {
+            player->set_game(nullptr);
+        }
+    }
+    std::vector<Player*> seats;
+    for (const auto& player : players) {
+        player->set_game(this);
+        seats.push_back(player.get());
+    }
+    action_history.set_seats(seats);
+    restore_state(state);
+    refresh_blocker_index();
+    undo_state = undo_saved ? saved_undo : GameState{};
+    roles_hidden = flags & 1;
+    coins_hidden = (flags >> 1) & 1;
+    undo_available = undo_saved;
+    last_actor_seat = actor_seat;
+    last_target_seat = target_seat;
+    std::memcpy(coin_reveals, reveals, MAX_PLAYERS);
+    history_prefix_hash = prefix_hash;
+    turn_number = saved_turn;
+    action_history.assign(first_index, history);
+    std::copy(saved_stats, saved_stats + MAX_PLAYERS, player_stats);
+}
@@ -0,0 +1,561 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/GameHost.hpp"
+#include "../include/Player.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Timer payloads carry the game id and which of its timers fired
+const uint64_t TURN_TIMER = 0;
+const uint64_t WINDOW_TIMER = 1;
+
+// Journal record types; every payload starts with the game id
+const uint8_t LOG_CREATE = 1;            // Rules, player count, roles
+const uint8_t LOG_MOVE = 2;              // Seat, move type, target
+const uint8_t LOG_BLOCK = 3;             // Seat
+const uint8_t LOG_WINDOW_EXPIRED = 4;
+const uint8_t LOG_SKIP = 5;              // Turn skipped because nothing was legal
+const uint8_t LOG_REMOVE = 6;
+const uint8_t LOG_ADOPT = 7;             // Game save
+const uint8_t CHECKPOINT_HEADER = 16;    // Journal generation that follows the checkpoint
+const uint8_t CHECKPOINT_GAME = 17;      // Phase, pending move, game save
+
+static_assert(std::is_trivially_copyable<GameRules>::value, "Rules are journaled as raw bytes");
+
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+class PayloadReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+
+public:
+    PayloadReader(const uint8_t* payload, size_t payload_size) : data(payload), size(payload_size), position(0) {}
+
+    template <typename T>
+    T get() {
+        if (size - position < sizeof(T)) {
+            throw std::runtime_error("Truncated journal record");
+        }
+        T value;
+        std::memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+};
+
+std::string journal_path(const std::string& directory, uint64_t generation) {
+    return directory + "/journal." + std::to_string(generation);
+}
+
+std::string checkpoint_path(const std::string& directory) {
+    return directory + "/checkpoint";
+}
+
+// Writes, flushes and atomically renames, so a crash leaves either checkpoint whole
+void write_checkpoint(const std::string& directory, const std::vector<uint8_t>& file) {
+    std::string final_path = checkpoint_path(directory);
+    std::string temporary = final_path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot write checkpoint " + temporary);
+    }
+    size_t written = 0;
+    while (written < file.size()) {
+        ssize_t n = ::write(fd, file.data() + written, file.size() - written);
+        if (n <= 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed writing checkpoint");
+        }
+        written += n;
+    }
+    bool ok = ::fdatasync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), final_path.c_str()) != 0) {
+        throw std::runtime_error("Failed writing checkpoint");
+    }
+    int dir = ::open(directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+}
+
+} // namespace
+
+GameHost::HostedGame::HostedGame(const GameRules& rules)
+    : game(rules), phase(Phase::AWAITING_MOVE), pending(MoveType::GATHER), blocker(-1), timer(0),
+      snapshot(std::make_shared<SnapshotPublisher>()) {
+}
+
+GameHost::GameHost(const HostOptions& host_options, uint64_t start_ms)
+    : options(host_options), wheel(start_ms / std::max<uint64_t>(host_options.tick_ms, 1)), journal_generation(0),
+      records_since_checkpoint(0) {
+    if (options.tick_ms == 0) {
+        throw std::invalid_argument("Timer tick must be at least 1 ms");
+    }
+}
+
+GameHost::HostedGame& GameHost::hosted(uint64_t id) const {
+    if (id >= games.size() || !games[id]) {
+        throw std::invalid_argument("No such game: " + std::to_string(id));
+    }
+    return *games[id];
+}
+
+void GameHost::emit(HostEventType type, uint64_t id, int seat, const Move& move) {
+    if (listener) {
+        listener(HostEvent{type, id, seat, move, hosted(id).game.get_state_checksum()});
+    }
+}
+
+uint64_t GameHost::install(std::unique_ptr<HostedGame> hosted_game, uint64_t id) {
+    hosted_game->game.set_history_limit(options.history_limit);
+    hosted_game->snapshot->publish(hosted_game->game);
+    if (options.keyframe_interval > 0) {
+        hosted_game->timeline.reset(new GameTimeline(hosted_game->game, options.keyframe_interval));
+    }
+    if (id >= games.size()) {
+        games.resize(id + 1);
+    }
+    games[id] = std::move(hosted_game);
+    return id;
+}
+
+uint64_t GameHost::create_game(const std::vector<RoleType>& roles, const GameRules& rules) {
+    std::unique_ptr<HostedGame> hosted_game(new HostedGame(rules));
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("P" + std::to_string(i + 1), rules.starting_coins);
+        player->set_role(make_role(roles[i]));
+        hosted_game->game.add_player(player);
+    }
+    hosted_game->game.start_game();
+
+    uint64_t id = games.size();
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+    if (journal) {
+        std::vector<uint8_t> payload;
+        put(payload, id);
+        put(payload, rules);
+        put(payload, static_cast<uint8_t>(roles.size()));
+        for (RoleType role : roles) {
+            put(payload, static_cast<uint8_t>(role));
+        }
+        log(LOG_CREATE, payload);
+    }
+    install(std::move(hosted_game), id);
+    start_turn(id);
+    return id;
+}
+
+void GameHost::remove_game(uint64_t id) {
+    wheel.cancel(hosted(id).timer);
+    if (journal) {
+        std::vector<uint8_t> payload;
+        put(payload, id);
+        log(LOG_REMOVE, payload);
+    }
+    games[id].reset();
+    free_ids.push_back(id);
+}
+
+std::vector<uint8_t> GameHost::detach_game(uint64_t id) {
+    HostedGame& hosted_game = hosted(id);
+    if (hosted_game.phase == Phase::REACTION) {
+        throw std::invalid_argument("Cannot move a game while its reaction window is open");
+    }
+    std::vector<uint8_t> save;
+    hosted_game.game.save(save);
+    remove_game(id);
+    return save;
+}
+
+uint64_t GameHost::adopt_game(const std::vector<uint8_t>& save) {
+    std::unique_ptr<HostedGame> hosted_game(new HostedGame(GameRules::defaults()));
+    hosted_game->game.load(save.data(), save.size());
+
+    uint64_t id = games.size();
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+    if (journal) {
+        std::vector<uint8_t> payload;
+        put(payload, id);
+        payload.insert(payload.end(), save.begin(), save.end());
+        log(LOG_ADOPT, payload);
+    }
+    bool active = hosted_game->game.is_game_active();
+    install(std::move(hosted_game), id);
+    if (active) {
+        start_turn(id);
+    } else {
+        games[id]->phase = Phase::FINISHED;
+    }
+    return id;
+}
+
+void GameHost::publish(HostedGame& hosted_game) {
+    hosted_game.snapshot->publish(hosted_game.game);
+    if (hosted_game.feed) {
+        hosted_game.feed->publish();
+    }
+}
+
+size_t GameHost::get_turn_count(uint64_t id) const {
+    const HostedGame& hosted_game = hosted(id);
+    return hosted_game.timeline ? hosted_game.timeline->turn_count() : 0;
+}
+
+void GameHost::game_at_turn(uint64_t id, size_t turn, Game& out) const {
+    const HostedGame& hosted_game = hosted(id);
+    if (!hosted_game.timeline) {
+        throw std::invalid_argument("Host keeps no timeline");
+    }
+    hosted_game.timeline->materialize(turn, out);
+}
+
+uint64_t GameHost::watch(uint64_t id, const SpectatorFeed::Sender& send) {
+    HostedGame& hosted_game = hosted(id);
+    if (!hosted_game.feed) {
+        hosted_game.feed.reset(new SpectatorFeed(hosted_game.game));
+    }
+    return hosted_game.feed->subscribe(send);
+}
+
+bool GameHost::unwatch(uint64_t id, uint64_t subscription) {
+    HostedGame& hosted_game = hosted(id);
+    return hosted_game.feed && hosted_game.feed->unsubscribe(subscription);
+}
+
+void GameHost::start_turn(uint64_t id) {
+    HostedGame& hosted_game = *games[id];
+    hosted_game.phase = Phase::AWAITING_MOVE;
+    if (options.keyframe_interval > 0 && !hosted_game.timeline) {
+        hosted_game.timeline.reset(new GameTimeline(hosted_game.game, options.keyframe_interval));
+    }
+    hosted_game.timer = wheel.schedule(ticks(options.turn_timeout_ms), id * 2 + TURN_TIMER);
+}
+
+void GameHost::finish_move(uint64_t id) {
+    HostedGame& hosted_game = *games[id];
+    Game& game = hosted_game.game;
+    complete_move(game, hosted_game.pending);
+    if (hosted_game.timeline) {
+        hosted_game.timeline->record(game, hosted_game.pending, hosted_game.blocker);
+    }
+    publish(hosted_game);
+    if (!game.is_game_active()) {
+        hosted_game.phase = Phase::FINISHED;
+        hosted_game.timer = 0;
+        int winner = -1;
+        for (size_t seat = 0; seat < game.get_player_count(); ++seat) {
+            if (game.get_player_at(seat)->is_player_active()) {
+                winner = static_cast<int>(seat);
+            }
+        }
+        emit(HostEventType::GAME_OVER, id, winner, hosted_game.pending);
+        return;
+    }
+    start_turn(id);
+}
+
+void GameHost::submit_move(uint64_t id, int seat, const Move& move) {
+    HostedGame& hosted_game = hosted(id);
+    Game& game = hosted_game.game;
+    if (hosted_game.phase != Phase::AWAITING_MOVE || seat != game.get_current_player_index()) {
+        throw std::invalid_argument("Not this player's turn");
+    }
+    if (!is_legal_move(game, move)) {
+        throw std::invalid_argument("Illegal move");
+    }
+
+    if (journal) {
+        std::vector<uint8_t> payload;
+        put(payload, id);
+        put(payload, static_cast<uint8_t>(seat));
+        put(payload, static_cast<uint8_t>(move.type));
+        put(payload, static_cast<int8_t>(move.target));
+        log(LOG_MOVE, payload);
+    }
+    wheel.cancel(hosted_game.timer);
+    play_action(game, move);
+    hosted_game.pending = move;
+    hosted_game.blocker = -1;
+    stats.moves++;
+    emit(HostEventType::MOVE_PLAYED, id, seat, move);
+
+    if (!reaction_blockers(game, move).empty()) {
+        publish(hosted_game);
+        hosted_game.phase = Phase::REACTION;
+        hosted_game.timer = wheel.schedule(ticks(options.block_window_ms), id * 2 + WINDOW_TIMER);
+        stats.windows_opened++;
+        return;
+    }
+    finish_move(id);
+}
+
+void GameHost::submit_block(uint64_t id, int seat) {
+    HostedGame& hosted_game = hosted(id);
+    Game& game = hosted_game.game;
+    if (hosted_game.phase != Phase::REACTION || seat < 0 || seat >= static_cast<int>(game.get_player_count())) {
+        throw std::invalid_argument("No action to block");
+    }
+    std::vector<Player*> blockers = game.eligible_blockers();
+    Player* blocker = game.get_player_at(seat);
+    if (std::find(blockers.begin(), blockers.end(), blocker) == blockers.end()) {
+        throw std::invalid_argument("Player cannot block this action");
+    }
+
+    if (journal) {
+        std::vector<uint8_t> payload;
+        put(payload, id);
+        put(payload, static_cast<uint8_t>(seat));
+        log(LOG_BLOCK, payload);
+    }
+    wheel.cancel(hosted_game.timer);
+    game.resolve_block(blocker);
+    hosted_game.blocker = seat;
+    stats.blocks++;
+    emit(HostEventType::BLOCKED, id, seat, hosted_game.pending);
+    finish_move(id);
+}
+
+void GameHost::on_timer(uint64_t payload) {
+    uint64_t id = payload / 2;
+    HostedGame& hosted_game = *games[id];
+    hosted_game.timer = 0;
+
+    std::vector<uint8_t> record;
+    if (journal) {
+        put(record, id);
+    }
+    if (payload % 2 == WINDOW_TIMER) {
+        if (journal) {
+            log(LOG_WINDOW_EXPIRED, record);
+        }
+        stats.windows_expired++;
+        finish_move(id);
+        return;
+    }
+
+    // Timed-out turn: the default move is played for the player
+    stats.turn_timeouts++;
+    Game& game = hosted_game.game;
+    int seat = game.get_current_player_index();
+    if (legal_moves(game).empty()) {
+        if (journal) {
+            log(LOG_SKIP, record);
+        }
+        game.next_turn();
+        if (hosted_game.timeline) {
+            hosted_game.timeline->record_skip(game);
+        }
+        publish(hosted_game);
+        start_turn(id);
+        return;
+    }
+    Move move = default_move(game);
+    emit(HostEventType::AUTO_MOVE, id, seat, move);
+    submit_move(id, seat, move);
+}
+
+void GameHost::advance(uint64_t now_ms) {
+    wheel.advance(now_ms / options.tick_ms, [this](uint64_t payload) { on_timer(payload); });
+    if (journal && journal_options.snapshot_every > 0 && records_since_checkpoint >= journal_options.snapshot_every) {
+        checkpoint();
+    }
+}
+
+void GameHost::log(uint8_t type, const std::vector<uint8_t>& payload) {
+    journal->append(type, payload);
+    records_since_checkpoint++;
+}
+
+void GameHost::restore_game(const uint8_t* payload, size_t size) {
+    PayloadReader in(payload, size);
+    uint64_t id = in.get<uint64_t>();
+    Phase phase = static_cast<Phase>(in.get<uint8_t>());
+    MoveType pending_type = static_cast<MoveType>(in.get<uint8_t>());
+    int pending_target = in.get<int8_t>();
+    const size_t header = sizeof(id) + 3;
+
+    // The save brings back names, history, statistics and hidden information with the state
+    std::unique_ptr<HostedGame> hosted_game(new HostedGame(GameRules::defaults()));
+    hosted_game->game.load(payload + header, size - header);
+    install(std::move(hosted_game), id);
+    HostedGame& restored = *games[id];
+    if (phase == Phase::FINISHED) {
+        restored.phase = Phase::FINISHED;
+        return;
+    }
+    if (phase == Phase::REACTION) {
+        // Saved after the pending action, with the undo point a block needs; the timeline
+        // starts with the next turn, since its first keyframe must fall between turns
+        restored.timeline.reset();
+        restored.phase = Phase::REACTION;
+        restored.pending = Move(pending_type, pending_target);
+        restored.blocker = -1;
+        restored.timer = wheel.schedule(ticks(options.block_window_ms), id * 2 + WINDOW_TIMER);
+        return;
+    }
+    start_turn(id);
+}
+
+void GameHost::replay(uint8_t type, const uint8_t* payload, size_t size) {
+    PayloadReader in(payload, size);
+    uint64_t id = in.get<uint64_t>();
+    switch (type) {
+        case LOG_CREATE: {
+            GameRules rules = in.get<GameRules>();
+            std::vector<RoleType> roles(in.get<uint8_t>());
+            for (RoleType& role : roles) {
+                role = static_cast<RoleType>(in.get<uint8_t>());
+            }
+            free_ids.push_back(id);
+            if (create_game(roles, rules) != id) {
+                throw std::runtime_error("Journal created a game in the wrong slot");
+            }
+            break;
+        }
+        case LOG_MOVE: {
+            int seat = in.get<uint8_t>();
+            MoveType move_type = static_cast<MoveType>(in.get<uint8_t>());
+            int target = in.get<int8_t>();
+            submit_move(id, seat, Move(move_type, target));
+            break;
+        }
+        case LOG_BLOCK:
+            submit_block(id, in.get<uint8_t>());
+            break;
+        case LOG_WINDOW_EXPIRED:
+        case LOG_SKIP:
+            // Timers fire the same way they did before the crash
+            wheel.cancel(hosted(id).timer);
+            on_timer(id * 2 + (type == LOG_WINDOW_EXPIRED ? WINDOW_TIMER : TURN_TIMER));
+            break;
+        case LOG_REMOVE:
+            remove_game(id);
+            break;
+        case LOG_ADOPT:
+            free_ids.push_back(id);
+            if (adopt_game(std::vector<uint8_t>(payload + sizeof(id), payload + size)) != id) {
+                throw std::runtime_error("Journal adopted a game in the wrong slot");
+            }
+            break;
+        default:
+            throw std::runtime_error("Unknown journal record type " + std::to_string(type));
+    }
+}
+
+size_t GameHost::open_journal(const std::string& directory, const JournalOptions& options_for_journal) {
+    if (journal) {
+        throw std::runtime_error("Journal is already open");
+    }
+    std::filesystem::create_directories(directory);
+
+    // The checkpoint names the journal generation written after it
+    uint64_t generation = 0;
+    Journal::read(checkpoint_path(directory), [&](uint8_t type, const uint8_t* payload, size_t size) {
+        if (type == CHECKPOINT_HEADER) {
+            generation = PayloadReader(payload, size).get<uint64_t>();
+        } else if (type == CHECKPOINT_GAME) {
+            restore_game(payload, size);
+        }
+    });
+    uint64_t intact = 0;
+    std::string path = journal_path(directory, generation);
+    Journal::read(path, [this](uint8_t type, const uint8_t* payload, size_t size) { replay(type, payload, size); },
+                  &intact);
+    if (std::filesystem::exists(path) && std::filesystem::file_size(path) != intact) {
+        // Cut off the record a crash left half written
+        std::filesystem::resize_file(path, intact);
+    }
+
+    free_ids.clear();
+    size_t restored = 0;
+    for (uint64_t id = 0; id < games.size(); ++id) {
+        if (games[id]) {
+            restored++;
+        } else {
+            free_ids.push_back(id);
+        }
+    }
+    std::reverse(free_ids.begin(), free_ids.end());
+
+    journal_directory = directory;
+    journal_options = options_for_journal;
+    journal_generation = generation;
+    records_since_checkpoint = 0;
+    journal.reset(new Journal(path, journal_options));
+    return restored;
+}
+
+void GameHost::checkpoint() {
+    if (!journal) {
+        throw std::runtime_error("No journal is open");
+    }
+    // Only the saves are taken on the host thread, each copied out of a reused buffer so the
+    // copies come from the warm heap. The next journal's committer finishes the checkpoint
+    // before it commits anything: it flushes the old journal's tail, frames and writes the
+    // checkpoint, then deletes the old journal. A crash before the rename recovers from the
+    // old checkpoint and the whole old journal, and nothing after them is on disk yet.
+    std::vector<std::vector<uint8_t>> saves;
+    std::vector<uint8_t> payload;
+    for (uint64_t id = 0; id < games.size(); ++id) {
+        if (!games[id]) {
+            continue;
+        }
+        const HostedGame& hosted_game = *games[id];
+        payload.clear();
+        put(payload, id);
+        put(payload, static_cast<uint8_t>(hosted_game.phase));
+        put(payload, static_cast<uint8_t>(hosted_game.pending.type));
+        put(payload, static_cast<int8_t>(hosted_game.pending.target));
+        hosted_game.game.save(payload);
+        saves.push_back(payload);
+    }
+
+    std::shared_ptr<Journal> previous(std::move(journal));
+    std::string previous_path = journal_path(journal_directory, journal_generation);
+    journal_generation++;
+    records_since_checkpoint = 0;
+    auto finish = [previous, previous_path, directory = journal_directory, generation = journal_generation,
+                   saves = std::move(saves)]() mutable {
+        previous.reset();
+        std::vector<uint8_t> file;
+        std::vector<uint8_t> header;
+        put(header, generation);
+        Journal::frame(CHECKPOINT_HEADER, header.data(), header.size(), file);
+        for (const std::vector<uint8_t>& save : saves) {
+            Journal::frame(CHECKPOINT_GAME, save.data(), save.size(), file);
+        }
+        write_checkpoint(directory, file);
+        std::filesystem::remove(previous_path);
+    };
+    journal.reset(new Journal(journal_path(journal_directory, journal_generation), journal_options, std::move(finish)));
+    stats.checkpoints++;
+}
+
+void GameHost::sync_journal() {
+    if (journal) {
+        journal->sync();
+    }
+}
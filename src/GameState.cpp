@@ -0,0 +1,101 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/GameState.hpp"
+#include <algorithm>
+#include <tuple>
+
+namespace {
+
+// Sort key of one player; the last-arrested target is described by its own role and coins
+// so that ties are only left between players that are truly interchangeable
+std::tuple<int, int, int, int, int, int> seat_key(const GameState& state, int seat) {
+    const PlayerState& ps = state.players[seat];
+    int target = -2;
+    int target_coins = -1;
+    if (ps.last_arrested == state.current_player) {
+        target = -1;
+    } else if (ps.last_arrested >= 0) {
+        target = state.players[ps.last_arrested].role;
+        target_coins = state.players[ps.last_arrested].coins;
+    }
+    return std::make_tuple(ps.role, ps.coins, !ps.active, ps.sanctioned, target, target_coins);
+}
+
+uint64_t mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash *= 0xff51afd7ed558ccdULL;
+    return hash ^ (hash >> 32);
+}
+
+} // namespace
+
+CanonicalState canonicalize(const GameState& state) {
+    CanonicalState result;
+    int count = state.player_count;
+
+    uint8_t order[MAX_PLAYERS];
+    int filled = 0;
+    order[filled++] = state.current_player;
+    for (int seat = 0; seat < count; ++seat) {
+        if (seat != state.current_player) {
+            order[filled++] = static_cast<uint8_t>(seat);
+        }
+    }
+    std::stable_sort(order + 1, order + count, [&](uint8_t a, uint8_t b) {
+        return seat_key(state, a) < seat_key(state, b);
+    });
+
+    result.state = state;
+    result.state.current_player = 0;
+    for (int slot = 0; slot < MAX_PLAYERS; ++slot) {
+        result.original_seat[slot] = static_cast<uint8_t>(slot);
+        result.canonical_seat[slot] = static_cast<uint8_t>(slot);
+    }
+    for (int slot = 0; slot < count; ++slot) {
+        result.original_seat[slot] = order[slot];
+        result.canonical_seat[order[slot]] = static_cast<uint8_t>(slot);
+    }
+    for (int slot = 0; slot < count; ++slot) {
+        PlayerState ps = state.players[order[slot]];
+        if (ps.last_arrested >= 0) {
+            ps.last_arrested = static_cast<int8_t>(result.canonical_seat[ps.last_arrested]);
+        }
+        result.state.players[slot] = ps;
+    }
+    return result;
+}
+
+uint64_t hash_state(const GameState& state) {
+    uint64_t hash = mix(0, static_cast<uint32_t>(state.treasury));
+    hash = mix(hash, state.player_count | (state.current_player << 8) | (state.game_active << 16) |
+                     (state.extra_turn << 17));
+    for (int seat = 0; seat < state.player_count; ++seat) {
+        const PlayerState& ps = state.players[seat];
+        hash = mix(hash, static_cast<uint32_t>(ps.coins));
+        hash = mix(hash, static_cast<uint8_t>(ps.role) | (static_cast<uint8_t>(ps.last_arrested) << 8) |
+                         (ps.active << 16) | (ps.sanctioned << 17));
+    }
+    return hash;
+}
+
+uint64_t checksum_table(int32_t treasury, uint8_t player_count, uint8_t current_player, bool game_active,
+                        bool extra_turn) {
+    uint64_t fields = player_count | (current_player << 8) | (game_active << 16) | (extra_turn << 17);
+    return mix(MAX_PLAYERS, (static_cast<uint64_t>(static_cast<uint32_t>(treasury)) << 32) | fields);
+}
+
+// One mix per seat keeps the incremental update in Game cheap
+uint64_t checksum_seat(int seat, const PlayerState& player) {
+    uint64_t fields = static_cast<uint8_t>(player.role) | (static_cast<uint8_t>(player.last_arrested) << 8) |
+                      (player.active << 16) | (player.sanctioned << 17);
+    return mix(seat, (static_cast<uint64_t>(static_cast<uint32_t>(player.coins)) << 32) | fields);
+}
+
+uint64_t state_checksum(const GameState& state) {
+    uint64_t checksum = checksum_table(state.treasury, state.player_count, state.current_player, state.game_active,
+                                       state.extra_turn);
+    for (int seat = 0; seat < state.player_count; ++seat) {
+        checksum ^= checksum_seat(seat, state.players[seat]);
+    }
+    return checksum;
+}
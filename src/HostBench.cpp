@@ -0,0 +1,182 @@
+// yaacovkrawiec@gmail.com
+
+// Hosted action latency benchmark.
+// Plays random legal moves across many hosted games and times every submit_move, first on a
+// host without a journal and then on one journaling to --journal, and reports the latency
+// percentiles of both, up to the worst move, and what journaling adds at each. Block windows
+// are left to expire. Automatic checkpoints start inside advance(), between moves, so every
+// advance() is timed too and its worst stall is reported next to the worst move.
+//
+// Examples:
+//   ./coup_hostbench --journal /tmp/coup_journal
+//   ./coup_hostbench --journal /tmp/coup_journal --games 1000 --moves 1000000 --snapshot-every 50000
+
+#include "../include/GameHost.hpp"
+#include "../include/Player.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: coup_hostbench --journal DIR [--games N] [--moves N] [--snapshot-every N] [--seed N]\n";
+}
+
+struct Latencies {
+    std::vector<double> moves;           // Microseconds per submit_move
+    std::vector<double> advances;        // Microseconds per advance()
+    std::vector<double> checkpoints;     // Microseconds per advance() that started a checkpoint
+};
+
+double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+// Same seed, same moves: both hosts see an identical workload
+Latencies run(size_t game_count, size_t move_count, uint64_t seed, const std::string& directory,
+              const JournalOptions& journal_options) {
+    HostOptions options;
+    // Every round of moves advances the clock by one block window, so only turns with nothing
+    // legal to play time out
+    options.block_window_ms = options.tick_ms;
+    options.turn_timeout_ms = 20 * options.tick_ms;
+    GameHost host(options);
+    if (!directory.empty()) {
+        host.open_journal(directory, journal_options);
+    }
+
+    std::mt19937_64 rng(seed);
+    auto random_roles = [&rng]() {
+        std::vector<RoleType> roles(2 + rng() % 5);
+        for (RoleType& role : roles) {
+            role = static_cast<RoleType>(rng() % 6);
+        }
+        return roles;
+    };
+    std::vector<uint64_t> ids;
+    for (size_t g = 0; g < game_count; ++g) {
+        ids.push_back(host.create_game(random_roles()));
+    }
+
+    Latencies latencies;
+    latencies.moves.reserve(move_count);
+    uint64_t now_ms = 0;
+    while (latencies.moves.size() < move_count) {
+        for (uint64_t& id : ids) {
+            const Game& game = host.get_game(id);
+            if (!game.is_game_active()) {
+                host.remove_game(id);
+                id = host.create_game(random_roles());
+            }
+            if (host.is_reaction_open(id)) {
+                continue;
+            }
+            std::vector<Move> moves = legal_moves(host.get_game(id));
+            if (moves.empty()) {
+                continue;                // Skipped once its turn times out
+            }
+            Move move = moves[rng() % moves.size()];
+            int seat = host.get_game(id).get_current_player_index();
+            auto start = std::chrono::steady_clock::now();
+            host.submit_move(id, seat, move);
+            latencies.moves.push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            if (latencies.moves.size() == move_count) {
+                break;
+            }
+        }
+        // Expire the open block windows; a checkpoint, if one is due, starts here
+        now_ms += options.block_window_ms;
+        uint64_t checkpoints = host.get_stats().checkpoints;
+        auto start = std::chrono::steady_clock::now();
+        host.advance(now_ms);
+        double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        latencies.advances.push_back(elapsed);
+        if (host.get_stats().checkpoints != checkpoints) {
+            latencies.checkpoints.push_back(elapsed);
+        }
+    }
+    host.sync_journal();
+    return latencies;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string directory;
+    size_t game_count = 1000;
+    size_t move_count = 200000;
+    uint64_t seed = 1;
+    JournalOptions journal_options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--journal") directory = next();
+            else if (arg == "--games") game_count = std::stoull(next());
+            else if (arg == "--moves") move_count = std::stoull(next());
+            else if (arg == "--snapshot-every") journal_options.snapshot_every = std::stoull(next());
+            else if (arg == "--seed") seed = std::stoull(next());
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (directory.empty()) {
+            throw std::invalid_argument("Missing --journal");
+        }
+        if (game_count == 0) {
+            throw std::invalid_argument("--games must be at least 1");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    try {
+        // Start from an empty directory so nothing is recovered into the run
+        std::filesystem::remove_all(directory);
+        Latencies plain = run(game_count, move_count, seed, "", journal_options);
+        Latencies journaled = run(game_count, move_count, seed, directory, journal_options);
+        std::filesystem::remove_all(directory);
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << "submit_move latency over " << move_count << " moves in " << game_count << " games (us)\n"
+                  << "percentile\tplain\tjournaled\tadded\n";
+        const char* labels[] = {"p50", "p90", "p99", "p99.9", "max"};
+        const double fractions[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+        for (int i = 0; i < 5; ++i) {
+            double a = percentile(plain.moves, fractions[i]);
+            double b = percentile(journaled.moves, fractions[i]);
+            std::cout << labels[i] << "\t\t" << a << "\t" << b << "\t\t" << b - a << "\n";
+        }
+        // The event loop stalls for as long as advance() runs, checkpoints included
+        std::cout << "advance() max\t" << percentile(plain.advances, 1.0) << "\t"
+                  << percentile(journaled.advances, 1.0) << "\n"
+                  << "checkpoints:\t" << journaled.checkpoints.size();
+        if (!journaled.checkpoints.empty()) {
+            std::cout << ", median " << percentile(journaled.checkpoints, 0.5) << " us, max "
+                      << percentile(journaled.checkpoints, 1.0) << " us in advance()";
+        }
+        std::cout << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
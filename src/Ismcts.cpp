@@ -0,0 +1,337 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Ismcts.hpp"
+#include "../include/Player.hpp"
+#include "../include/PlayerView.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int PASS_KEY = 63;                 // Turn skipped because nothing was legal
+
+int move_key(const Move& move) {
+    return static_cast<int>(move.type) * 8 + move.target + 1;
+}
+
+Move key_move(int key) {
+    return Move(static_cast<MoveType>(key / 8), key % 8 - 1);
+}
+
+bool role_can_block(RoleType role, const ActionRecord& record) {
+    return make_role(role)->can_block_action(record.action, record.actor, record.target);
+}
+
+struct Node {
+    int key;                             // Mover seat * 64 + move key
+    int mover;                           // Seat that made the move leading here, -1 at the root
+    std::vector<int> children;
+    double reward;
+    uint32_t visits;
+    uint32_t available;                  // Iterations in which this move was legal
+};
+
+// One thread's search tree
+class SearchTree {
+private:
+    const Determinizer& determinizer;
+    const IsmctsOptions& options;
+    std::mt19937_64 rng;
+    Game game;
+    std::vector<Node> nodes;
+
+    void play(int key) {
+        if (key % 64 == PASS_KEY) {
+            game.next_turn();
+        } else {
+            apply_move(game, key_move(key % 64));
+        }
+    }
+
+    int add_child(int parent, int key, int mover) {
+        nodes.push_back(Node{key, mover, {}, 0.0, 0, 1});
+        nodes[parent].children.push_back(static_cast<int>(nodes.size() - 1));
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+public:
+    SearchTree(const Determinizer& sampler, const IsmctsOptions& search_options, const GameRules& rules,
+               size_t player_count, uint64_t seed)
+        : determinizer(sampler), options(search_options), rng(seed), game(rules) {
+        for (size_t i = 0; i < player_count; ++i) {
+            game.add_player(std::make_shared<Player>("P" + std::to_string(i + 1)));
+        }
+        game.start_game();
+        nodes.push_back(Node{-1, -1, {}, 0.0, 0, 0});
+    }
+
+    void iterate() {
+        game.restore_state(determinizer.sample(rng));
+        game.clear_action_history();
+
+        // Selection and expansion, restricted to the moves legal in this determinization
+        std::vector<int> path(1, 0);
+        std::vector<int> keys;
+        std::vector<int> untried;
+        int node = 0;
+        bool expanded = false;
+        while (game.is_game_active() && !expanded) {
+            int mover = game.get_current_player_index();
+            keys.clear();
+            for (const Move& move : legal_moves(game)) {
+                keys.push_back(mover * 64 + move_key(move));
+            }
+            if (keys.empty()) {
+                keys.push_back(mover * 64 + PASS_KEY);
+            }
+
+            untried.clear();
+            int best = -1;
+            double best_score = -1.0;
+            for (int key : keys) {
+                int child = -1;
+                for (int c : nodes[node].children) {
+                    if (nodes[c].key == key) {
+                        child = c;
+                        break;
+                    }
+                }
+                if (child < 0) {
+                    untried.push_back(key);
+                    continue;
+                }
+                Node& n = nodes[child];
+                n.available++;
+                double score = n.reward / n.visits + options.exploration * std::sqrt(std::log(n.available) / n.visits);
+                if (score > best_score) {
+                    best_score = score;
+                    best = child;
+                }
+            }
+
+            int key;
+            if (!untried.empty()) {
+                key = untried[rng() % untried.size()];
+                node = add_child(node, key, mover);
+                expanded = true;
+            } else {
+                node = best;
+                key = nodes[node].key;
+            }
+            path.push_back(node);
+            play(key);
+        }
+
+        // Random playout
+        for (int turn = 0; turn < options.rollout_turns && game.is_game_active(); ++turn) {
+            std::vector<Move> moves = legal_moves(game);
+            if (moves.empty()) {
+                game.next_turn();
+            } else {
+                apply_move(game, moves[rng() % moves.size()]);
+            }
+        }
+
+        // The winner scores 1; an unfinished playout is shared by the players still in
+        std::vector<double> reward(game.get_player_count(), 0.0);
+        int alive = 0;
+        for (size_t i = 0; i < game.get_player_count(); ++i) {
+            alive += game.get_player_at(i)->is_player_active();
+        }
+        for (size_t i = 0; i < game.get_player_count(); ++i) {
+            if (game.get_player_at(i)->is_player_active()) {
+                reward[i] = 1.0 / alive;
+            }
+        }
+
+        for (int n : path) {
+            nodes[n].visits++;
+            if (nodes[n].mover >= 0) {
+                nodes[n].reward += reward[nodes[n].mover];
+            }
+        }
+    }
+
+    void add_root_visits(std::map<int, uint64_t>& visits) const {
+        for (int c : nodes[0].children) {
+            visits[nodes[c].key % 64] += nodes[c].visits;
+        }
+    }
+};
+
+} // namespace
+
+Determinizer::Determinizer(const Game& game, int observer_seat)
+    : observed(game.capture_state()), candidates(game.get_player_count()),
+      coins_hidden(game.get_player_count(), false), estimated_coins(game.get_player_count(), 0),
+      taxes(game.get_player_count(), 0) {
+    const GameRules& rules = game.get_rules();
+    governor_tax_bonus = rules.governor_tax_amount - rules.tax_amount;
+    PlayerView view(game, observer_seat);
+    size_t count = game.get_player_count();
+
+    for (size_t seat = 0; seat < count; ++seat) {
+        if (!view.is_role_visible(seat)) {
+            observed.players[seat].role = -1;
+            for (int r = 0; r < 6; ++r) {
+                candidates[seat].push_back(static_cast<RoleType>(r));
+            }
+        }
+        if (!view.is_coins_visible(seat)) {
+            observed.players[seat].coins = 0;
+            coins_hidden[seat] = true;
+            estimated_coins[seat] = rules.starting_coins;
+        }
+    }
+
+    // Replay the public history: block evidence and coin flows
+    const ActionHistory& history = game.get_action_history();
+    for (size_t i = history.first_index(); i < history.size(); ++i) {
+        ActionRecord record = history[i];
+        PackedAction packed = history.packed(i);
+        int actor = packed.actor();
+        int target = packed.target();
+        int blocker = packed.blocker();
+        if (actor < 0) {
+            continue;
+        }
+        if (blocker >= 0 && !candidates[blocker].empty()) {
+            std::vector<RoleType> consistent;
+            for (RoleType role : candidates[blocker]) {
+                if (role_can_block(role, record)) {
+                    consistent.push_back(role);
+                }
+            }
+            // Contradictory evidence leaves the candidates unchanged
+            if (!consistent.empty()) {
+                candidates[blocker].swap(consistent);
+            }
+        }
+
+        switch (record.action) {
+            case ActionType::GATHER:
+                if (!record.was_blocked) estimated_coins[actor] += rules.gather_amount;
+                break;
+            case ActionType::TAX:
+                if (!record.was_blocked) {
+                    estimated_coins[actor] += rules.tax_amount;
+                    taxes[actor]++;
+                }
+                break;
+            case ActionType::BRIBE:
+                estimated_coins[actor] -= rules.bribe_cost;
+                break;
+            case ActionType::ARREST:
+                if (!record.was_blocked && target >= 0) {
+                    estimated_coins[actor] += rules.arrest_amount;
+                    estimated_coins[target] -= rules.arrest_amount;
+                }
+                break;
+            case ActionType::SANCTION:
+                estimated_coins[actor] -= rules.sanction_cost;
+                break;
+            case ActionType::COUP:
+                estimated_coins[actor] -= rules.coup_cost;
+                if (record.was_blocked && target >= 0) {
+                    estimated_coins[target] -= rules.general_block_cost;
+                }
+                break;
+        }
+    }
+}
+
+GameState Determinizer::sample(std::mt19937_64& rng) const {
+    GameState state = observed;
+    for (size_t seat = 0; seat < candidates.size(); ++seat) {
+        PlayerState& player = state.players[seat];
+        if (!candidates[seat].empty()) {
+            player.role = static_cast<int8_t>(candidates[seat][rng() % candidates[seat].size()]);
+        }
+        if (coins_hidden[seat]) {
+            int coins = estimated_coins[seat];
+            if (player.role == static_cast<int8_t>(RoleType::GOVERNOR)) {
+                coins += taxes[seat] * governor_tax_bonus;
+            }
+            player.coins = std::max(0, coins);
+        }
+    }
+    return state;
+}
+
+IsmctsBot::IsmctsBot(const IsmctsOptions& bot_options) : options(bot_options), searches(0) {
+}
+
+Move IsmctsBot::choose_move(const Game& game, IsmctsReport* report) {
+    std::vector<Move> moves = legal_moves(game);
+    if (moves.empty()) {
+        throw std::runtime_error("No legal moves to choose from");
+    }
+
+    size_t thread_count = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    thread_count = std::max<size_t>(thread_count, 1);
+    Determinizer determinizer(game, game.get_current_player_index());
+    uint64_t search_seed = options.seed + 0x9e3779b97f4a7c15ULL * ++searches;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::map<int, uint64_t>> visits(thread_count);
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&, t]() {
+            try {
+                SearchTree tree(determinizer, options, game.get_rules(), game.get_player_count(), search_seed + t);
+                for (int i = 0; i < options.iterations; ++i) {
+                    tree.iterate();
+                }
+                tree.add_root_visits(visits[t]);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::map<int, uint64_t> total;
+    for (const auto& thread_visits : visits) {
+        for (const auto& entry : thread_visits) {
+            total[entry.first] += entry.second;
+        }
+    }
+    // Most visited move; moves legal in the real position only, ties broken by move order
+    Move best = moves[0];
+    uint64_t best_visits = 0;
+    for (const Move& move : moves) {
+        auto found = total.find(move_key(move));
+        if (found != total.end() && found->second > best_visits) {
+            best = move;
+            best_visits = found->second;
+        }
+    }
+
+    if (report) {
+        report->move = best;
+        report->iterations = static_cast<uint64_t>(options.iterations) * thread_count;
+        report->seconds = seconds;
+        report->iterations_per_second = seconds > 0 ? report->iterations / seconds : 0;
+        report->root_visits.clear();
+        for (const auto& entry : total) {
+            report->root_visits.push_back(std::make_pair(key_move(entry.first), entry.second));
+        }
+    }
+    return best;
+}
@@ -0,0 +1,205 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Journal.hpp"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t FRAME_OVERHEAD = 9;         // Size, type and checksum
+const uint32_t MAX_RECORD = 1 << 24;
+
+// FNV-1a over the type byte and the payload
+uint32_t record_checksum(uint8_t type, const uint8_t* payload, size_t size) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ type) * 16777619u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ payload[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t get_u32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+void write_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            throw std::runtime_error("Failed writing journal");
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+} // namespace
+
+void Journal::frame(uint8_t type, const uint8_t* payload, size_t size, std::vector<uint8_t>& out) {
+    if (size > MAX_RECORD) {
+        throw std::invalid_argument("Journal record too large");
+    }
+    put_u32(out, static_cast<uint32_t>(size));
+    out.push_back(type);
+    out.insert(out.end(), payload, payload + size);
+    put_u32(out, record_checksum(type, payload, size));
+}
+
+Journal::Journal(const std::string& file_path, const JournalOptions& journal_options,
+                 std::function<void()> run_before_commits)
+    : fd(::open(file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)), path(file_path), options(journal_options),
+      appended_records(0), durable_records(0), sync_count(0), stopping(false), failed(false),
+      started(!run_before_commits), before_commits(std::move(run_before_commits)) {
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open journal " + file_path);
+    }
+    pending.reserve(options.commit_batch_bytes * 2);
+    committer = std::thread(&Journal::commit_loop, this);
+}
+
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake_committer.notify_one();
+    committer.join();
+    ::close(fd);
+}
+
+void Journal::append(uint8_t type, const uint8_t* payload, size_t size) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failed) {
+            throw std::runtime_error("Journal " + path + " stopped after a write error");
+        }
+        frame(type, payload, size, pending);
+        appended_records++;
+        wake = pending.size() >= options.commit_batch_bytes;
+    }
+    if (wake) {
+        wake_committer.notify_one();
+    }
+}
+
+void Journal::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = appended_records;
+    wake_committer.notify_one();
+    committed_signal.wait(lock, [this, target]() { return (started && durable_records >= target) || failed; });
+    if (failed) {
+        throw std::runtime_error("Journal " + path + " stopped after a write error");
+    }
+}
+
+uint64_t Journal::get_sync_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sync_count;
+}
+
+void Journal::commit_loop() {
+    bool ready = true;
+    if (before_commits) {
+        try {
+            before_commits();
+        } catch (const std::exception&) {
+            ready = false;
+        }
+        before_commits = nullptr;        // Drops whatever the task held on to
+    }
+
+    std::vector<uint8_t> batch;
+    batch.reserve(options.commit_batch_bytes * 2);
+    std::unique_lock<std::mutex> lock(mutex);
+    started = true;
+    if (!ready) {
+        failed = true;
+        committed_signal.notify_all();
+        return;
+    }
+    while (true) {
+        wake_committer.wait_for(lock, std::chrono::microseconds(options.commit_interval_us));
+        if (pending.empty()) {
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+
+        // Take the whole batch and write it without holding the lock, so appends never wait
+        // for the disk
+        batch.swap(pending);
+        uint64_t batch_records = appended_records;
+        lock.unlock();
+        bool ok = true;
+        try {
+            write_all(fd, batch.data(), batch.size());
+            ok = ::fdatasync(fd) == 0;
+        } catch (const std::runtime_error&) {
+            ok = false;
+        }
+        batch.clear();
+        lock.lock();
+
+        if (!ok) {
+            failed = true;
+            committed_signal.notify_all();
+            return;
+        }
+        durable_records = batch_records;
+        sync_count++;
+        committed_signal.notify_all();
+    }
+}
+
+uint64_t Journal::read(const std::string& file_path,
+                       const std::function<void(uint8_t type, const uint8_t* payload, size_t size)>& on_record,
+                       uint64_t* intact_bytes) {
+    if (intact_bytes) {
+        *intact_bytes = 0;
+    }
+    int file = ::open(file_path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return 0;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[1 << 16];
+    ssize_t got;
+    while ((got = ::read(file, chunk, sizeof(chunk))) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    ::close(file);
+
+    uint64_t records = 0;
+    size_t position = 0;
+    while (data.size() - position >= FRAME_OVERHEAD) {
+        uint32_t size = get_u32(&data[position]);
+        if (size > MAX_RECORD || data.size() - position - FRAME_OVERHEAD < size) {
+            break;
+        }
+        uint8_t type = data[position + 4];
+        const uint8_t* payload = &data[position + 5];
+        if (get_u32(payload + size) != record_checksum(type, payload, size)) {
+            break;
+        }
+        on_record(type, payload, size);
+        records++;
+        position += FRAME_OVERHEAD + size;
+    }
+    if (intact_bytes) {
+        *intact_bytes = position;
+    }
+    return records;
+}
@@ -3,14 +3,19 @@
 #include "../include/Player.hpp"
 #include "../include/Game.hpp"
 #include "../include/Role.hpp"
+#include <algorithm>
 #include <stdexcept>
 
-Player::Player(const std::string& player_name) 
-    : name(player_name), coins(2), is_active(true), is_sanctioned(false), last_arrested_target(nullptr) {
+Player::Player(const std::string& player_name, int starting_coins) 
+    : name(player_name), coins(starting_coins), is_active(true), is_sanctioned(false), last_arrested_target(nullptr),
+      game(nullptr) {
 }
 
 void Player::set_role(std::shared_ptr<Role> new_role) {
     role = new_role;
+    if (game) {
+        game->role_changed(this);
+    }
 }
 
 void Player::add_coins(int amount) {
@@ -30,6 +35,13 @@ void Player::remove_coins(int amount) {
     coins -= amount;
 }
 
+void Player::set_coins(int amount) {
+    if (amount < 0) {
+        throw std::invalid_argument("Cannot set negative coins");
+    }
+    coins = amount;
+}
+
 // Gather action - take 1 coin from treasury
 void Player::gather(Game& game) {
     // Check if player can perform action
@@ -41,7 +53,7 @@ void Player::gather(Game& game) {
     }
     
     // Take 1 coin
-    add_coins(1);
+    add_coins(game.get_rules().gather_amount);
     game.add_action_to_history(ActionType::GATHER, this, nullptr);
 }
 
@@ -56,11 +68,13 @@ void Player::tax(Game& game) {
     }
     
     // Governor gets 3 coins, others get 2
-    int coins_to_add = 2;
+    const GameRules& rules = game.get_rules();
+    int coins_to_add = rules.tax_amount;
     if (role && role->get_type() == RoleType::GOVERNOR) {
-        coins_to_add = 3;
+        coins_to_add = rules.governor_tax_amount;
     }
     
+    game.save_undo_point();
     add_coins(coins_to_add);
     game.add_action_to_history(ActionType::TAX, this, nullptr);
 }
@@ -69,13 +83,14 @@ void Player::bribe(Game& game) {
     if (!is_active) {
         throw std::runtime_error("Player is not active");
     }
-    if (coins < 4) {
+    if (coins < game.get_rules().bribe_cost) {
         throw std::runtime_error("Not enough coins for bribe");
     }
     
-    remove_coins(4);
-    game.add_action_to_history(ActionType::BRIBE, this, nullptr);
+    remove_coins(game.get_rules().bribe_cost);
+    // Before the record, so the checksum it refreshes includes the extra turn
     game.allow_extra_turn();
+    game.add_action_to_history(ActionType::BRIBE, this, nullptr);
 }
 
 // Arrest action - take 1 coin from target player
@@ -92,33 +107,36 @@ void Player::arrest(Player& target, Game& game) {
     }
     
     // Handle coin transfer based on target's role
+    bool target_led = game.is_richest_opponent(this, &target);
+    game.save_undo_point();
+    const GameRules& rules = game.get_rules();
     if (target.get_coins() > 0) {
         if (target.role && target.role->get_type() == RoleType::MERCHANT) {
             // Merchant pays 2 coins to treasury instead of 1 to attacker
-            if (target.get_coins() >= 2) {
-                target.remove_coins(2);
-                game.add_coins_to_treasury(2);
+            if (target.get_coins() >= rules.merchant_arrest_penalty) {
+                target.remove_coins(rules.merchant_arrest_penalty);
+                game.add_coins_to_treasury(rules.merchant_arrest_penalty);
             } else {
-                // If merchant has only 1 coin, pay it to treasury
+                // If merchant has fewer coins, pay what is left to treasury
                 int available = target.get_coins();
                 target.remove_coins(available);
                 game.add_coins_to_treasury(available);
             }
-        } else if (target.role && target.role->get_type() == RoleType::GENERAL) {
-            // General gets the coin back immediately
-            target.remove_coins(1);
-            add_coins(1);
-            target.add_coins(1);
         } else {
-            // Normal arrest - take 1 coin from target
-            target.remove_coins(1);
-            add_coins(1);
+            // Take up to 1 coin from target
+            int taken = std::min(rules.arrest_amount, target.get_coins());
+            target.remove_coins(taken);
+            add_coins(taken);
+            if (target.role && target.role->get_type() == RoleType::GENERAL) {
+                // General gets the coin back immediately
+                target.add_coins(taken);
+            }
         }
     }
     
     // Remember last arrested target
     last_arrested_target = &target;
-    game.add_action_to_history(ActionType::ARREST, this, &target);
+    game.add_action_to_history(ActionType::ARREST, this, &target, target_led);
 }
 
 void Player::sanction(Player& target, Game& game) {
@@ -128,25 +146,27 @@ void Player::sanction(Player& target, Game& game) {
     if (!target.is_active) {
         throw std::runtime_error("Target player is not active");
     }
-    if (coins < 3) {
+    const GameRules& rules = game.get_rules();
+    if (coins < rules.sanction_cost) {
         throw std::runtime_error("Not enough coins for sanction");
     }
     
-    remove_coins(3);
+    bool target_led = game.is_richest_opponent(this, &target);
+    remove_coins(rules.sanction_cost);
     target.set_sanctioned(true);
     
     if (target.role && target.role->get_type() == RoleType::BARON) {
-        target.add_coins(1);
+        target.add_coins(rules.baron_sanction_compensation);
     }
     
     if (target.role && target.role->get_type() == RoleType::JUDGE) {
-        if (coins > 0) {
-            remove_coins(1);
-            game.add_coins_to_treasury(1);
-        }
+        // Judge penalty is paid from whatever the sanctioning player has left
+        int penalty = std::min(rules.judge_sanction_penalty, coins);
+        remove_coins(penalty);
+        game.add_coins_to_treasury(penalty);
     }
     
-    game.add_action_to_history(ActionType::SANCTION, this, &target);
+    game.add_action_to_history(ActionType::SANCTION, this, &target, target_led);
 }
 
 void Player::coup(Player& target, Game& game) {
@@ -156,10 +176,11 @@ void Player::coup(Player& target, Game& game) {
     if (!target.is_active) {
         throw std::runtime_error("Target player is not active");
     }
-    if (coins < 7) {
+    if (coins < game.get_rules().coup_cost) {
         throw std::runtime_error("Not enough coins for coup");
     }
     
-    remove_coins(7);
-    game.add_action_to_history(ActionType::COUP, this, &target);
+    bool target_led = game.is_richest_opponent(this, &target);
+    remove_coins(game.get_rules().coup_cost);
+    game.add_action_to_history(ActionType::COUP, this, &target, target_led);
 }
\ No newline at end of file
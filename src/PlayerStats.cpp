@@ -0,0 +1,39 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/PlayerStats.hpp"
+
+const int PlayerStats::WINDOW;
+
+void PlayerStats::record(ActionType action, int target_seat, bool target_leads) {
+    int type = static_cast<int>(action);
+    // The oldest entry leaves the window once it is full
+    if (actions >= WINDOW) {
+        recent_counts[(recent >> (4 * (WINDOW - 1))) & 15]--;
+    }
+    recent = (recent << 4) | static_cast<uint64_t>(type);
+    recent_counts[type]++;
+    actions++;
+    counts[type]++;
+    if (target_seat >= 0) {
+        targeted++;
+        targets[target_seat]++;
+        leader_targeted += target_leads;
+    }
+}
+
+bool PlayerStats::is_valid() const {
+    uint8_t seen[ACTION_TYPE_COUNT] = {};
+    for (uint32_t i = 0; i < recent_actions(); ++i) {
+        unsigned type = (recent >> (4 * i)) & 15;
+        if (type >= ACTION_TYPE_COUNT) {
+            return false;
+        }
+        seen[type]++;
+    }
+    for (int type = 0; type < ACTION_TYPE_COUNT; ++type) {
+        if (seen[type] != recent_counts[type]) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/PlayerView.hpp"
+#include "../include/Player.hpp"
+#include <stdexcept>
+
+namespace {
+
+uint64_t mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 29);
+}
+
+} // namespace
+
+const int PlayerView::HIDDEN;
+
+PlayerView::PlayerView(const Game& observed_game, int observer_seat) : game(observed_game), observer(observer_seat) {
+    if (observer_seat < 0 || observer_seat >= static_cast<int>(game.get_player_count())) {
+        throw std::invalid_argument("Observer seat out of range");
+    }
+}
+
+std::string PlayerView::name(int seat) const {
+    return game.get_player_at(seat)->get_name();
+}
+
+bool PlayerView::is_active(int seat) const {
+    return game.get_player_at(seat)->is_player_active();
+}
+
+bool PlayerView::is_sanctioned(int seat) const {
+    return game.get_player_at(seat)->is_player_sanctioned();
+}
+
+bool PlayerView::is_role_visible(int seat) const {
+    return seat == observer || !game.are_roles_hidden() || !is_active(seat);
+}
+
+bool PlayerView::is_coins_visible(int seat) const {
+    return seat == observer || !game.are_coins_hidden() || game.are_coins_revealed(observer, seat);
+}
+
+int PlayerView::role(int seat) const {
+    if (!is_role_visible(seat)) {
+        return HIDDEN;
+    }
+    auto player_role = game.get_player_at(seat)->get_role();
+    return player_role ? static_cast<int>(player_role->get_type()) : -1;
+}
+
+int PlayerView::coins(int seat) const {
+    return is_coins_visible(seat) ? game.get_player_at(seat)->get_coins() : HIDDEN;
+}
+
+uint64_t PlayerView::information_set_key() const {
+    uint64_t hash = mix(game.get_public_history_hash(), static_cast<uint64_t>(observer));
+    hash = mix(hash, static_cast<uint64_t>(game.get_current_player_index()) |
+                     (static_cast<uint64_t>(game.is_extra_turn_allowed()) << 8) |
+                     (static_cast<uint64_t>(game.is_game_active()) << 9));
+    hash = mix(hash, static_cast<uint64_t>(game.get_treasury_coins()));
+    for (size_t seat = 0; seat < game.get_player_count(); ++seat) {
+        int s = static_cast<int>(seat);
+        // HIDDEN is negative, so it cannot collide with a real role or coin count
+        uint64_t packed = static_cast<uint32_t>(coins(s));
+        packed |= static_cast<uint64_t>(static_cast<uint8_t>(role(s))) << 32;
+        packed |= static_cast<uint64_t>(is_active(s)) << 40;
+        packed |= static_cast<uint64_t>(is_sanctioned(s)) << 41;
+        hash = mix(hash, packed);
+    }
+    return hash;
+}
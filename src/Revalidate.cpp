@@ -0,0 +1,128 @@
+// yaacovkrawiec@gmail.com
+
+// Replay archive re-validation.
+// Memory-maps an archive written by coup_archive, hands its blocks out to one worker per core
+// and re-executes every game through Game and Player with the archive's rules. A game diverges
+// when a recorded turn is no longer legal, when the state checksum after a turn differs from
+// the one recorded for it, or when it ends with a different winner, final coins, action counts
+// or sanction turns. Prints the first divergence in archive order and exits with status 1 if
+// any game diverged.
+//
+// Examples:
+//   ./coup_revalidate --in games.cga
+//   ./coup_revalidate --in games.cga --threads 4
+
+#include "../include/Archive.hpp"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: coup_revalidate --in FILE [--threads N]\n";
+}
+
+// First divergence in archive order: by block, then by game within the block
+struct FirstDivergence {
+    size_t block = SIZE_MAX;
+    size_t game = 0;
+    Divergence divergence{0, ""};
+
+    bool is_after(size_t other_block, size_t other_game) const {
+        return block > other_block || (block == other_block && game > other_game);
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string input;
+    size_t thread_count = 0;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--in") input = next();
+            else if (arg == "--threads") thread_count = std::stoul(next());
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (input.empty()) {
+            throw std::invalid_argument("Missing --in");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+
+    try {
+        ArchiveReader reader(input);
+        const GameRules& rules = reader.get_rules();
+
+        // Workers take whole blocks, so each decodes its own replays straight from the mapping
+        std::atomic<size_t> next_block{0};
+        std::atomic<uint64_t> diverged{0};
+        std::mutex first_mutex;
+        FirstDivergence first;
+        std::string failure;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < thread_count; ++t) {
+            workers.emplace_back([&]() {
+                std::vector<ArchivedGame> games;
+                Divergence divergence;
+                try {
+                    for (size_t block = next_block++; block < reader.block_count(); block = next_block++) {
+                        reader.read_block(block, games);
+                        for (size_t g = 0; g < games.size(); ++g) {
+                            if (revalidate_game(rules, games[g], divergence)) continue;
+                            diverged++;
+                            std::lock_guard<std::mutex> lock(first_mutex);
+                            if (first.is_after(block, g)) {
+                                first = FirstDivergence{block, g, divergence};
+                            }
+                        }
+                    }
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(first_mutex);
+                    failure = e.what();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!failure.empty()) {
+            throw std::runtime_error(failure);
+        }
+
+        std::cout << "games:       " << reader.game_count() << " in " << reader.block_count() << " blocks\n"
+                  << "diverged:    " << diverged << "\n"
+                  << "replay rate: " << std::fixed << std::setprecision(0)
+                  << (seconds > 0 ? reader.game_count() / seconds : 0) << " games/second on " << thread_count
+                  << " threads\n";
+        if (diverged > 0) {
+            std::cout << "first divergence: block " << first.block << ", game " << first.game << ", turn "
+                      << first.divergence.turn << ": " << first.divergence.reason << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
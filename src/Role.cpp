@@ -3,6 +3,19 @@
 #include "../include/Role.hpp"
 #include "../include/Player.hpp"
 #include "../include/Game.hpp"
+#include <stdexcept>
+
+std::shared_ptr<Role> make_role(RoleType type) {
+    switch (type) {
+        case RoleType::GOVERNOR: return std::make_shared<Governor>();
+        case RoleType::SPY: return std::make_shared<Spy>();
+        case RoleType::BARON: return std::make_shared<Baron>();
+        case RoleType::GENERAL: return std::make_shared<General>();
+        case RoleType::JUDGE: return std::make_shared<Judge>();
+        case RoleType::MERCHANT: return std::make_shared<Merchant>();
+    }
+    throw std::invalid_argument("Unknown role type");
+}
 
 void Governor::special_ability(Player& /*player*/, Game& /*game*/) {
     // Tax ability is handled in Player::tax()
@@ -20,18 +33,31 @@ int Spy::see_coins(Player& target) {
     return target.get_coins();
 }
 
-void Spy::block_arrest(Player& /*target*/) {
-    // Implementation depends on game state management
+int Spy::see_coins(Player& spy, Player& target, Game& game) {
+    game.reveal_coins(&spy, &target);
+    return see_coins(target);
+}
+
+void Spy::block_arrest(Player& spy, Game& game) {
+    const ActionHistory& history = game.get_action_history();
+    if (history.empty() || history.packed_back().action() != ActionType::ARREST) {
+        throw std::runtime_error("Spy can only block an arrest");
+    }
+    game.resolve_block(&spy);
+}
+
+bool Spy::can_block_action(ActionType action, Player* /*actor*/, Player* /*target*/) {
+    return action == ActionType::ARREST;
 }
 
-void Baron::special_ability(Player& player, Game& /*game*/) {
-    invest(player);
+void Baron::special_ability(Player& player, Game& game) {
+    game.invest(&player);
 }
 
-void Baron::invest(Player& player) {
-    if (player.get_coins() >= 3) {
-        player.remove_coins(3);
-        player.add_coins(6);
+void Baron::invest(Player& player, const GameRules& rules) {
+    if (player.get_coins() >= rules.baron_invest_cost) {
+        player.remove_coins(rules.baron_invest_cost);
+        player.add_coins(rules.baron_invest_return);
     }
 }
 
@@ -39,14 +65,19 @@ void General::special_ability(Player& /*player*/, Game& /*game*/) {
     // Block coup ability is handled separately
 }
 
-bool General::block_coup(Player& defender, Player& /*attacker*/, Game& /*game*/) {
-    if (defender.get_coins() >= 5) {
-        defender.remove_coins(5);
+bool General::block_coup(Player& defender, Player& /*attacker*/, Game& game) {
+    int cost = game.get_rules().general_block_cost;
+    if (defender.get_coins() >= cost) {
+        defender.remove_coins(cost);
         return true;
     }
     return false;
 }
 
+bool General::can_block_action(ActionType action, Player* /*actor*/, Player* /*target*/) {
+    return action == ActionType::COUP;
+}
+
 void Judge::special_ability(Player& /*player*/, Game& /*game*/) {
     // Blocking bribe is handled in can_block_action
 }
@@ -55,12 +86,12 @@ bool Judge::can_block_action(ActionType action, Player* /*actor*/, Player* /*tar
     return action == ActionType::BRIBE;
 }
 
-void Merchant::special_ability(Player& player, Game& /*game*/) {
-    start_turn_bonus(player);
+void Merchant::special_ability(Player& player, Game& game) {
+    start_turn_bonus(player, game.get_rules());
 }
 
-void Merchant::start_turn_bonus(Player& player) {
-    if (player.get_coins() >= 3) {
-        player.add_coins(1);
+void Merchant::start_turn_bonus(Player& player, const GameRules& rules) {
+    if (player.get_coins() >= rules.merchant_bonus_threshold) {
+        player.add_coins(rules.merchant_bonus);
     }
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/RuleComparison.hpp"
+#include <cmath>
+#include <random>
+#include <thread>
+
+const int RoleTally::ROLES;
+
+void RoleTally::add(const std::vector<RoleType>& roles, const SimulationResult& result) {
+    games++;
+    for (RoleType role : roles) {
+        appearances[static_cast<int>(role)]++;
+    }
+    if (result.winner < 0) {
+        draws++;
+    } else {
+        wins[static_cast<int>(roles[result.winner])]++;
+    }
+}
+
+void RoleTally::merge(const RoleTally& other) {
+    games += other.games;
+    draws += other.draws;
+    for (int r = 0; r < ROLES; ++r) {
+        appearances[r] += other.appearances[r];
+        wins[r] += other.wins[r];
+    }
+}
+
+const char* RoleTally::role_name(int role) {
+    static const char* const NAMES[ROLES] = {"Governor", "Spy", "Baron", "General", "Judge", "Merchant"};
+    return NAMES[role];
+}
+
+const char* verdict_name(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::A_BETTER: return "A";
+        case Verdict::B_BETTER: return "B";
+        case Verdict::EQUIVALENT: return "equal";
+        default: return "undecided";
+    }
+}
+
+RoleComparison::RoleComparison(long wins_a, long trials_a, long wins_b, long trials_b) {
+    double mean_a = (wins_a + 1.0) / (trials_a + 2.0);
+    double mean_b = (wins_b + 1.0) / (trials_b + 2.0);
+    double var_a = mean_a * (1.0 - mean_a) / (trials_a + 3.0);
+    double var_b = mean_b * (1.0 - mean_b) / (trials_b + 3.0);
+    rate_a = trials_a ? (double)wins_a / trials_a : 0.0;
+    rate_b = trials_b ? (double)wins_b / trials_b : 0.0;
+    diff = mean_b - mean_a;
+    diff_sd = std::sqrt(var_a + var_b);
+    prob_b_better = 0.5 * std::erfc(-diff / (diff_sd * std::sqrt(2.0)));
+}
+
+Verdict RoleComparison::verdict(double alpha, double margin) const {
+    if (prob_b_better >= 1.0 - alpha) return Verdict::B_BETTER;
+    if (prob_b_better <= alpha) return Verdict::A_BETTER;
+    if (std::fabs(diff) + 2.576 * diff_sd < margin) return Verdict::EQUIVALENT;
+    return Verdict::UNDECIDED;
+}
+
+bool comparison_settled(const RoleTally& a, const RoleTally& b, const ComparisonOptions& options) {
+    if (a.games < options.min_games) {
+        return false;
+    }
+    for (int r = 0; r < RoleTally::ROLES; ++r) {
+        if (options.role >= 0 && r != options.role) {
+            continue;
+        }
+        RoleComparison comparison(a.wins[r], a.appearances[r], b.wins[r], b.appearances[r]);
+        if (comparison.verdict(options.alpha, options.margin) == Verdict::UNDECIDED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ComparisonRunner::ComparisonRunner(const GameRules& a, const GameRules& b, const ComparisonOptions& opts)
+    : options(opts), rules_a(a), rules_b(b) {}
+
+// Plays both variants on the same roles and random stream so their difference has low variance
+void ComparisonRunner::run_pairs(long pairs, unsigned long seed, RoleTally& out_a, RoleTally& out_b) const {
+    std::mt19937_64 rng(seed);
+    std::vector<RoleType> roles(options.players);
+    for (long g = 0; g < pairs; ++g) {
+        for (auto& role : roles) {
+            role = static_cast<RoleType>(rng() % RoleTally::ROLES);
+        }
+        unsigned long game_seed = rng();
+        std::mt19937_64 rng_a(game_seed);
+        out_a.add(roles, simulate_game(rules_a, roles, rng_a, options.max_turns));
+        std::mt19937_64 rng_b(game_seed);
+        out_b.add(roles, simulate_game(rules_b, roles, rng_b, options.max_turns));
+    }
+}
+
+void ComparisonRunner::run() {
+    size_t thread_count = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+
+    // Each round plays one batch of pairs per thread, then the stopping rule is checked
+    unsigned long round = 0;
+    while (tally_a.games < options.max_games && !settled()) {
+        std::vector<RoleTally> results_a(thread_count), results_b(thread_count);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < thread_count; ++t) {
+            unsigned long seed = options.seed * 1000003UL + round * thread_count + t;
+            workers.emplace_back([&, t, seed]() {
+                run_pairs(options.batch, seed, results_a[t], results_b[t]);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (size_t t = 0; t < thread_count; ++t) {
+            tally_a.merge(results_a[t]);
+            tally_b.merge(results_b[t]);
+        }
+        round++;
+    }
+}
+
+RoleComparison ComparisonRunner::compare(int role) const {
+    return RoleComparison(tally_a.wins[role], tally_a.appearances[role], tally_b.wins[role],
+                          tally_b.appearances[role]);
+}
+
+void ComparisonRunner::write_table(std::ostream& out) const {
+    out << "role\tgames\trate_a\trate_b\tdiff\tp_b_better\tverdict\n";
+    for (int r = 0; r < RoleTally::ROLES; ++r) {
+        if (options.role >= 0 && r != options.role) {
+            continue;
+        }
+        RoleComparison comparison = compare(r);
+        out << RoleTally::role_name(r) << "\t" << tally_a.games << "\t" << comparison.rate_a << "\t"
+            << comparison.rate_b << "\t" << comparison.diff << "\t" << comparison.prob_b_better << "\t"
+            << verdict_name(comparison.verdict(options.alpha, options.margin)) << "\n";
+    }
+}
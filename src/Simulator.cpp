@@ -0,0 +1,177 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Simulator.hpp"
+#include "../include/Player.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+int seat_of(const Game& game, const Player* player) {
+    for (size_t i = 0; i < game.get_player_count(); ++i) {
+        if (game.get_player_at(i) == player) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+std::vector<Move> legal_moves(const Game& game) {
+    std::vector<Move> moves;
+    if (!game.is_game_active()) {
+        return moves;
+    }
+
+    const GameRules& rules = game.get_rules();
+    int seat = game.get_current_player_index();
+    Player* current = game.get_player_at(seat);
+    int coins = current->get_coins();
+
+    // Coup targets are needed both for forced and regular turns
+    if (coins >= rules.coup_cost) {
+        for (size_t i = 0; i < game.get_player_count(); ++i) {
+            if ((int)i != seat && game.get_player_at(i)->is_player_active()) {
+                moves.push_back(Move(MoveType::COUP, i));
+            }
+        }
+        if (coins >= rules.forced_coup_threshold) {
+            return moves;
+        }
+    }
+
+    if (!current->is_player_sanctioned()) {
+        moves.push_back(Move(MoveType::GATHER));
+        moves.push_back(Move(MoveType::TAX));
+    }
+    if (coins >= rules.bribe_cost) {
+        moves.push_back(Move(MoveType::BRIBE));
+    }
+    for (size_t i = 0; i < game.get_player_count(); ++i) {
+        Player* other = game.get_player_at(i);
+        if ((int)i == seat || !other->is_player_active()) {
+            continue;
+        }
+        if (current->get_last_arrested() != other) {
+            moves.push_back(Move(MoveType::ARREST, i));
+        }
+        if (coins >= rules.sanction_cost) {
+            moves.push_back(Move(MoveType::SANCTION, i));
+        }
+    }
+    if (current->get_role() && current->get_role()->get_type() == RoleType::BARON &&
+        coins >= rules.baron_invest_cost) {
+        moves.push_back(Move(MoveType::INVEST));
+    }
+    return moves;
+}
+
+bool is_legal_move(const Game& game, const Move& move) {
+    std::vector<Move> moves = legal_moves(game);
+    return std::find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+Move default_move(const Game& game) {
+    std::vector<Move> moves = legal_moves(game);
+    if (moves.empty()) {
+        throw std::runtime_error("No legal move to play");
+    }
+    if (std::find(moves.begin(), moves.end(), Move(MoveType::GATHER)) != moves.end()) {
+        return Move(MoveType::GATHER);
+    }
+    return moves[0];
+}
+
+bool block_coups_only(Player& /*blocker*/, const ActionRecord& action) {
+    return action.action == ActionType::COUP;
+}
+
+bool opens_reaction_window(MoveType type) {
+    return type == MoveType::TAX || type == MoveType::BRIBE || type == MoveType::ARREST || type == MoveType::COUP;
+}
+
+std::vector<Player*> reaction_blockers(const Game& game, const Move& move) {
+    if (!opens_reaction_window(move.type) || game.eligible_blocker_mask() == 0) {
+        return {};
+    }
+    return game.eligible_blockers();
+}
+
+void play_action(Game& game, const Move& move) {
+    Player& current = *game.get_player_at(game.get_current_player_index());
+    Player* target = move.target >= 0 ? game.get_player_at(move.target) : nullptr;
+    if ((move.type == MoveType::ARREST || move.type == MoveType::SANCTION || move.type == MoveType::COUP) &&
+        !target) {
+        throw std::invalid_argument("Move requires a target");
+    }
+
+    switch (move.type) {
+        case MoveType::GATHER: current.gather(game); break;
+        case MoveType::TAX: current.tax(game); break;
+        case MoveType::BRIBE: current.bribe(game); break;
+        case MoveType::ARREST: current.arrest(*target, game); break;
+        case MoveType::SANCTION: current.sanction(*target, game); break;
+        case MoveType::COUP: current.coup(*target, game); break;
+        case MoveType::INVEST: game.invest(&current); break;
+    }
+}
+
+void complete_move(Game& game, const Move& move) {
+    if (move.type == MoveType::COUP && !game.get_action_history().back().was_blocked) {
+        game.eliminate_player(game.get_player_at(move.target));
+    }
+    if (game.is_game_active()) {
+        game.next_turn();
+    }
+}
+
+void apply_move(Game& game, const Move& move, const BlockDecision& decide) {
+    play_action(game, move);
+    if (opens_reaction_window(move.type)) {
+        game.run_reaction_window(decide);
+    }
+    complete_move(game, move);
+}
+
+void replay_turn(Game& game, const RecordedTurn& turn) {
+    if (turn.move < 0) {
+        game.next_turn();
+        return;
+    }
+    Move move(static_cast<MoveType>(turn.move), turn.target);
+    play_action(game, move);
+    if (turn.blocker >= 0) {
+        game.resolve_block(game.get_player_at(turn.blocker));
+    }
+    complete_move(game, move);
+}
+
+SimulationResult simulate_game(const GameRules& rules, const std::vector<RoleType>& roles,
+                               std::mt19937_64& rng, int max_turns) {
+    Game game(rules);
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("P" + std::to_string(i + 1), rules.starting_coins);
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.start_game();
+
+    SimulationResult result{-1, 0};
+    while (game.is_game_active() && result.turns < max_turns) {
+        std::vector<Move> moves = legal_moves(game);
+        if (moves.empty()) {
+            // Nothing is legal (e.g. sanctioned and broke) - the turn is skipped
+            game.next_turn();
+        } else {
+            apply_move(game, moves[rng() % moves.size()]);
+        }
+        result.turns++;
+    }
+
+    if (!game.is_game_active()) {
+        for (size_t i = 0; i < game.get_player_count(); ++i) {
+            if (game.get_player_at(i)->is_player_active()) {
+                result.winner = static_cast<int>(i);
+            }
+        }
+    }
+    return result;
+}
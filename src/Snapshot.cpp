@@ -0,0 +1,54 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Snapshot.hpp"
+#include <cstring>
+#include <thread>
+
+SnapshotPublisher::SnapshotPublisher(const GameState& initial) : sequence(0) {
+    uint64_t buffer[WORDS] = {};
+    std::memcpy(buffer, &initial, sizeof(GameState));
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+}
+
+void SnapshotPublisher::publish(const GameState& state) {
+    uint64_t buffer[WORDS] = {};
+    std::memcpy(buffer, &state, sizeof(GameState));
+
+    uint64_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool SnapshotPublisher::try_read(GameState& state) const {
+    uint64_t before = sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return false;
+    }
+    uint64_t buffer[WORDS];
+    for (size_t i = 0; i < WORDS; ++i) {
+        buffer[i] = words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != before) {
+        return false;
+    }
+    std::memcpy(&state, buffer, sizeof(GameState));
+    return true;
+}
+
+GameState SnapshotPublisher::read() const {
+    GameState state;
+    for (int attempt = 0; !try_read(state); ++attempt) {
+        // The writer holds the sequence odd only for a few stores; yield if it was preempted
+        if (attempt >= 64) {
+            std::this_thread::yield();
+        }
+    }
+    return state;
+}
@@ -0,0 +1,264 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Spectator.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Table mask bits
+const uint8_t TABLE_TURN = 1;
+const uint8_t TABLE_TREASURY = 2;
+const uint8_t TABLE_FLAGS = 4;
+
+// Player field mask bits
+const uint8_t FIELD_COINS = 1;
+const uint8_t FIELD_FLAGS = 2;
+const uint8_t FIELD_ROLE = 4;
+const uint8_t FIELD_ARREST = 8;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void put_signed(std::vector<uint8_t>& out, int64_t value) {
+    put_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void put_checksum(std::vector<uint8_t>& out, uint32_t checksum) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(checksum >> shift));
+    }
+}
+
+class FrameReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+
+public:
+    FrameReader(const uint8_t* frame, size_t frame_size) : data(frame), size(frame_size), position(0) {}
+
+    uint8_t byte() {
+        if (position == size) {
+            throw std::runtime_error("Truncated state frame");
+        }
+        return data[position++];
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Bad varint in state frame");
+    }
+
+    int64_t signed_varint() {
+        uint64_t value = varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    uint32_t checksum() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            value |= static_cast<uint32_t>(byte()) << shift;
+        }
+        return value;
+    }
+
+    bool at_end() const { return position == size; }
+};
+
+uint8_t table_flags(const GameState& state) {
+    return state.game_active | (state.extra_turn << 1);
+}
+
+uint8_t player_flags(const PlayerState& player) {
+    return player.active | (player.sanctioned << 1);
+}
+
+bool same_state(const GameState& a, const GameState& b) {
+    if (a.player_count != b.player_count || a.current_player != b.current_player || a.treasury != b.treasury ||
+        table_flags(a) != table_flags(b)) {
+        return false;
+    }
+    for (int seat = 0; seat < a.player_count; ++seat) {
+        const PlayerState& x = a.players[seat];
+        const PlayerState& y = b.players[seat];
+        if (x.coins != y.coins || player_flags(x) != player_flags(y) || x.role != y.role ||
+            x.last_arrested != y.last_arrested) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void encode_state_frame(const GameState* before, const GameState& after, uint64_t sequence,
+                        std::vector<uint8_t>& out) {
+    bool key = before == nullptr;
+    GameState zero{};
+    const GameState& from = key ? zero : *before;
+    if (!key && before->player_count != after.player_count) {
+        throw std::invalid_argument("Delta frames need the same number of players");
+    }
+
+    out.push_back(static_cast<uint8_t>(key ? FrameType::KEYFRAME : FrameType::DELTA));
+    put_varint(out, sequence);
+
+    uint8_t table = 0;
+    if (key || from.current_player != after.current_player) table |= TABLE_TURN;
+    if (key || from.treasury != after.treasury) table |= TABLE_TREASURY;
+    if (key || table_flags(from) != table_flags(after)) table |= TABLE_FLAGS;
+    out.push_back(table);
+    if (key) out.push_back(after.player_count);
+    if (table & TABLE_TURN) out.push_back(after.current_player);
+    if (table & TABLE_TREASURY) put_signed(out, static_cast<int64_t>(after.treasury) - from.treasury);
+    if (table & TABLE_FLAGS) out.push_back(table_flags(after));
+
+    // Reserve the player mask byte and fill it in once the changed players are known
+    size_t mask_at = out.size();
+    out.push_back(0);
+    uint8_t changed_players = 0;
+    for (int seat = 0; seat < after.player_count; ++seat) {
+        const PlayerState& old_player = from.players[seat];
+        const PlayerState& player = after.players[seat];
+        uint8_t fields = 0;
+        if (key || old_player.coins != player.coins) fields |= FIELD_COINS;
+        if (key || player_flags(old_player) != player_flags(player)) fields |= FIELD_FLAGS;
+        if (key || old_player.role != player.role) fields |= FIELD_ROLE;
+        if (key || old_player.last_arrested != player.last_arrested) fields |= FIELD_ARREST;
+        if (!fields) {
+            continue;
+        }
+        changed_players |= 1 << seat;
+        out.push_back(fields);
+        if (fields & FIELD_COINS) put_signed(out, static_cast<int64_t>(player.coins) - old_player.coins);
+        if (fields & FIELD_FLAGS) out.push_back(player_flags(player));
+        if (fields & FIELD_ROLE) out.push_back(static_cast<uint8_t>(player.role));
+        if (fields & FIELD_ARREST) out.push_back(static_cast<uint8_t>(player.last_arrested));
+    }
+    out[mask_at] = changed_players;
+    put_checksum(out, static_cast<uint32_t>(state_checksum(after)));
+}
+
+uint64_t apply_state_frame(GameState& state, const uint8_t* data, size_t size) {
+    FrameReader in(data, size);
+    uint8_t type = in.byte();
+    if (type > static_cast<uint8_t>(FrameType::DELTA)) {
+        throw std::runtime_error("Unknown state frame type");
+    }
+    uint64_t sequence = in.varint();
+
+    // Decode into a copy so a malformed frame leaves the state untouched
+    GameState next = state;
+    if (type == static_cast<uint8_t>(FrameType::KEYFRAME)) {
+        next = GameState{};
+    }
+    uint8_t table = in.byte();
+    if (type == static_cast<uint8_t>(FrameType::KEYFRAME)) {
+        next.player_count = in.byte();
+        if (next.player_count > MAX_PLAYERS) {
+            throw std::runtime_error("Too many players in state frame");
+        }
+    }
+    if (table & TABLE_TURN) next.current_player = in.byte();
+    if (table & TABLE_TREASURY) next.treasury = static_cast<int32_t>(next.treasury + in.signed_varint());
+    if (table & TABLE_FLAGS) {
+        uint8_t flags = in.byte();
+        next.game_active = flags & 1;
+        next.extra_turn = (flags >> 1) & 1;
+    }
+
+    uint8_t changed_players = in.byte();
+    if (changed_players >> next.player_count) {
+        throw std::runtime_error("State frame changes a missing player");
+    }
+    for (int seat = 0; seat < next.player_count; ++seat) {
+        if (!(changed_players & (1 << seat))) {
+            continue;
+        }
+        PlayerState& player = next.players[seat];
+        uint8_t fields = in.byte();
+        if (fields & FIELD_COINS) player.coins = static_cast<int32_t>(player.coins + in.signed_varint());
+        if (fields & FIELD_FLAGS) {
+            uint8_t flags = in.byte();
+            player.active = flags & 1;
+            player.sanctioned = (flags >> 1) & 1;
+        }
+        if (fields & FIELD_ROLE) player.role = static_cast<int8_t>(in.byte());
+        if (fields & FIELD_ARREST) player.last_arrested = static_cast<int8_t>(in.byte());
+    }
+    uint32_t checksum = in.checksum();
+    if (!in.at_end()) {
+        throw std::runtime_error("Trailing bytes in state frame");
+    }
+    // A delta applied to the wrong base state decodes cleanly but lands on another state
+    if (checksum != static_cast<uint32_t>(state_checksum(next))) {
+        throw std::runtime_error("State frame checksum mismatch");
+    }
+    state = next;
+    return sequence;
+}
+
+SpectatorFeed::SpectatorFeed(const Game& watched)
+    : game(watched), last(watched.capture_state()), sequence(0), next_id(1), frames_encoded(0), bytes_encoded(0) {
+}
+
+uint64_t SpectatorFeed::subscribe(const Sender& send) {
+    if (!send) {
+        throw std::invalid_argument("Spectator needs a sender");
+    }
+    // Joiners between two publishes share one keyframe
+    if (!keyframe) {
+        auto frame = std::make_shared<std::vector<uint8_t>>();
+        encode_state_frame(nullptr, last, sequence, *frame);
+        frames_encoded++;
+        bytes_encoded += frame->size();
+        keyframe = frame;
+    }
+    subscribers.push_back(Subscriber{next_id, send});
+    send(keyframe);
+    return next_id++;
+}
+
+bool SpectatorFeed::unsubscribe(uint64_t id) {
+    auto found = std::find_if(subscribers.begin(), subscribers.end(),
+                              [id](const Subscriber& subscriber) { return subscriber.id == id; });
+    if (found == subscribers.end()) {
+        return false;
+    }
+    subscribers.erase(found);
+    return true;
+}
+
+bool SpectatorFeed::publish() {
+    GameState now = game.capture_state();
+    if (same_state(now, last)) {
+        return false;
+    }
+
+    auto frame = std::make_shared<std::vector<uint8_t>>();
+    encode_state_frame(&last, now, ++sequence, *frame);
+    last = now;
+    keyframe.reset();
+    frames_encoded++;
+    bytes_encoded += frame->size();
+
+    StateFrame shared = frame;
+    for (const Subscriber& subscriber : subscribers) {
+        subscriber.send(shared);
+    }
+    return true;
+}
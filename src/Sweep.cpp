@@ -0,0 +1,417 @@
+// yaacovkrawiec@gmail.com
+
+// Rule-balance parameter sweep.
+// Runs Monte Carlo batches of random games for every point of a grid of rule values
+// and writes role win rates with 95% confidence intervals as a tab separated table.
+//
+// With --a/--b it instead compares two rule variants: games are played in paired batches
+// (same seats, roles and random stream for both variants) and the run stops as soon as
+// a Bayesian stopping rule has settled the win-rate difference of every role.
+//
+// Examples:
+//   ./coup_sweep --set coup_cost=5,7,9 --set baron_invest_return=5,6 --players 4 --ci 0.01
+//   ./coup_sweep --a coup_cost=7 --b coup_cost=6 --role Baron
+
+#include "../include/RuleComparison.hpp"
+#include "../include/Rules.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int ROLE_COUNT = RoleTally::ROLES;
+
+// Rule fields that can be swept, by name
+const std::map<std::string, int GameRules::*> RULE_FIELDS = {
+    {"starting_coins", &GameRules::starting_coins},
+    {"gather_amount", &GameRules::gather_amount},
+    {"tax_amount", &GameRules::tax_amount},
+    {"governor_tax_amount", &GameRules::governor_tax_amount},
+    {"bribe_cost", &GameRules::bribe_cost},
+    {"arrest_amount", &GameRules::arrest_amount},
+    {"sanction_cost", &GameRules::sanction_cost},
+    {"coup_cost", &GameRules::coup_cost},
+    {"forced_coup_threshold", &GameRules::forced_coup_threshold},
+    {"baron_invest_cost", &GameRules::baron_invest_cost},
+    {"baron_invest_return", &GameRules::baron_invest_return},
+    {"baron_sanction_compensation", &GameRules::baron_sanction_compensation},
+    {"general_block_cost", &GameRules::general_block_cost},
+    {"judge_sanction_penalty", &GameRules::judge_sanction_penalty},
+    {"merchant_bonus_threshold", &GameRules::merchant_bonus_threshold},
+    {"merchant_bonus", &GameRules::merchant_bonus},
+    {"merchant_arrest_penalty", &GameRules::merchant_arrest_penalty},
+};
+
+struct SweepOptions {
+    std::vector<std::pair<std::string, std::vector<int>>> axes;
+    int players = 4;
+    int threads = 0;
+    int batch = 256;
+    long min_games = 2000;
+    long max_games = 1000000;
+    double ci_half_width = 0.01;
+    int max_turns = 1000;
+    unsigned long seed = 1;
+    std::string output;
+
+    // Variant comparison mode
+    std::vector<std::pair<std::string, int>> variant_a;
+    std::vector<std::pair<std::string, int>> variant_b;
+    int role = -1;                       // Only decide this role, -1 for all roles
+    double alpha = 0.01;                 // Posterior error allowed when declaring a winner
+    double margin = 0.01;                // Win-rate differences below this count as equal
+};
+
+// Wilson score interval for a binomial proportion at 95% confidence
+void wilson_interval(long successes, long trials, double& low, double& high) {
+    if (trials == 0) {
+        low = 0.0;
+        high = 1.0;
+        return;
+    }
+    const double z = 1.96;
+    double n = static_cast<double>(trials);
+    double p = successes / n;
+    double denom = 1.0 + z * z / n;
+    double center = (p + z * z / (2.0 * n)) / denom;
+    double half = z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denom;
+    low = center - half;
+    high = center + half;
+}
+
+struct GridPoint {
+    GameRules rules;
+    std::vector<int> values;             // One value per sweep axis
+    std::mutex mutex;
+    RoleTally tally;                     // Win/appearance counts per role
+    std::atomic<long> scheduled{0};      // Games handed out to workers so far
+    std::atomic<bool> done{false};
+
+    bool converged(const SweepOptions& options) const {
+        if (tally.games >= options.max_games) {
+            return true;
+        }
+        if (tally.games < options.min_games) {
+            return false;
+        }
+        for (int r = 0; r < ROLE_COUNT; ++r) {
+            if (tally.appearances[r] == 0) {
+                continue;
+            }
+            double low, high;
+            wilson_interval(tally.wins[r], tally.appearances[r], low, high);
+            if ((high - low) / 2.0 > options.ci_half_width) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Per-worker deque of grid point indices. A worker takes from the back of its own deque
+// and steals from the front of the others, so idle cores join whichever points are still open.
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+
+    void push(size_t task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+
+    bool pop(size_t& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+class SweepRunner {
+private:
+    const SweepOptions& options;
+    std::vector<std::unique_ptr<GridPoint>> points;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::atomic<size_t> remaining;
+
+    bool next_task(size_t worker, size_t& task) {
+        if (queues[worker]->pop(task)) return true;
+        for (size_t i = 1; i < queues.size(); ++i) {
+            if (queues[(worker + i) % queues.size()]->steal(task)) return true;
+        }
+        return false;
+    }
+
+    RoleTally run_batch(const GridPoint& point, long games, std::mt19937_64& rng) {
+        RoleTally tally;
+        std::vector<RoleType> roles(options.players);
+        for (long g = 0; g < games; ++g) {
+            for (auto& role : roles) {
+                role = static_cast<RoleType>(rng() % ROLE_COUNT);
+            }
+            tally.add(roles, simulate_game(point.rules, roles, rng, options.max_turns));
+        }
+        return tally;
+    }
+
+    void worker_loop(size_t worker) {
+        std::mt19937_64 rng(options.seed * 1000003UL + worker);
+        while (remaining.load() > 0) {
+            size_t index;
+            if (!next_task(worker, index)) {
+                std::this_thread::yield();
+                continue;
+            }
+            GridPoint& point = *points[index];
+            if (point.done.load()) {
+                continue;
+            }
+
+            // Reserve a batch and hand the point straight back so other workers can share it
+            long start = point.scheduled.fetch_add(options.batch);
+            if (start >= options.max_games) {
+                continue;
+            }
+            long games = std::min<long>(options.batch, options.max_games - start);
+            queues[worker]->push(index);
+
+            RoleTally tally = run_batch(point, games, rng);
+            std::lock_guard<std::mutex> lock(point.mutex);
+            point.tally.merge(tally);
+            if (!point.done.load() && point.converged(options)) {
+                point.done.store(true);
+                remaining.fetch_sub(1);
+            }
+        }
+    }
+
+public:
+    explicit SweepRunner(const SweepOptions& opts) : options(opts), remaining(0) {
+        // Expand the cartesian product of all axes
+        std::vector<size_t> odometer(options.axes.size(), 0);
+        while (true) {
+            auto point = std::make_unique<GridPoint>();
+            for (size_t a = 0; a < options.axes.size(); ++a) {
+                int value = options.axes[a].second[odometer[a]];
+                point->rules.*RULE_FIELDS.at(options.axes[a].first) = value;
+                point->values.push_back(value);
+            }
+            points.push_back(std::move(point));
+
+            size_t a = 0;
+            while (a < odometer.size() && ++odometer[a] == options.axes[a].second.size()) {
+                odometer[a++] = 0;
+            }
+            if (a == odometer.size()) break;
+        }
+        remaining = points.size();
+    }
+
+    void run() {
+        size_t thread_count = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+        if (thread_count == 0) thread_count = 1;
+        for (size_t i = 0; i < thread_count; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 0; i < points.size(); ++i) {
+            queues[i % thread_count]->push(i);
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back(&SweepRunner::worker_loop, this, i);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void write_table(std::ostream& out) const {
+        for (const auto& axis : options.axes) {
+            out << axis.first << "\t";
+        }
+        out << "games\tdraws";
+        for (int r = 0; r < ROLE_COUNT; ++r) {
+            const char* name = RoleTally::role_name(r);
+            out << "\t" << name << "\t" << name << "_ci_low\t" << name << "_ci_high";
+        }
+        out << "\n";
+
+        for (const auto& point : points) {
+            for (int value : point->values) {
+                out << value << "\t";
+            }
+            const RoleTally& tally = point->tally;
+            out << tally.games << "\t" << tally.draws;
+            for (int r = 0; r < ROLE_COUNT; ++r) {
+                double low, high;
+                wilson_interval(tally.wins[r], tally.appearances[r], low, high);
+                double rate = tally.appearances[r] ? (double)tally.wins[r] / tally.appearances[r] : 0.0;
+                out << "\t" << rate << "\t" << low << "\t" << high;
+            }
+            out << "\n";
+        }
+    }
+};
+
+template <typename Runner>
+int run_and_write(Runner& runner, const std::string& output) {
+    runner.run();
+    if (output.empty()) {
+        runner.write_table(std::cout);
+        return 0;
+    }
+    std::ofstream out(output);
+    if (!out) {
+        std::cerr << "Error: cannot write " << output << "\n";
+        return 1;
+    }
+    runner.write_table(out);
+    return 0;
+}
+
+void print_usage() {
+    std::cerr << "Usage: coup_sweep [--set field=v1,v2,...]... [--players N] [--threads N] [--batch N]\n"
+              << "                  [--min-games N] [--max-games N] [--ci HALF_WIDTH] [--max-turns N]\n"
+              << "                  [--seed N] [--out FILE]\n"
+              << "       coup_sweep --a field=v [--a ...] --b field=v [--b ...] [--role NAME]\n"
+              << "                  [--alpha P] [--margin D] [common options]\n"
+              << "Sweepable fields:";
+    for (const auto& field : RULE_FIELDS) {
+        std::cerr << " " << field.first;
+    }
+    std::cerr << "\n";
+}
+
+void parse_axis(const std::string& spec, SweepOptions& options) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos) {
+        throw std::invalid_argument("Expected field=v1,v2,... but got " + spec);
+    }
+    std::string field = spec.substr(0, eq);
+    if (RULE_FIELDS.find(field) == RULE_FIELDS.end()) {
+        throw std::invalid_argument("Unknown rule field " + field);
+    }
+    std::vector<int> values;
+    std::stringstream list(spec.substr(eq + 1));
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        values.push_back(std::stoi(item));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("No values given for " + field);
+    }
+    options.axes.push_back({field, values});
+}
+
+void parse_setting(const std::string& spec, std::vector<std::pair<std::string, int>>& variant) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos) {
+        throw std::invalid_argument("Expected field=value but got " + spec);
+    }
+    std::string field = spec.substr(0, eq);
+    if (RULE_FIELDS.find(field) == RULE_FIELDS.end()) {
+        throw std::invalid_argument("Unknown rule field " + field);
+    }
+    variant.push_back({field, std::stoi(spec.substr(eq + 1))});
+}
+
+int parse_role(const std::string& name) {
+    for (int r = 0; r < ROLE_COUNT; ++r) {
+        if (name == RoleTally::role_name(r)) return r;
+    }
+    throw std::invalid_argument("Unknown role " + name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SweepOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--set") parse_axis(next(), options);
+            else if (arg == "--players") options.players = std::stoi(next());
+            else if (arg == "--threads") options.threads = std::stoi(next());
+            else if (arg == "--batch") options.batch = std::stoi(next());
+            else if (arg == "--min-games") options.min_games = std::stol(next());
+            else if (arg == "--max-games") options.max_games = std::stol(next());
+            else if (arg == "--ci") options.ci_half_width = std::stod(next());
+            else if (arg == "--max-turns") options.max_turns = std::stoi(next());
+            else if (arg == "--seed") options.seed = std::stoul(next());
+            else if (arg == "--out") options.output = next();
+            else if (arg == "--a") parse_setting(next(), options.variant_a);
+            else if (arg == "--b") parse_setting(next(), options.variant_b);
+            else if (arg == "--role") options.role = parse_role(next());
+            else if (arg == "--alpha") options.alpha = std::stod(next());
+            else if (arg == "--margin") options.margin = std::stod(next());
+            else {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+        if (options.players < 2 || options.players > 6) {
+            throw std::invalid_argument("Players must be between 2 and 6");
+        }
+        if (options.batch < 1) {
+            throw std::invalid_argument("Batch size must be positive");
+        }
+        if (!options.axes.empty() && (!options.variant_a.empty() || !options.variant_b.empty())) {
+            throw std::invalid_argument("--set cannot be combined with --a/--b");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    if (!options.variant_a.empty() || !options.variant_b.empty()) {
+        GameRules rules_a, rules_b;
+        for (const auto& setting : options.variant_a) {
+            rules_a.*RULE_FIELDS.at(setting.first) = setting.second;
+        }
+        for (const auto& setting : options.variant_b) {
+            rules_b.*RULE_FIELDS.at(setting.first) = setting.second;
+        }
+        ComparisonOptions comparison;
+        comparison.players = options.players;
+        comparison.threads = options.threads;
+        comparison.batch = options.batch;
+        comparison.min_games = options.min_games;
+        comparison.max_games = options.max_games;
+        comparison.max_turns = options.max_turns;
+        comparison.seed = options.seed;
+        comparison.role = options.role;
+        comparison.alpha = options.alpha;
+        comparison.margin = options.margin;
+        ComparisonRunner runner(rules_a, rules_b, comparison);
+        return run_and_write(runner, options.output);
+    }
+    SweepRunner runner(options);
+    return run_and_write(runner, options.output);
+}
@@ -0,0 +1,364 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Tablebase.hpp"
+#include "../include/Game.hpp"
+#include "../include/Player.hpp"
+#include "../include/Simulator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'C', 'O', 'U', 'P', 'T', 'B', '3', '\0'};
+
+struct TablebaseHeader {
+    char magic[8];
+    uint32_t coin_limit;
+    uint32_t reserved;
+    uint64_t state_count;
+    uint64_t rules_hash;
+};
+
+// Successor edges: a state index or one of the markers below, plus the two flag bits.
+// A move has one edge per reaction of the opponent (let it stand, or block it); the
+// edges after the first carry REACTION, and the opponent picks the one worst for the mover.
+const uint32_t SAME_SIDE = 1u << 31;     // The mover also moves in the successor (extra turn)
+const uint32_t REACTION = 1u << 30;      // Another reaction to the previous edge's move
+const uint32_t MOVER_WINS = 0x3FFFFFFFu; // The move ends the game in the mover's favour
+const uint32_t OUT_OF_TABLE = 0x3FFFFFFEu; // Successor cannot be indexed; scored as a draw
+
+TablebaseResult flip(TablebaseResult result) {
+    if (result == TablebaseResult::WIN) return TablebaseResult::LOSS;
+    if (result == TablebaseResult::LOSS) return TablebaseResult::WIN;
+    return result;
+}
+
+size_t thread_count_for(int threads) {
+    size_t count = threads > 0 ? threads : std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Runs body(begin, end, thread) over [0, total) split into one contiguous range per thread
+template <typename Body>
+void parallel_ranges(size_t total, size_t threads, Body body) {
+    std::vector<std::thread> workers;
+    size_t step = (total + threads - 1) / threads;
+    for (size_t t = 0; t < threads; ++t) {
+        size_t begin = std::min(total, t * step);
+        size_t end = std::min(total, begin + step);
+        workers.emplace_back(body, begin, end, t);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+const int TablebaseIndex::COIN_LIMIT;
+const uint32_t TablebaseIndex::STATE_COUNT;
+
+uint64_t rules_hash(const GameRules& rules) {
+    // FNV-1a over the raw rules, which are plain ints as in Game::save
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&rules);
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < sizeof(GameRules); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool TablebaseIndex::index_of(const GameState& state, uint32_t& index) {
+    if (state.player_count != 2 || !state.game_active) {
+        return false;
+    }
+    const PlayerState& a = state.players[0];
+    const PlayerState& b = state.players[1];
+    if (!a.active || !b.active || a.role < 0 || a.role > 5 || b.role < 0 || b.role > 5 ||
+        a.coins < 0 || a.coins >= COIN_LIMIT || b.coins < 0 || b.coins >= COIN_LIMIT || state.current_player > 1) {
+        return false;
+    }
+    uint32_t i = a.role;
+    i = i * 6 + b.role;
+    i = i * COIN_LIMIT + a.coins;
+    i = i * COIN_LIMIT + b.coins;
+    i = i * 2 + a.sanctioned;
+    i = i * 2 + b.sanctioned;
+    i = i * 2 + (a.last_arrested == 1);
+    i = i * 2 + (b.last_arrested == 0);
+    i = i * 2 + (state.current_player == 1);
+    i = i * 2 + state.extra_turn;
+    index = i;
+    return true;
+}
+
+GameState TablebaseIndex::state_at(uint32_t index) {
+    GameState state{};
+    state.player_count = 2;
+    state.game_active = true;
+    state.extra_turn = index % 2; index /= 2;
+    state.current_player = index % 2; index /= 2;
+    state.players[1].last_arrested = (index % 2) ? 0 : -1; index /= 2;
+    state.players[0].last_arrested = (index % 2) ? 1 : -1; index /= 2;
+    state.players[1].sanctioned = index % 2; index /= 2;
+    state.players[0].sanctioned = index % 2; index /= 2;
+    state.players[1].coins = index % COIN_LIMIT; index /= COIN_LIMIT;
+    state.players[0].coins = index % COIN_LIMIT; index /= COIN_LIMIT;
+    state.players[1].role = index % 6; index /= 6;
+    state.players[0].role = static_cast<int8_t>(index);
+    state.players[0].active = true;
+    state.players[1].active = true;
+    return state;
+}
+
+TablebaseGenerator::TablebaseGenerator(const GameRules& game_rules)
+    : rules(game_rules), out_of_table_moves(0), out_of_table_states(0) {
+}
+
+void TablebaseGenerator::generate(int threads) {
+    const size_t total = TablebaseIndex::STATE_COUNT;
+    size_t thread_count = thread_count_for(threads);
+
+    // 1. Forward pass: successor edges of every state, generated by the real rules
+    std::vector<std::vector<uint32_t>> edges(thread_count);
+    std::vector<std::vector<uint32_t>> counts(thread_count);
+    std::vector<size_t> outside_moves(thread_count, 0);
+    std::vector<size_t> outside_states(thread_count, 0);
+    parallel_ranges(total, thread_count, [&](size_t begin, size_t end, size_t t) {
+        Game game(rules);
+        for (int i = 0; i < 2; ++i) {
+            game.add_player(std::make_shared<Player>("P" + std::to_string(i + 1)));
+        }
+        game.start_game();
+        // Only the record a block may undo is needed; restore_state does not clear the history
+        game.set_history_limit(1);
+
+        for (size_t index = begin; index < end; ++index) {
+            GameState base = TablebaseIndex::state_at(static_cast<uint32_t>(index));
+            game.restore_state(base);
+            std::vector<Move> moves = legal_moves(game);
+            size_t before = edges[t].size();
+            size_t outside = outside_moves[t];
+            auto record = [&](uint32_t flags) {
+                GameState next = game.capture_state();
+                uint32_t successor;
+                if (!next.game_active) {
+                    edges[t].push_back(MOVER_WINS | flags);
+                } else if (TablebaseIndex::index_of(next, successor)) {
+                    edges[t].push_back(successor | flags | (next.current_player == base.current_player ? SAME_SIDE : 0));
+                } else {
+                    edges[t].push_back(OUT_OF_TABLE | flags);
+                    outside_moves[t]++;
+                }
+            };
+            if (moves.empty()) {
+                game.next_turn();
+                record(0);
+            }
+            for (const Move& move : moves) {
+                // The action stands, or is blocked by one of the players allowed to
+                game.restore_state(base);
+                play_action(game, move);
+                std::vector<Player*> blockers = reaction_blockers(game, move);
+                complete_move(game, move);
+                record(0);
+                for (size_t b = 0; b < blockers.size(); ++b) {
+                    game.restore_state(base);
+                    play_action(game, move);
+                    game.resolve_block(reaction_blockers(game, move)[b]);
+                    complete_move(game, move);
+                    record(REACTION);
+                }
+            }
+            counts[t].push_back(static_cast<uint32_t>(edges[t].size() - before));
+            outside_states[t] += outside_moves[t] != outside;
+        }
+    });
+    out_of_table_moves = 0;
+    out_of_table_states = 0;
+    for (size_t t = 0; t < thread_count; ++t) {
+        out_of_table_moves += outside_moves[t];
+        out_of_table_states += outside_states[t];
+    }
+
+    std::vector<uint32_t> offsets(total + 1, 0);
+    std::vector<uint32_t> all_edges;
+    size_t index = 0;
+    for (size_t t = 0; t < thread_count; ++t) {
+        for (uint32_t count : counts[t]) {
+            offsets[index + 1] = offsets[index] + count;
+            index++;
+        }
+        all_edges.insert(all_edges.end(), edges[t].begin(), edges[t].end());
+        std::vector<uint32_t>().swap(edges[t]);
+    }
+
+    // 2. Retrograde passes: a move wins if every reaction to it reaches a position lost for
+    //    the opponent, and loses if some reaction reaches a position won for the opponent. A
+    //    state is won if some move wins, lost if every move loses. Each pass reads the
+    //    previous values only, so ranges are solved in parallel without locks.
+    std::vector<uint8_t> current(total, static_cast<uint8_t>(TablebaseResult::UNKNOWN));
+    std::vector<uint8_t> next = current;
+    while (true) {
+        std::atomic<bool> changed(false);
+        parallel_ranges(total, thread_count, [&](size_t begin, size_t end, size_t) {
+            bool local_change = false;
+            for (size_t s = begin; s < end; ++s) {
+                next[s] = current[s];
+                if (current[s] != static_cast<uint8_t>(TablebaseResult::UNKNOWN)) {
+                    continue;
+                }
+                bool all_lost = true;
+                bool won = false;
+                bool move_won = false;           // Every reaction so far leaves the mover winning
+                bool move_lost = false;          // Some reaction so far leaves the mover losing
+                for (uint32_t e = offsets[s]; e < offsets[s + 1] && !won; ++e) {
+                    uint32_t edge = all_edges[e];
+                    uint32_t target = edge & ~(SAME_SIDE | REACTION);
+                    TablebaseResult result;
+                    if (target == MOVER_WINS) {
+                        result = TablebaseResult::WIN;
+                    } else if (target == OUT_OF_TABLE) {
+                        result = TablebaseResult::DRAW;
+                    } else {
+                        result = static_cast<TablebaseResult>(current[target]);
+                        if (!(edge & SAME_SIDE)) {
+                            result = flip(result);
+                        }
+                    }
+                    if (!(edge & REACTION)) {
+                        move_won = true;
+                        move_lost = false;
+                    }
+                    move_won = move_won && result == TablebaseResult::WIN;
+                    move_lost = move_lost || result == TablebaseResult::LOSS;
+                    // The move's last reaction settles it
+                    if (e + 1 == offsets[s + 1] || !(all_edges[e + 1] & REACTION)) {
+                        won = move_won;
+                        all_lost = all_lost && move_lost;
+                    }
+                }
+                if (won) {
+                    next[s] = static_cast<uint8_t>(TablebaseResult::WIN);
+                } else if (all_lost && offsets[s + 1] > offsets[s]) {
+                    next[s] = static_cast<uint8_t>(TablebaseResult::LOSS);
+                }
+                local_change = local_change || next[s] != current[s];
+            }
+            if (local_change) {
+                changed.store(true);
+            }
+        });
+        current.swap(next);
+        if (!changed.load()) {
+            break;
+        }
+    }
+
+    // Whatever is still unresolved can be kept going forever by both sides
+    for (auto& value : current) {
+        if (value == static_cast<uint8_t>(TablebaseResult::UNKNOWN)) {
+            value = static_cast<uint8_t>(TablebaseResult::DRAW);
+        }
+    }
+    values.swap(current);
+}
+
+size_t TablebaseGenerator::count(TablebaseResult result) const {
+    size_t total = 0;
+    for (uint8_t value : values) {
+        total += value == static_cast<uint8_t>(result);
+    }
+    return total;
+}
+
+void TablebaseGenerator::write(const std::string& path) const {
+    if (values.size() != TablebaseIndex::STATE_COUNT) {
+        throw std::runtime_error("Tablebase has not been generated");
+    }
+    TablebaseHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.coin_limit = TablebaseIndex::COIN_LIMIT;
+    header.state_count = values.size();
+    header.rules_hash = rules_hash(rules);
+
+    std::vector<uint8_t> packed((values.size() + 3) / 4, 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        packed[i / 4] |= values[i] << ((i % 4) * 2);
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Cannot create tablebase file " + path);
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(packed.data(), 1, packed.size(), file) == packed.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw std::runtime_error("Failed writing tablebase file " + path);
+    }
+}
+
+Tablebase::Tablebase(const std::string& path, const GameRules& rules)
+    : mapping(nullptr), mapping_size(0), packed(nullptr) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open tablebase file " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read tablebase file " + path);
+    }
+    mapping_size = static_cast<size_t>(info.st_size);
+    size_t expected = sizeof(TablebaseHeader) + (TablebaseIndex::STATE_COUNT + 3) / 4;
+    if (mapping_size != expected) {
+        ::close(fd);
+        throw std::runtime_error("Tablebase file has the wrong size");
+    }
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Cannot map tablebase file " + path);
+    }
+
+    const TablebaseHeader* header = static_cast<const TablebaseHeader*>(mapping);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->coin_limit != (uint32_t)TablebaseIndex::COIN_LIMIT ||
+        header->state_count != TablebaseIndex::STATE_COUNT) {
+        ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Not a tablebase file: " + path);
+    }
+    if (header->rules_hash != rules_hash(rules)) {
+        ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Tablebase file was generated for other rules: " + path);
+    }
+    packed = static_cast<const uint8_t*>(mapping) + sizeof(TablebaseHeader);
+}
+
+Tablebase::~Tablebase() {
+    if (mapping) {
+        ::munmap(mapping, mapping_size);
+    }
+}
+
+TablebaseResult Tablebase::probe(const GameState& state) const {
+    uint32_t index;
+    if (!TablebaseIndex::index_of(state, index)) {
+        return TablebaseResult::UNKNOWN;
+    }
+    return static_cast<TablebaseResult>((packed[index / 4] >> ((index % 4) * 2)) & 3);
+}
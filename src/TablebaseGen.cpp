@@ -0,0 +1,51 @@
+// yaacovkrawiec@gmail.com
+
+// Two-player endgame tablebase generator.
+// Solves every two-player state (roles, coins, sanctions, last arrests, side to move)
+// with the default rules and writes the bit-packed result for Tablebase to memory-map.
+// The opponent's choice to block or let a move stand is part of the solved game.
+//
+// Example:
+//   ./coup_tablebase --out coup2.tb
+
+#include "../include/Tablebase.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    std::string output = "coup2.tb";
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: coup_tablebase [--out FILE] [--threads N]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    try {
+        auto started = std::chrono::steady_clock::now();
+        TablebaseGenerator generator;
+        generator.generate(threads);
+        generator.write(output);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << "states: " << TablebaseIndex::STATE_COUNT << "\n"
+                  << "wins:   " << generator.count(TablebaseResult::WIN) << "\n"
+                  << "losses: " << generator.count(TablebaseResult::LOSS) << "\n"
+                  << "draws:  " << generator.count(TablebaseResult::DRAW) << "\n"
+                  << "outcomes leaving the table (scored as draws): " << generator.get_out_of_table_moves()
+                  << " from " << generator.get_out_of_table_states() << " states\n"
+                  << "time:   " << seconds << " s\n"
+                  << "written to " << output << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/Timeline.hpp"
+#include <stdexcept>
+#include <string>
+
+GameTimeline::GameTimeline(const Game& start, size_t keyframe_interval) : interval(keyframe_interval) {
+    if (interval == 0) {
+        throw std::invalid_argument("Keyframe interval must be at least 1");
+    }
+    keyframes.emplace_back();
+    start.save(keyframes.back(), KEYFRAME_RECORDS);
+}
+
+void GameTimeline::append(const Game& game, const RecordedTurn& turn) {
+    turns.push_back(turn);
+    if (turns.size() % interval == 0) {
+        keyframes.emplace_back();
+        game.save(keyframes.back(), KEYFRAME_RECORDS);
+    }
+}
+
+void GameTimeline::record(const Game& game, const Move& move, int blocker_seat) {
+    append(game, RecordedTurn{static_cast<int8_t>(move.type), static_cast<int8_t>(move.target),
+                      static_cast<int8_t>(blocker_seat)});
+}
+
+void GameTimeline::record_skip(const Game& game) {
+    append(game, RecordedTurn{-1, -1, -1});
+}
+
+size_t GameTimeline::memory_bytes() const {
+    size_t bytes = turns.capacity() * sizeof(RecordedTurn);
+    for (const auto& keyframe : keyframes) {
+        bytes += keyframe.capacity();
+    }
+    return bytes;
+}
+
+void GameTimeline::materialize(size_t turn, Game& out) const {
+    if (turn > turns.size()) {
+        throw std::out_of_range("Turn " + std::to_string(turn) + " has not been played");
+    }
+    size_t keyframe = turn / interval;
+    out.load(keyframes[keyframe].data(), keyframes[keyframe].size());
+
+    for (size_t t = keyframe * interval; t < turn; ++t) {
+        replay_turn(out, turns[t]);
+    }
+}
@@ -0,0 +1,114 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/TimerWheel.hpp"
+
+TimerWheel::TimerWheel(uint64_t start_tick) : free_head(NIL), current(start_tick), count(0) {
+    for (uint32_t& head : heads) {
+        head = NIL;
+    }
+}
+
+void TimerWheel::link(uint32_t index) {
+    Node& node = nodes[index];
+    // The lowest level whose span still contains both now and the deadline
+    uint32_t list = OVERFLOW_LIST;
+    for (int level = 0; level < LEVELS; ++level) {
+        int shift = (level + 1) * SLOT_BITS;
+        if ((node.deadline >> shift) == (current >> shift)) {
+            list = level * SLOTS + ((node.deadline >> (level * SLOT_BITS)) & (SLOTS - 1));
+            break;
+        }
+    }
+    node.list = list;
+    node.prev = NIL;
+    node.next = heads[list];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    heads[list] = index;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.list] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+}
+
+void TimerWheel::cascade(int level) {
+    uint32_t list = level < LEVELS ? level * SLOTS + ((current >> (level * SLOT_BITS)) & (SLOTS - 1)) : OVERFLOW_LIST;
+    uint32_t index = heads[list];
+    heads[list] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delay_ticks, uint64_t payload) {
+    uint32_t index;
+    if (free_head != NIL) {
+        index = free_head;
+        free_head = nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{0, 0, NIL, NIL, 0, FREE_LIST});
+    }
+    Node& node = nodes[index];
+    node.deadline = current + (delay_ticks > 0 ? delay_ticks : 1);
+    node.payload = payload;
+    link(index);
+    count++;
+    return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFFu) - 1;
+    if (id == 0 || index >= nodes.size()) {
+        return false;
+    }
+    Node& node = nodes[index];
+    if (node.list == FREE_LIST || node.generation != static_cast<uint32_t>(id >> 32)) {
+        return false;
+    }
+    unlink(index);
+    node.list = FREE_LIST;
+    node.generation++;
+    node.next = free_head;
+    free_head = index;
+    count--;
+    return true;
+}
+
+void TimerWheel::advance(uint64_t now, const std::function<void(uint64_t payload)>& on_expire) {
+    while (current < now) {
+        if (count == 0) {
+            current = now;
+            break;
+        }
+        current++;
+
+        // Each time a level wraps, the next slot of the level above moves down
+        int wrapped = 0;
+        while (wrapped < LEVELS && ((current >> ((wrapped + 1) * SLOT_BITS)) << ((wrapped + 1) * SLOT_BITS)) == current) {
+            wrapped++;
+        }
+        for (int level = wrapped; level >= 1; --level) {
+            cascade(level);
+        }
+
+        uint32_t list = current & (SLOTS - 1);
+        while (heads[list] != NIL) {
+            uint32_t index = heads[list];
+            uint64_t payload = nodes[index].payload;
+            cancel((static_cast<uint64_t>(nodes[index].generation) << 32) | (index + 1));
+            on_expire(payload);
+        }
+    }
+}
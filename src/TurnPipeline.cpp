@@ -0,0 +1,324 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/TurnPipeline.hpp"
+#include "../include/Player.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+std::atomic<size_t> game_frame_bytes(0);
+
+// Default block answer: only coups are blocked, like block_coups_only
+bool blocks_coups(const Game& game) {
+    return game.get_action_history().back().action == ActionType::COUP;
+}
+
+// Suspends the game until its seat answers; an immediate answer never suspends
+struct InputAwaitable {
+    SeatInput* source;
+    InputRequest& request;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> game) {
+        request.waiting = game;
+        // Once answer() returns false another thread may already be resuming the game
+        return !source->answer(request);
+    }
+    void await_resume() const noexcept {}
+};
+
+// Plays a game to the end. Only the request, the move in flight and the blocker list live
+// across suspension points, which keeps the frame of a waiting game small.
+//
+// GameHost plays the same turn as a timer-driven state machine rather than through this
+// coroutine: its window is open to every eligible blocker at once until it expires, while
+// here the blockers are asked one by one and a seat may take as long as it likes. Both play
+// a turn through legal_moves, play_action, reaction_blockers, resolve_block and
+// complete_move, so the rules themselves live only in the Simulator and the Game.
+GameTask play_game(Game& game, SeatInput* const* seats, TurnPipeline* pipeline) {
+    InputRequest request{InputRequest::MOVE, &game, -1, 0, Move(MoveType::GATHER), false, false, nullptr, pipeline};
+
+    while (game.is_game_active()) {
+        if (legal_moves(game).empty()) {
+            // Nothing is legal (e.g. sanctioned and broke) - the turn is skipped
+            game.next_turn();
+            continue;
+        }
+
+        request.kind = InputRequest::MOVE;
+        request.seat = game.get_current_player_index();
+        co_await InputAwaitable{seats[request.seat], request};
+        if (request.quit) {
+            co_return;
+        }
+
+        Move move = request.move;
+        if (!is_legal_move(game, move)) {
+            // A seat that keeps answering the same illegal move (e.g. a buggy bot) would be
+            // asked forever; past the limit it is played for, as a timed-out host turn is
+            if (++request.rejected < InputRequest::MAX_REJECTED) {
+                continue;
+            }
+            move = default_move(game);
+        }
+        request.rejected = 0;
+        play_action(game, move);
+
+        std::vector<Player*> blockers = reaction_blockers(game, move);
+        for (Player* blocker : blockers) {
+            request.kind = InputRequest::BLOCK;
+            request.seat = seat_of(game, blocker);
+            request.block = false;
+            co_await InputAwaitable{seats[request.seat], request};
+            if (request.quit) {
+                co_return;
+            }
+            if (request.block) {
+                game.resolve_block(blocker);
+                break;
+            }
+        }
+        complete_move(game, move);
+    }
+}
+
+} // namespace
+
+const int InputRequest::MAX_REJECTED;
+
+void* GameTask::promise_type::operator new(size_t size) {
+    game_frame_bytes = size;
+    return ::operator new(size);
+}
+
+void GameTask::promise_type::operator delete(void* frame, size_t /*size*/) {
+    ::operator delete(frame);
+}
+
+GameTask::~GameTask() {
+    if (handle) {
+        handle.destroy();
+    }
+}
+
+size_t GameTask::frame_bytes() {
+    return game_frame_bytes;
+}
+
+BotInput::BotInput(const std::function<Move(const Game&, int seat)>& choose_move,
+                   const std::function<bool(const Game&, int seat)>& block)
+    : choose(choose_move), decide_block(block) {
+    if (!choose) {
+        throw std::invalid_argument("Bot input needs a move callback");
+    }
+}
+
+bool BotInput::answer(InputRequest& request) {
+    if (request.kind == InputRequest::MOVE) {
+        request.move = choose(*request.game, request.seat);
+    } else {
+        request.block = decide_block ? decide_block(*request.game, request.seat) : blocks_coups(*request.game);
+    }
+    return true;
+}
+
+ReplayInput::ReplayInput(const std::vector<Move>& replay_moves, const std::vector<bool>& replay_blocks)
+    : moves(replay_moves), blocks(replay_blocks), next_move(0), next_block(0) {
+}
+
+bool ReplayInput::answer(InputRequest& request) {
+    if (request.kind == InputRequest::MOVE) {
+        if (next_move == moves.size()) {
+            return false;
+        }
+        request.move = moves[next_move++];
+    } else {
+        // Recorded games only list the blocks that were asked for; missing answers decline
+        request.block = next_block < blocks.size() && blocks[next_block];
+        next_block++;
+    }
+    return true;
+}
+
+std::vector<Move> read_move_file(const std::string& path) {
+    static const char* MOVE_NAMES[] = {"gather", "tax", "bribe", "arrest", "sanction", "coup", "invest"};
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open move file: " + path);
+    }
+
+    std::vector<Move> moves;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name[0] == '#') {
+            continue;
+        }
+        int type = 0;
+        while (type < 7 && name != MOVE_NAMES[type]) {
+            type++;
+        }
+        if (type == 7) {
+            throw std::invalid_argument("Unknown move in " + path + ": " + name);
+        }
+        int target = -1;
+        fields >> target;
+        moves.push_back(Move(static_cast<MoveType>(type), target));
+    }
+    return moves;
+}
+
+QueuedInput::QueuedInput(const std::function<bool(const Game&, int seat)>& block)
+    : waiting(nullptr), quit_pending(false), decide_block(block) {
+}
+
+bool QueuedInput::take(InputRequest& request) {
+    if (request.kind == InputRequest::BLOCK && decide_block) {
+        request.block = decide_block(*request.game, request.seat);
+        return true;
+    }
+    if (quit_pending) {
+        request.quit = true;
+        return true;
+    }
+    if (request.kind == InputRequest::MOVE) {
+        if (moves.empty()) {
+            return false;
+        }
+        request.move = moves.front();
+        moves.pop_front();
+    } else {
+        if (blocks.empty()) {
+            return false;
+        }
+        request.block = blocks.front();
+        blocks.pop_front();
+    }
+    return true;
+}
+
+bool QueuedInput::answer(InputRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (take(request)) {
+        return true;
+    }
+    waiting = &request;
+    return false;
+}
+
+void QueuedInput::push_move(const Move& move) {
+    std::unique_lock<std::mutex> lock(mutex);
+    moves.push_back(move);
+    if (waiting && take(*waiting)) {
+        InputRequest* request = waiting;
+        waiting = nullptr;
+        lock.unlock();
+        request->pipeline->schedule(request->waiting);
+    }
+}
+
+void QueuedInput::push_block(bool block) {
+    std::unique_lock<std::mutex> lock(mutex);
+    blocks.push_back(block);
+    if (waiting && take(*waiting)) {
+        InputRequest* request = waiting;
+        waiting = nullptr;
+        lock.unlock();
+        request->pipeline->schedule(request->waiting);
+    }
+}
+
+void QueuedInput::push_quit() {
+    std::unique_lock<std::mutex> lock(mutex);
+    quit_pending = true;
+    if (waiting) {
+        InputRequest* request = waiting;
+        waiting = nullptr;
+        request->quit = true;
+        lock.unlock();
+        request->pipeline->schedule(request->waiting);
+    }
+}
+
+bool QueuedInput::is_waiting() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return waiting != nullptr;
+}
+
+TurnPipeline::TurnPipeline() : running(0) {
+}
+
+void TurnPipeline::add_game(Game& game, const std::vector<SeatInput*>& seats) {
+    if (seats.size() != game.get_player_count()) {
+        throw std::invalid_argument("Every seat needs an input source");
+    }
+    if (std::find(seats.begin(), seats.end(), nullptr) != seats.end()) {
+        throw std::invalid_argument("Seat input cannot be null");
+    }
+
+    std::unique_ptr<Entry> entry(new Entry{&game, seats, nullptr});
+    entry->task.reset(new GameTask(play_game(game, entry->seats.data(), this)));
+    std::coroutine_handle<> handle = entry->task->get_handle();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(entry));
+    }
+    schedule(handle);
+}
+
+void TurnPipeline::schedule(std::coroutine_handle<> game) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(game);
+    }
+    ready_signal.notify_one();
+}
+
+size_t TurnPipeline::run(int threads) {
+    auto worker = [this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (ready.empty()) {
+                if (running == 0) {
+                    ready_signal.notify_all();
+                    return;
+                }
+                ready_signal.wait(lock);
+                continue;
+            }
+            std::coroutine_handle<> game = ready.front();
+            ready.pop_front();
+            running++;
+            lock.unlock();
+            game.resume();
+            lock.lock();
+            running--;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    size_t finished = 0;
+    for (const auto& entry : entries) {
+        if (entry->task->done()) {
+            if (entry->task->get_handle().promise().error) {
+                std::rethrow_exception(entry->task->get_handle().promise().error);
+            }
+            finished++;
+        }
+    }
+    return finished;
+}
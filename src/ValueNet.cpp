@@ -0,0 +1,339 @@
+// yaacovkrawiec@gmail.com
+
+#include "../include/ValueNet.hpp"
+#include "../include/Game.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VALUENET_X86 1
+#include <immintrin.h>
+#endif
+
+const size_t ValueNet::MAX_WIDTH;
+const size_t ValueNet::TILE;
+
+namespace {
+
+const uint32_t NET_MAGIC = 0x314e5643; // "CVN1"
+const size_t PAD = 16;                 // Outputs are padded to whole AVX-512 vectors
+const size_t STRIDE = ValueNet::MAX_WIDTH;
+
+int8_t clamp_count(int value) {
+    return static_cast<int8_t>(std::min(std::max(value, 0), 127));
+}
+
+// Computes one layer for TILE positions: out[r] = bias + in[r] * w, with w stored as
+// inputs x outputs so every weight vector is loaded once for all TILE positions
+typedef void (*DenseKernel)(const float* in, size_t inputs, const float* w, const float* bias, size_t outputs,
+                            bool relu, float* out);
+
+void dense_scalar(const float* in, size_t inputs, const float* w, const float* bias, size_t outputs, bool relu,
+                  float* out) {
+    for (size_t r = 0; r < ValueNet::TILE; ++r) {
+        float* row = out + r * STRIDE;
+        std::copy(bias, bias + outputs, row);
+        for (size_t i = 0; i < inputs; ++i) {
+            float x = in[r * STRIDE + i];
+            const float* weights = w + i * outputs;
+            for (size_t o = 0; o < outputs; ++o) {
+                row[o] += x * weights[o];
+            }
+        }
+        if (relu) {
+            for (size_t o = 0; o < outputs; ++o) {
+                row[o] = std::max(row[o], 0.0f);
+            }
+        }
+    }
+}
+
+#ifdef VALUENET_X86
+
+// Each block of output vectors is accumulated for all TILE positions at once: per input, one
+// broadcast per position and one load per weight vector feed VECTORS * TILE FMAs. The small
+// loops are unrolled so the accumulators stay in registers.
+template <int VECTORS>
+__attribute__((target("avx2,fma"))) inline void block_avx2(const float* in, size_t inputs, const float* w,
+                                                           const float* bias, size_t outputs, bool relu, float* out) {
+    __m256 acc[VECTORS][ValueNet::TILE];
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; ++v) {
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            acc[v][r] = _mm256_loadu_ps(bias + 8 * v);
+        }
+    }
+    for (size_t i = 0; i < inputs; ++i) {
+        __m256 weights[VECTORS];
+        #pragma GCC unroll 16
+        for (int v = 0; v < VECTORS; ++v) {
+            weights[v] = _mm256_loadu_ps(w + i * outputs + 8 * v);
+        }
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            __m256 x = _mm256_broadcast_ss(in + r * STRIDE + i);
+            #pragma GCC unroll 16
+            for (int v = 0; v < VECTORS; ++v) {
+                acc[v][r] = _mm256_fmadd_ps(x, weights[v], acc[v][r]);
+            }
+        }
+    }
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; ++v) {
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            _mm256_storeu_ps(out + r * STRIDE + 8 * v, relu ? _mm256_max_ps(acc[v][r], _mm256_setzero_ps()) : acc[v][r]);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void dense_avx2(const float* in, size_t inputs, const float* w, const float* bias, size_t outputs, bool relu,
+                float* out) {
+    // Outputs are padded to 16, so two vectors at a time always fit
+    for (size_t o = 0; o < outputs; o += 16) {
+        block_avx2<2>(in, inputs, w + o, bias + o, outputs, relu, out + o);
+    }
+}
+
+template <int VECTORS>
+__attribute__((target("avx512f"))) inline void block_avx512(const float* in, size_t inputs, const float* w,
+                                                            const float* bias, size_t outputs, bool relu, float* out) {
+    __m512 acc[VECTORS][ValueNet::TILE];
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; ++v) {
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            acc[v][r] = _mm512_loadu_ps(bias + 16 * v);
+        }
+    }
+    for (size_t i = 0; i < inputs; ++i) {
+        __m512 weights[VECTORS];
+        #pragma GCC unroll 16
+        for (int v = 0; v < VECTORS; ++v) {
+            weights[v] = _mm512_loadu_ps(w + i * outputs + 16 * v);
+        }
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            __m512 x = _mm512_set1_ps(in[r * STRIDE + i]);
+            #pragma GCC unroll 16
+            for (int v = 0; v < VECTORS; ++v) {
+                acc[v][r] = _mm512_fmadd_ps(x, weights[v], acc[v][r]);
+            }
+        }
+    }
+    #pragma GCC unroll 16
+    for (int v = 0; v < VECTORS; ++v) {
+        #pragma GCC unroll 16
+        for (size_t r = 0; r < ValueNet::TILE; ++r) {
+            __m512 value = acc[v][r];
+            if (relu) {
+                value = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(value, _mm512_setzero_ps(), _CMP_GT_OQ), value);
+            }
+            _mm512_storeu_ps(out + r * STRIDE + 16 * v, value);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+void dense_avx512(const float* in, size_t inputs, const float* w, const float* bias, size_t outputs, bool relu,
+                  float* out) {
+    size_t o = 0;
+    for (; o + 64 <= outputs; o += 64) {
+        block_avx512<4>(in, inputs, w + o, bias + o, outputs, relu, out + o);
+    }
+    switch ((outputs - o) / 16) {
+        case 3: block_avx512<3>(in, inputs, w + o, bias + o, outputs, relu, out + o); break;
+        case 2: block_avx512<2>(in, inputs, w + o, bias + o, outputs, relu, out + o); break;
+        case 1: block_avx512<1>(in, inputs, w + o, bias + o, outputs, relu, out + o); break;
+        default: break;
+    }
+}
+
+#endif
+
+bool cpu_supports(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return true;
+#ifdef VALUENET_X86
+        case SimdLevel::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case SimdLevel::AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+        default: return false;
+    }
+}
+
+DenseKernel kernel_for(SimdLevel level) {
+#ifdef VALUENET_X86
+    if (level == SimdLevel::AVX512) return dense_avx512;
+    if (level == SimdLevel::AVX2) return dense_avx2;
+#endif
+    (void)level;
+    return dense_scalar;
+}
+
+template <typename T>
+void read_value(std::FILE* file, T* values, size_t count) {
+    if (std::fread(values, sizeof(T), count, file) != count) {
+        throw std::runtime_error("Truncated value net file");
+    }
+}
+
+} // namespace
+
+void encode_features(const GameState& state, int seat, int8_t out[FEATURE_COUNT]) {
+    std::fill(out, out + FEATURE_COUNT, 0);
+    int count = state.player_count;
+    int arrested_slot = 0;
+    for (int slot = 0; slot < count; ++slot) {
+        int at = (seat + slot) % count;
+        const PlayerState& player = state.players[at];
+        int8_t* features = out + slot * SEAT_FEATURES;
+        features[0] = player.active;
+        features[1] = clamp_count(player.coins);
+        features[2] = player.sanctioned;
+        features[3] = at == state.current_player;
+        if (player.role >= 0) {
+            features[4 + player.role] = 1;
+        }
+        if (state.players[seat].last_arrested == at) {
+            arrested_slot = slot + 1;
+        }
+    }
+    int8_t* table = out + MAX_PLAYERS * SEAT_FEATURES;
+    table[0] = clamp_count(state.treasury);
+    table[1] = state.extra_turn;
+    table[2] = static_cast<int8_t>(count);
+    table[3] = static_cast<int8_t>(arrested_slot);
+}
+
+std::vector<DenseLayer> read_value_net(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Cannot open value net " + path);
+    }
+    std::vector<DenseLayer> layers;
+    try {
+        uint32_t header[2];
+        read_value(file, header, 2);
+        if (header[0] != NET_MAGIC || header[1] == 0 || header[1] > 16) {
+            throw std::runtime_error("Not a value net: " + path);
+        }
+        for (uint32_t l = 0; l < header[1]; ++l) {
+            uint32_t shape[2];
+            read_value(file, shape, 2);
+            if (shape[0] == 0 || shape[1] == 0 || shape[0] > ValueNet::MAX_WIDTH || shape[1] > ValueNet::MAX_WIDTH) {
+                throw std::runtime_error("Bad layer size in value net " + path);
+            }
+            DenseLayer layer{shape[0], shape[1], std::vector<float>(shape[0] * shape[1]), std::vector<float>(shape[1])};
+            read_value(file, layer.weights.data(), layer.weights.size());
+            read_value(file, layer.biases.data(), layer.biases.size());
+            layers.push_back(std::move(layer));
+        }
+        if (std::fgetc(file) != EOF) {
+            throw std::runtime_error("Trailing bytes in value net " + path);
+        }
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+    std::fclose(file);
+    return layers;
+}
+
+void write_value_net(const std::string& path, const std::vector<DenseLayer>& layers) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Cannot write value net " + path);
+    }
+    bool ok = true;
+    uint32_t header[2] = {NET_MAGIC, static_cast<uint32_t>(layers.size())};
+    ok = std::fwrite(header, sizeof(header), 1, file) == 1;
+    for (const DenseLayer& layer : layers) {
+        uint32_t shape[2] = {static_cast<uint32_t>(layer.inputs), static_cast<uint32_t>(layer.outputs)};
+        ok = ok && std::fwrite(shape, sizeof(shape), 1, file) == 1;
+        ok = ok && std::fwrite(layer.weights.data(), sizeof(float), layer.weights.size(), file) == layer.weights.size();
+        ok = ok && std::fwrite(layer.biases.data(), sizeof(float), layer.biases.size(), file) == layer.biases.size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw std::runtime_error("Failed writing value net " + path);
+    }
+}
+
+SimdLevel detect_simd() {
+    if (cpu_supports(SimdLevel::AVX512)) return SimdLevel::AVX512;
+    if (cpu_supports(SimdLevel::AVX2)) return SimdLevel::AVX2;
+    return SimdLevel::SCALAR;
+}
+
+ValueNet::ValueNet(const std::vector<DenseLayer>& dense_layers) : simd(detect_simd()) {
+    if (dense_layers.empty() || dense_layers.front().inputs != static_cast<size_t>(FEATURE_COUNT) ||
+        dense_layers.back().outputs != 1) {
+        throw std::invalid_argument("Value net must map the features to one output");
+    }
+    size_t inputs = FEATURE_COUNT;
+    size_t previous_outputs = FEATURE_COUNT;
+    for (const DenseLayer& dense : dense_layers) {
+        if (dense.inputs != previous_outputs || dense.outputs == 0 || dense.outputs > MAX_WIDTH ||
+            dense.weights.size() != dense.inputs * dense.outputs || dense.biases.size() != dense.outputs) {
+            throw std::invalid_argument("Value net layers do not fit together");
+        }
+        // Padding outputs get zero weights and biases, so they stay zero through every ReLU
+        Layer layer;
+        layer.inputs = inputs;
+        layer.outputs = (dense.outputs + PAD - 1) / PAD * PAD;
+        layer.weights.assign(layer.inputs * layer.outputs, 0.0f);
+        layer.biases.assign(layer.outputs, 0.0f);
+        for (size_t o = 0; o < dense.outputs; ++o) {
+            for (size_t i = 0; i < dense.inputs; ++i) {
+                layer.weights[i * layer.outputs + o] = dense.weights[o * dense.inputs + i];
+            }
+            layer.biases[o] = dense.biases[o];
+        }
+        layers.push_back(std::move(layer));
+        previous_outputs = dense.outputs;
+        inputs = layers.back().outputs;
+    }
+}
+
+void ValueNet::set_simd(SimdLevel level) {
+    if (!cpu_supports(level)) {
+        throw std::invalid_argument("This CPU cannot run the requested SIMD level");
+    }
+    simd = level;
+}
+
+void ValueNet::evaluate(const int8_t* features, size_t count, float* values) const {
+    DenseKernel kernel = kernel_for(simd);
+    alignas(64) float buffers[2][TILE * STRIDE];
+    for (size_t first = 0; first < count; first += TILE) {
+        size_t rows = std::min(TILE, count - first);
+        float* in = buffers[0];
+        float* out = buffers[1];
+        for (size_t r = 0; r < TILE; ++r) {
+            for (int f = 0; f < FEATURE_COUNT; ++f) {
+                in[r * STRIDE + f] = r < rows ? features[(first + r) * FEATURE_COUNT + f] : 0.0f;
+            }
+        }
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Layer& layer = layers[l];
+            kernel(in, layer.inputs, layer.weights.data(), layer.biases.data(), layer.outputs, l + 1 < layers.size(), out);
+            std::swap(in, out);
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            values[first + r] = 1.0f / (1.0f + std::exp(-in[r * STRIDE]));
+        }
+    }
+}
+
+float ValueNet::evaluate(const Game& game, int seat) const {
+    int8_t features[FEATURE_COUNT];
+    encode_features(game.capture_state(), seat, features);
+    float value;
+    evaluate(features, 1, &value);
+    return value;
+}
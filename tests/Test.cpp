@@ -5,7 +5,29 @@
 #include "../include/Game.hpp"
 #include "../include/Player.hpp"
 #include "../include/Role.hpp"
+#include "../include/Simulator.hpp"
+#include "../include/RuleComparison.hpp"
+#include "../include/Explorer.hpp"
+#include "../include/Tablebase.hpp"
+#include "../include/PlayerView.hpp"
+#include "../include/Ismcts.hpp"
+#include "../include/FullRules.hpp"
+#include "../include/GameHost.hpp"
+#include "../include/TurnPipeline.hpp"
+#include "../include/Spectator.hpp"
+#include "../include/Snapshot.hpp"
+#include "../include/Journal.hpp"
+#include "../include/Timeline.hpp"
+#include "../include/Archive.hpp"
+#include "../include/ValueNet.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
 
 TEST_CASE("Player creation and basic attributes") {
     Player player("TestPlayer");
@@ -249,6 +271,37 @@ TEST_CASE("Role-specific abilities") {
     }
 }
 
+TEST_CASE("Spy blocks an arrest against itself") {
+    Game game;
+    auto gov = std::make_shared<Player>("Governor");
+    auto spy = std::make_shared<Player>("Spy");
+    gov->set_role(std::make_shared<Governor>());
+    spy->set_role(std::make_shared<Spy>());
+    game.add_player(gov);
+    game.add_player(spy);
+    game.start_game();
+    auto spy_role = std::dynamic_pointer_cast<Spy>(spy->get_role());
+
+    SUBCASE("The arrest is undone") {
+        int spy_coins = spy->get_coins();
+        int gov_coins = gov->get_coins();
+        gov->arrest(*spy, game);
+        CHECK(spy->get_coins() == spy_coins - 1);
+        spy_role->block_arrest(*spy, game);
+        CHECK(spy->get_coins() == spy_coins);
+        CHECK(gov->get_coins() == gov_coins);
+        CHECK(game.get_action_history().back().was_blocked == true);
+        CHECK(game.get_action_history().back().blocker == spy.get());
+        CHECK(game.get_state_checksum() == state_checksum(game.capture_state()));
+    }
+
+    SUBCASE("Only arrests can be blocked") {
+        CHECK_THROWS_AS(spy_role->block_arrest(*spy, game), std::runtime_error);
+        gov->gather(game);
+        CHECK_THROWS_AS(spy_role->block_arrest(*spy, game), std::runtime_error);
+    }
+}
+
 TEST_CASE("Game state management") {
     Game game;
     auto p1 = std::make_shared<Player>("Alice");
@@ -544,6 +597,61 @@ TEST_CASE("Action history and blocking") {
         game.block_last_action();
         CHECK(game.can_block_last_action(p1.get()) == false);
     }
+
+    SUBCASE("Role changes after the start update the blockers") {
+        p2->set_role(std::make_shared<Governor>());
+        p1->tax(game);
+        CHECK(p2->get_role()->can_block_action(ActionType::TAX, nullptr, nullptr));
+        CHECK(game.can_block_last_action(p2.get()) == true);
+        CHECK(game.get_state_checksum() == state_checksum(game.capture_state()));
+
+        p2->set_role(std::make_shared<Judge>());
+        CHECK(game.can_block_last_action(p2.get()) == false);
+        p1->set_role(std::make_shared<Judge>());
+        p2->add_coins(2);
+        p2->bribe(game);
+        CHECK(game.can_block_last_action(p1.get()) == true);
+        CHECK(game.get_state_checksum() == state_checksum(game.capture_state()));
+    }
+}
+
+TEST_CASE("Blocks end with the turn") {
+    Game game;
+    auto a = std::make_shared<Player>("A");
+    auto b = std::make_shared<Player>("B");
+    auto c = std::make_shared<Player>("C");
+    a->set_role(std::make_shared<Baron>());
+    b->set_role(std::make_shared<Merchant>());
+    c->set_role(std::make_shared<Governor>());
+    game.add_player(a);
+    game.add_player(b);
+    game.add_player(c);
+    game.start_game();
+    b->add_coins(1);
+
+    a->tax(game);
+    CHECK(game.can_block_last_action(c.get()) == true);
+    game.next_turn();
+
+    // The Merchant's bonus and the turn would be rewound by a late block
+    CHECK(b->get_coins() == 4);
+    CHECK(game.can_block_last_action(c.get()) == false);
+    CHECK(game.eligible_blockers().empty());
+    CHECK_THROWS_AS(game.resolve_block(c.get()), std::runtime_error);
+    CHECK(game.turn() == "B");
+    CHECK(a->get_coins() == 4);
+    CHECK(b->get_coins() == 4);
+
+    // A player that outlives its game can still change role
+    auto survivor = std::make_shared<Player>("S");
+    {
+        Game short_lived;
+        short_lived.add_player(survivor);
+        short_lived.add_player(std::make_shared<Player>("T"));
+        short_lived.start_game();
+    }
+    CHECK(survivor->get_game() == nullptr);
+    survivor->set_role(std::make_shared<Spy>());
 }
 
 TEST_CASE("Forced coup at 10 coins") {
@@ -567,4 +675,2101 @@ TEST_CASE("Forced coup at 10 coins") {
         CHECK_NOTHROW(p1->coup(*p2, game));
         CHECK(p1->get_coins() == 3);  // 10 - 7
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Custom game rules") {
+    GameRules rules;
+    rules.coup_cost = 5;
+    rules.baron_invest_return = 8;
+    rules.merchant_bonus_threshold = 2;
+    rules.starting_treasury = 20;
+    
+    Game game(rules);
+    auto baron = std::make_shared<Player>("Baron", rules.starting_coins);
+    auto merchant = std::make_shared<Player>("Merchant", rules.starting_coins);
+    baron->set_role(std::make_shared<Baron>());
+    merchant->set_role(std::make_shared<Merchant>());
+    game.add_player(baron);
+    game.add_player(merchant);
+    game.start_game();
+    
+    CHECK(game.get_treasury_coins() == 20);
+    
+    SUBCASE("Costs come from the rules") {
+        baron->add_coins(3);
+        CHECK_NOTHROW(baron->coup(*merchant, game));
+        CHECK(baron->get_coins() == 0);
+    }
+    
+    SUBCASE("Role abilities use the rules") {
+        baron->add_coins(1);
+        std::dynamic_pointer_cast<Baron>(baron->get_role())->invest(*baron, game.get_rules());
+        CHECK(baron->get_coins() == 8);
+        
+        // Merchant starts the turn with 2 coins, enough for the lowered threshold
+        game.next_turn();
+        CHECK(merchant->get_coins() == 3);
+    }
+    
+    SUBCASE("Default rules are unchanged") {
+        CHECK(Game().get_treasury_coins() == 50);
+        CHECK(GameRules::defaults().coup_cost == 7);
+    }
+}
+
+TEST_CASE("Simulator moves and games") {
+    Game game;
+    auto p1 = std::make_shared<Player>("P1");
+    auto p2 = std::make_shared<Player>("P2");
+    p1->set_role(make_role(RoleType::BARON));
+    p2->set_role(make_role(RoleType::GENERAL));
+    game.add_player(p1);
+    game.add_player(p2);
+    game.start_game();
+    
+    SUBCASE("Legal moves for a fresh player") {
+        auto moves = legal_moves(game);
+        CHECK(std::find(moves.begin(), moves.end(), Move(MoveType::GATHER)) != moves.end());
+        CHECK(std::find(moves.begin(), moves.end(), Move(MoveType::ARREST, 1)) != moves.end());
+        CHECK(std::find(moves.begin(), moves.end(), Move(MoveType::COUP, 1)) == moves.end());
+    }
+    
+    SUBCASE("Only coups are legal at the forced threshold") {
+        p1->add_coins(8);
+        auto moves = legal_moves(game);
+        CHECK(moves.size() == 1);
+        CHECK(moves[0] == Move(MoveType::COUP, 1));
+    }
+    
+    SUBCASE("Legality, default moves and blockers") {
+        CHECK(is_legal_move(game, Move(MoveType::TAX)));
+        CHECK_FALSE(is_legal_move(game, Move(MoveType::COUP, 1)));
+        CHECK(default_move(game) == Move(MoveType::GATHER));
+        p1->add_coins(8);
+        CHECK(default_move(game) == Move(MoveType::COUP, 1));
+
+        // Only a General who can pay is asked about a coup
+        play_action(game, Move(MoveType::COUP, 1));
+        CHECK(reaction_blockers(game, Move(MoveType::COUP, 1)).empty());
+        p2->add_coins(3);
+        CHECK(reaction_blockers(game, Move(MoveType::COUP, 1)) == std::vector<Player*>{p2.get()});
+        CHECK(reaction_blockers(game, Move(MoveType::GATHER)).empty());
+    }
+
+    SUBCASE("Applying a move advances the turn") {
+        p1->add_coins(1);
+        apply_move(game, Move(MoveType::INVEST));
+        CHECK(p1->get_coins() == 6);  // 3 - 3 + 6
+        CHECK(game.turn() == "P2");
+    }
+    
+    SUBCASE("General blocks a coup when able") {
+        p1->add_coins(5);
+        p2->add_coins(3);
+        apply_move(game, Move(MoveType::COUP, 1));
+        CHECK(p2->is_player_active() == true);
+        CHECK(p2->get_coins() == 0);
+    }
+    
+    SUBCASE("Simulated games finish with a winner") {
+        std::mt19937_64 rng(42);
+        std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::MERCHANT, RoleType::JUDGE};
+        for (int i = 0; i < 20; ++i) {
+            SimulationResult result = simulate_game(GameRules::defaults(), roles, rng);
+            CHECK(result.turns > 0);
+            CHECK(result.winner < 3);
+        }
+    }
+}
+
+TEST_CASE("Rule comparison verdicts and stopping rule") {
+    SUBCASE("Verdicts") {
+        CHECK(RoleComparison(500, 1000, 600, 1000).verdict(0.01, 0.01) == Verdict::B_BETTER);
+        CHECK(RoleComparison(600, 1000, 500, 1000).verdict(0.01, 0.01) == Verdict::A_BETTER);
+        // The 99% interval of a zero difference over 10000 trials each is about +-0.018
+        CHECK(RoleComparison(5000, 10000, 5000, 10000).verdict(0.01, 0.05) == Verdict::EQUIVALENT);
+        CHECK(RoleComparison(5000, 10000, 5000, 10000).verdict(0.01, 0.01) == Verdict::UNDECIDED);
+        CHECK(RoleComparison(5, 10, 6, 10).verdict(0.01, 0.01) == Verdict::UNDECIDED);
+        CHECK(RoleComparison(600, 1000, 500, 1000).prob_b_better < 0.01);
+        CHECK(std::string(verdict_name(Verdict::EQUIVALENT)) == "equal");
+    }
+
+    SUBCASE("Stop or continue") {
+        ComparisonOptions options;
+        options.min_games = 2000;
+        options.role = static_cast<int>(RoleType::BARON);
+        RoleTally a, b;
+        a.games = b.games = 1000;
+        a.appearances[2] = b.appearances[2] = 1000;
+        a.wins[2] = 500;
+        b.wins[2] = 600;
+        CHECK(comparison_settled(a, b, options) == false);    // Too few games for any verdict
+
+        a.games = b.games = 4000;
+        CHECK(comparison_settled(a, b, options) == true);
+
+        a.wins[2] = 500;
+        b.wins[2] = 510;
+        CHECK(comparison_settled(a, b, options) == false);    // Close and still uncertain
+
+        // Every role must be settled when none is chosen, including roles never seen
+        options.role = -1;
+        b.wins[2] = 600;
+        CHECK(comparison_settled(a, b, options) == false);
+    }
+
+    SUBCASE("Identical variants play identical games") {
+        ComparisonOptions options;
+        options.threads = 1;
+        options.batch = 32;
+        options.min_games = 64;
+        options.max_games = 128;
+        options.role = static_cast<int>(RoleType::BARON);
+        ComparisonRunner runner(GameRules::defaults(), GameRules::defaults(), options);
+        runner.run();
+        const RoleTally& a = runner.get_tally_a();
+        const RoleTally& b = runner.get_tally_b();
+        CHECK(a.games >= 64);
+        CHECK(a.games <= 128);
+        CHECK(a.games == b.games);
+        CHECK(a.draws == b.draws);
+        for (int r = 0; r < RoleTally::ROLES; ++r) {
+            CHECK(a.wins[r] == b.wins[r]);
+            CHECK(a.appearances[r] == b.appearances[r]);
+        }
+        CHECK(runner.compare(2).diff == 0.0);
+        CHECK(runner.settled() == (runner.compare(2).verdict(0.01, 0.01) != Verdict::UNDECIDED));
+    }
+}
+
+TEST_CASE("Game state capture and restore") {
+    Game game;
+    auto p1 = std::make_shared<Player>("P1");
+    auto p2 = std::make_shared<Player>("P2");
+    p1->set_role(std::make_shared<Governor>());
+    p2->set_role(std::make_shared<Merchant>());
+    game.add_player(p1);
+    game.add_player(p2);
+    game.start_game();
+    
+    GameState start = game.capture_state();
+    p1->add_coins(3);
+    p1->arrest(*p2, game);
+    game.next_turn();
+    
+    GameState later = game.capture_state();
+    CHECK(later.players[0].last_arrested == 1);
+    CHECK(later.current_player == 1);
+    CHECK(later.treasury == 52);
+    
+    game.restore_state(start);
+    CHECK(p1->get_coins() == 2);
+    CHECK(p2->get_coins() == 2);
+    CHECK(p1->get_last_arrested() == nullptr);
+    CHECK(game.turn() == "P1");
+    CHECK(game.get_treasury_coins() == 50);
+    
+    game.restore_state(later);
+    CHECK(p1->get_last_arrested() == p2.get());
+    CHECK(game.turn() == "P2");
+    CHECK_THROWS(p1->set_coins(-1));
+}
+
+TEST_CASE("State space exploration") {
+    std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::BARON};
+    
+    SUBCASE("State keys round trip") {
+        StateExpander expander(roles, GameRules());
+        StateCodec codec(roles);
+        uint64_t key = expander.initial_key();
+        uint64_t again;
+        CHECK(codec.encode(codec.decode(key), again));
+        CHECK(again == key);
+        CHECK(codec.decode(key).players[1].coins == 2);
+    }
+    
+    SUBCASE("Expansion follows blocks") {
+        // The Baron's opening tax stands or is blocked by the Governor; nothing else leaves
+        // both players on their starting coins with the Governor to move
+        std::vector<RoleType> baron_first = {RoleType::BARON, RoleType::GOVERNOR};
+        StateExpander expander(baron_first, GameRules());
+        StateCodec codec(baron_first);
+        std::vector<uint64_t> successors;
+        ExpansionCounters counters;
+        expander.expand(expander.initial_key(), successors, counters);
+        bool taxed = false, blocked = false;
+        for (uint64_t key : successors) {
+            GameState next = codec.decode(key);
+            CHECK(next.current_player == 1);
+            taxed |= next.players[0].coins == 4;
+            blocked |= next.players[0].coins == 2 && next.players[1].coins == 2;
+        }
+        CHECK(taxed);
+        CHECK(blocked);
+        CHECK(counters.transitions == successors.size());
+    }
+    
+    SUBCASE("Concurrent set deduplicates") {
+        ConcurrentStateSet set(64);
+        CHECK(set.insert(5) == true);
+        CHECK(set.insert(5) == false);
+        CHECK(set.contains(5));
+        CHECK(!set.contains(6));
+        CHECK(set.size() == 1);
+        CHECK(set.key_at(set.find(5)) == 5);
+        CHECK(set.find(6) == set.capacity());
+    }
+    
+    SUBCASE("Two-player exploration terminates") {
+        ExplorerOptions options;
+        options.roles = roles;
+        options.threads = 2;
+        options.max_states = 1 << 16;
+        ExplorerReport report = StateExplorer(options).run();
+        CHECK(report.complete);
+        CHECK(report.states > 100);
+        CHECK(report.counters.terminal > 0);
+        CHECK(report.counters.rejected_moves == 0);
+        CHECK(report.counters.coin_overflows == 0);
+        // Sanctions and bribes pay coins away, so players can return to earlier states
+        CHECK(report.cycles_checked);
+        CHECK(report.cyclic_states > 0);
+        
+        // Without them no move lowers the total coins for good, and every game ends
+        options.rules.bribe_cost = options.rules.forced_coup_threshold;
+        options.rules.sanction_cost = options.rules.forced_coup_threshold;
+        ExplorerReport acyclic = StateExplorer(options).run();
+        CHECK(acyclic.complete);
+        CHECK(acyclic.cycles_checked);
+        CHECK(acyclic.cyclic_states == 0);
+    }
+    
+    SUBCASE("Disk-backed exploration matches memory") {
+        ExplorerOptions options;
+        options.roles = roles;
+        options.threads = 2;
+        options.max_states = 1 << 16;
+        ExplorerReport memory = StateExplorer(options).run();
+        
+        options.disk_directory = (std::filesystem::temp_directory_path() / "coup_explore_test").string();
+        options.run_buffer_states = 500;
+        ExplorerReport disk = DiskStateExplorer(options).run();
+        CHECK(disk.complete);
+        CHECK(disk.states == memory.states);
+        CHECK(disk.levels.size() == memory.levels.size());
+        CHECK(disk.counters.terminal == memory.counters.terminal);
+        std::filesystem::remove_all(options.disk_directory);
+    }
+    
+    SUBCASE("Run files keep sorted keys") {
+        std::string path = (std::filesystem::temp_directory_path() / "coup_run_test.run").string();
+        {
+            RunWriter writer(path);
+            writer.write(3);
+            writer.write(300);
+            writer.write(1ULL << 62);
+            CHECK_THROWS(writer.write(5));
+        }
+        RunReader reader(path);
+        uint64_t key;
+        CHECK(reader.next(key));
+        CHECK(key == 3);
+        CHECK(reader.next(key));
+        CHECK(key == 300);
+        CHECK(reader.next(key));
+        CHECK(key == (1ULL << 62));
+        CHECK(!reader.next(key));
+        std::remove(path.c_str());
+    }
+    
+    SUBCASE("Run write failures surface from close") {
+        // A full device accepts the buffered bytes but fails them when the file is closed
+        RunWriter failing("/dev/full");
+        failing.write(1);
+        CHECK_THROWS_AS(failing.close(), std::runtime_error);
+        CHECK_NOTHROW(failing.close());
+        {
+            RunWriter dropped("/dev/full");
+            dropped.write(1);
+        }
+    }
+}
+
+TEST_CASE("Two-player tablebase") {
+    SUBCASE("Index is a perfect hash") {
+        for (uint32_t index : {0u, 1u, 12345u, TablebaseIndex::STATE_COUNT - 1}) {
+            uint32_t again;
+            CHECK(TablebaseIndex::index_of(TablebaseIndex::state_at(index), again));
+            CHECK(again == index);
+        }
+        GameState rich = TablebaseIndex::state_at(0);
+        rich.players[0].coins = TablebaseIndex::COIN_LIMIT;
+        uint32_t unused;
+        CHECK(!TablebaseIndex::index_of(rich, unused));
+    }
+    
+    SUBCASE("Generated values load through the mapped file") {
+        TablebaseGenerator generator;
+        generator.generate();
+        
+        // A Governor with 7 coins to move against a broke Judge wins by coup
+        GameState state = TablebaseIndex::state_at(0);
+        state.players[0].role = static_cast<int8_t>(RoleType::GOVERNOR);
+        state.players[1].role = static_cast<int8_t>(RoleType::JUDGE);
+        state.players[0].coins = 7;
+        state.players[1].coins = 0;
+        state.current_player = 0;
+        uint32_t index;
+        REQUIRE(TablebaseIndex::index_of(state, index));
+        CHECK(generator.value(index) == TablebaseResult::WIN);
+        
+        // Gathering at COIN_LIMIT - 1 coins leaves the table
+        CHECK(generator.get_out_of_table_states() > 0);
+        CHECK(generator.get_out_of_table_states() < TablebaseIndex::STATE_COUNT);
+        CHECK(generator.get_out_of_table_moves() >= generator.get_out_of_table_states());
+
+        // Every value is the best move against the opponent's best reaction to it
+        Game game;
+        game.add_player(std::make_shared<Player>("P1"));
+        game.add_player(std::make_shared<Player>("P2"));
+        game.start_game();
+        auto rank = [](TablebaseResult result) {
+            return result == TablebaseResult::LOSS ? 0 : result == TablebaseResult::WIN ? 2 : 1;
+        };
+        auto outcome = [&](const GameState& base) {
+            GameState next = game.capture_state();
+            uint32_t successor;
+            if (!next.game_active) return 2;
+            if (!TablebaseIndex::index_of(next, successor)) return 1;
+            int value = rank(generator.value(successor));
+            return next.current_player == base.current_player ? value : 2 - value;
+        };
+        int checked = 0;
+        int blocks_matter = 0;
+        for (uint32_t i = 0; i < TablebaseIndex::STATE_COUNT; i += 997) {
+            GameState base = TablebaseIndex::state_at(i);
+            game.restore_state(base);
+            std::vector<Move> moves = legal_moves(game);
+            if (moves.empty()) {
+                continue;
+            }
+            int best = 0;
+            for (const Move& move : moves) {
+                game.restore_state(base);
+                play_action(game, move);
+                size_t blockers = reaction_blockers(game, move).size();
+                complete_move(game, move);
+                int stand = outcome(base);
+                int worst = stand;
+                for (size_t b = 0; b < blockers; ++b) {
+                    game.restore_state(base);
+                    play_action(game, move);
+                    game.resolve_block(reaction_blockers(game, move)[b]);
+                    complete_move(game, move);
+                    worst = std::min(worst, outcome(base));
+                }
+                blocks_matter += worst != stand;
+                best = std::max(best, worst);
+            }
+            CHECK(best == rank(generator.value(i)));
+            checked++;
+        }
+        CHECK(checked > 100);
+        CHECK(blocks_matter > 0);
+
+        // States outside the index are never probed, whatever they hold
+        GameState corrupt = state;
+        uint32_t unused;
+        corrupt.players[1].role = 100;
+        CHECK(!TablebaseIndex::index_of(corrupt, unused));
+        corrupt.players[1].role = 6;
+        CHECK(!TablebaseIndex::index_of(corrupt, unused));
+        
+        std::string path = (std::filesystem::temp_directory_path() / "coup_test.tb").string();
+        generator.write(path);
+        {
+            Tablebase table(path);
+            CHECK(table.probe(state) == TablebaseResult::WIN);
+            for (uint32_t i = 0; i < TablebaseIndex::STATE_COUNT; i += 9973) {
+                CHECK(table.probe(TablebaseIndex::state_at(i)) == generator.value(i));
+            }
+            GameState three_players = state;
+            three_players.player_count = 3;
+            CHECK(table.probe(three_players) == TablebaseResult::UNKNOWN);
+            CHECK(table.probe(corrupt) == TablebaseResult::UNKNOWN);
+        }
+        
+        // A table is only opened with the rules it was solved for
+        GameRules cheaper_coup;
+        cheaper_coup.coup_cost = 6;
+        CHECK(rules_hash(cheaper_coup) != rules_hash(GameRules::defaults()));
+        CHECK_THROWS_AS(Tablebase(path, cheaper_coup), std::runtime_error);
+        CHECK_NOTHROW(Tablebase(path, GameRules()));
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Canonical game states") {
+    auto make_state = [](int first_coins, int second_coins) {
+        GameState state{};
+        state.player_count = 3;
+        state.current_player = 1;
+        state.game_active = true;
+        state.treasury = 50;
+        for (int i = 0; i < 3; ++i) {
+            state.players[i].active = true;
+            state.players[i].last_arrested = -1;
+            state.players[i].role = static_cast<int8_t>(RoleType::BARON);
+        }
+        state.players[1].coins = 4;
+        state.players[0].coins = first_coins;
+        state.players[2].coins = second_coins;
+        return state;
+    };
+    
+    GameState a = make_state(3, 6);
+    GameState b = make_state(6, 3);
+    a.players[1].last_arrested = 2;      // Current player last arrested the 6-coin Baron
+    b.players[1].last_arrested = 0;
+    
+    CanonicalState ca = canonicalize(a);
+    CanonicalState cb = canonicalize(b);
+    CHECK(hash_state(ca.state) == hash_state(cb.state));
+    CHECK(hash_state(a) != hash_state(b));
+    
+    CHECK(ca.state.current_player == 0);
+    CHECK(ca.state.players[0].coins == 4);
+    CHECK(ca.state.players[1].coins == 3);
+    CHECK(ca.state.players[2].coins == 6);
+    CHECK(ca.state.players[0].last_arrested == 2);
+    
+    // The permutation maps canonical seats back to the original ones
+    CHECK(ca.original_seat[0] == 1);
+    CHECK(ca.original_seat[2] == 2);
+    CHECK(cb.original_seat[2] == 0);
+    for (int seat = 0; seat < 3; ++seat) {
+        CHECK(ca.original_seat[ca.canonical_seat[seat]] == seat);
+    }
+}
+
+TEST_CASE("Hidden information views") {
+    Game game;
+    auto spy = std::make_shared<Player>("Spy");
+    auto baron = std::make_shared<Player>("Baron");
+    auto judge = std::make_shared<Player>("Judge");
+    spy->set_role(std::make_shared<Spy>());
+    baron->set_role(std::make_shared<Baron>());
+    judge->set_role(std::make_shared<Judge>());
+    game.add_player(spy);
+    game.add_player(baron);
+    game.add_player(judge);
+    game.start_game();
+    
+    SUBCASE("Open game shows everything") {
+        PlayerView view(game, 0);
+        CHECK(view.role(1) == static_cast<int>(RoleType::BARON));
+        CHECK(view.coins(2) == 2);
+    }
+    
+    SUBCASE("Roles and coins hidden from opponents") {
+        game.set_hidden_information(true, true);
+        PlayerView spy_view(game, 0);
+        PlayerView baron_view(game, 1);
+        CHECK(spy_view.role(0) == static_cast<int>(RoleType::SPY));
+        CHECK(spy_view.role(1) == PlayerView::HIDDEN);
+        CHECK(spy_view.coins(1) == PlayerView::HIDDEN);
+        CHECK(baron_view.coins(1) == 2);
+        
+        // The Spy reveals one opponent's coins to itself only
+        auto spy_role = std::dynamic_pointer_cast<Spy>(spy->get_role());
+        CHECK(spy_role->see_coins(*spy, *baron, game) == 2);
+        CHECK(spy_view.coins(1) == 2);
+        CHECK(spy_view.coins(2) == PlayerView::HIDDEN);
+        CHECK(PlayerView(game, 2).coins(1) == PlayerView::HIDDEN);
+        
+        // Eliminated players' roles become public
+        game.eliminate_player(judge.get());
+        CHECK(baron_view.role(2) == static_cast<int>(RoleType::JUDGE));
+    }
+    
+    SUBCASE("Information set keys") {
+        game.set_hidden_information(true, true);
+        uint64_t before = PlayerView(game, 1).information_set_key();
+        CHECK(PlayerView(game, 0).information_set_key() != before);
+        
+        // Changing what an opponent cannot see leaves its key unchanged
+        judge->set_role(std::make_shared<Governor>());
+        spy->set_coins(5);
+        CHECK(PlayerView(game, 1).information_set_key() == before);
+        CHECK(PlayerView(game, 0).information_set_key() != PlayerView(game, 2).information_set_key());
+        
+        // Public actions and blocks change every key
+        spy->gather(game);
+        uint64_t after_gather = PlayerView(game, 1).information_set_key();
+        CHECK(after_gather != before);
+        game.block_last_action();
+        CHECK(PlayerView(game, 1).information_set_key() != after_gather);
+    }
+    
+    CHECK_THROWS(PlayerView(game, 3));
+}
+
+TEST_CASE("ISMCTS bot") {
+    Game game;
+    auto bot = std::make_shared<Player>("Bot");
+    auto general = std::make_shared<Player>("General");
+    auto judge = std::make_shared<Player>("Judge");
+    bot->set_role(std::make_shared<Baron>());
+    general->set_role(std::make_shared<General>());
+    judge->set_role(std::make_shared<Judge>());
+    game.add_player(bot);
+    game.add_player(general);
+    game.add_player(judge);
+    game.set_hidden_information(true, true);
+    game.start_game();
+    
+    SUBCASE("Determinizations follow the public history") {
+        // The General blocks a coup, so every sample makes it a General
+        bot->set_coins(7);
+        general->set_coins(6);
+        apply_move(game, Move(MoveType::COUP, 1));
+        CHECK(general->is_player_active());
+        CHECK(game.get_action_history().back().blocker == general.get());
+        
+        Determinizer determinizer(game, 0);
+        CHECK(determinizer.candidate_roles(0).empty());
+        CHECK(determinizer.candidate_roles(1).size() == 1);
+        CHECK(determinizer.candidate_roles(2).size() == 6);
+        
+        std::mt19937_64 rng(3);
+        bool judge_role_varies = false;
+        for (int i = 0; i < 50; ++i) {
+            GameState sample = determinizer.sample(rng);
+            CHECK(sample.players[0].role == static_cast<int8_t>(RoleType::BARON));
+            CHECK(sample.players[1].role == static_cast<int8_t>(RoleType::GENERAL));
+            CHECK(sample.players[1].coins == 0);  // Public estimate: 2 starting coins - 5 to block
+            judge_role_varies = judge_role_varies || sample.players[2].role != sample.players[1].role;
+        }
+        CHECK(judge_role_varies);
+    }
+    
+    SUBCASE("Search finds the winning coup") {
+        game.eliminate_player(judge.get());
+        bot->set_coins(7);
+        general->set_coins(0);                   // Too poor to block whatever its role is
+        IsmctsOptions options;
+        options.iterations = 300;
+        options.threads = 2;
+        IsmctsBot ismcts(options);
+        IsmctsReport report;
+        Move move = ismcts.choose_move(game, &report);
+        CHECK(move == Move(MoveType::COUP, 1));
+        CHECK(report.iterations == 600);
+        CHECK(report.iterations_per_second > 0);
+    }
+}
+
+// Full-rules policy with scripted answers
+class ScriptedPolicy : public FullPolicy {
+public:
+    int challenger = -1;                 // Seat that challenges every claim, -1 for nobody
+    int blocker = -1;                    // Seat that blocks whenever it may, -1 for nobody
+    
+    bool challenge(const FullRulesGame&, int seat, int, RoleType) override { return seat == challenger; }
+    bool block(const FullRulesGame&, int seat, const FullMove&, int, RoleType) override { return seat == blocker; }
+    int lose_influence(const FullRulesGame& game, int seat) override { return game.get_player(seat).lost & 1 ? 1 : 0; }
+    void exchange(const FullRulesGame&, int, RoleType*, int, int) override {}
+};
+
+TEST_CASE("Full ruleset") {
+    SUBCASE("Court deck") {
+        CourtDeck deck = CourtDeck::standard(3);
+        CHECK(deck.size() == 18);
+        deck.remove(RoleType::SPY);
+        CHECK(deck.count(RoleType::SPY) == 2);
+        std::mt19937_64 rng(5);
+        for (int i = 0; i < 17; ++i) {
+            deck.draw(rng);
+        }
+        CHECK(deck.size() == 0);
+        CHECK(deck.packed() == 0);
+        CHECK_THROWS(deck.draw(rng));
+        CHECK_THROWS(deck.remove(RoleType::JUDGE));
+    }
+    
+    std::mt19937_64 rng(11);
+    FullRulesGame game(GameRules::defaults(), 2, rng);
+    ScriptedPolicy policy;
+    CHECK(game.get_deck().size() == 14);
+    CHECK(game.get_player(0).influence() == 2);
+    
+    SUBCASE("Challenged claims") {
+        const FullPlayer& mover = game.get_player(0);
+        bool honest = mover.holds(RoleType::GOVERNOR);
+        policy.challenger = 1;
+        game.play(FullMove(FullAction::GOVERNOR_TAX), policy, rng);
+        if (honest) {
+            CHECK(game.get_player(0).coins == 5);
+            CHECK(game.get_player(1).influence() == 1);
+        } else {
+            CHECK(game.get_player(0).coins == 2);
+            CHECK(game.get_player(0).influence() == 1);
+        }
+        CHECK(game.get_deck().size() == 14);
+        CHECK(game.get_current_player_index() == 1);
+    }
+    
+    SUBCASE("Blocks and elimination") {
+        policy.blocker = 1;
+        game.play(FullMove(FullAction::TAX), policy, rng);   // Unchallenged Governor block
+        CHECK(game.get_player(0).coins == 2);
+        
+        // Unblocked coups take one influence card each
+        policy.blocker = -1;
+        std::vector<FullMove> moves;
+        int coups = 0;
+        while (!game.is_over()) {
+            game.legal_moves(moves);
+            FullMove move = moves[0];
+            bool can_coup = game.get_player(game.get_current_player_index()).coins >= 7;
+            if (can_coup) {
+                move = FullMove(FullAction::COUP, 1 - game.get_current_player_index());
+                coups++;
+            } else if (std::find(moves.begin(), moves.end(), FullMove(FullAction::GATHER)) == moves.end()) {
+                move = FullMove(FullAction::EXCHANGE);
+            } else {
+                move = FullMove(FullAction::GATHER);
+            }
+            game.play(move, policy, rng);
+        }
+        CHECK(coups >= 2);
+        CHECK(game.winner() >= 0);
+        CHECK(game.get_player(1 - game.winner()).influence() == 0);
+    }
+    
+    SUBCASE("Random full games finish") {
+        for (int i = 0; i < 50; ++i) {
+            SimulationResult result = simulate_full_game(GameRules::defaults(), 2 + i % 5, rng);
+            CHECK(result.winner >= 0);
+        }
+    }
+    
+    CHECK_THROWS(FullRulesGame(GameRules::defaults(), 6, rng, 1));
+}
+
+TEST_CASE("Reaction window") {
+    Game game;
+    auto judge = std::make_shared<Player>("Judge");
+    auto governor = std::make_shared<Player>("Governor");
+    auto spy = std::make_shared<Player>("Spy");
+    auto general = std::make_shared<Player>("General");
+    judge->set_role(std::make_shared<Judge>());
+    governor->set_role(std::make_shared<Governor>());
+    spy->set_role(std::make_shared<Spy>());
+    general->set_role(std::make_shared<General>());
+    game.add_player(judge);
+    game.add_player(governor);
+    game.add_player(spy);
+    game.add_player(general);
+    game.start_game();
+    
+    std::vector<std::string> asked;
+    auto decline = [&](Player& blocker, const ActionRecord&) { asked.push_back(blocker.get_name()); return false; };
+    auto accept = [&](Player& blocker, const ActionRecord&) { asked.push_back(blocker.get_name()); return true; };
+    
+    SUBCASE("Blocked tax is undone") {
+        judge->tax(game);
+        CHECK(judge->get_coins() == 4);
+        CHECK(game.eligible_blockers() == std::vector<Player*>{governor.get()});
+        CHECK(game.run_reaction_window(accept) == governor.get());
+        CHECK(judge->get_coins() == 2);
+        CHECK(game.get_action_history().back().was_blocked);
+        CHECK(game.get_action_history().back().blocker == governor.get());
+        CHECK(game.eligible_blockers().empty());
+    }
+    
+    SUBCASE("Only the target blocks an arrest") {
+        judge->arrest(*spy, game);
+        CHECK(spy->get_coins() == 1);
+        CHECK(game.can_block_last_action(spy.get()));
+        CHECK_FALSE(game.can_block_last_action(governor.get()));
+        game.run_reaction_window(accept);
+        CHECK(spy->get_coins() == 2);
+        CHECK(judge->get_coins() == 2);
+        CHECK(judge->get_last_arrested() == nullptr);
+    }
+    
+    SUBCASE("Blocked bribe stays paid") {
+        governor->add_coins(2);
+        game.next_turn();
+        governor->bribe(game);
+        CHECK(game.is_extra_turn_allowed());
+        CHECK(game.run_reaction_window(decline) == nullptr);
+        CHECK(asked == std::vector<std::string>{"Judge"});
+        
+        game.block_last_action();                    // Already blocked actions cannot be blocked again
+        CHECK(game.eligible_blockers().empty());
+    }
+    
+    SUBCASE("Judge cancels the extra turn") {
+        governor->add_coins(2);
+        game.next_turn();
+        governor->bribe(game);
+        game.run_reaction_window(accept);
+        CHECK_FALSE(game.is_extra_turn_allowed());
+        CHECK(governor->get_coins() == 0);
+    }
+    
+    SUBCASE("General pays to stop a coup") {
+        judge->add_coins(5);
+        general->add_coins(3);
+        apply_move(game, Move(MoveType::COUP, 3));
+        CHECK(general->is_player_active());
+        CHECK(general->get_coins() == 0);
+        CHECK(judge->get_coins() == 0);
+        
+        // Without the coins to pay, the General is not offered the block
+        governor->add_coins(5);
+        apply_move(game, Move(MoveType::COUP, 3));
+        CHECK_FALSE(general->is_player_active());
+    }
+    
+    SUBCASE("Blockers are asked in seat order after the actor") {
+        auto second_governor = std::make_shared<Player>("Governor2");
+        Game table;
+        second_governor->set_role(std::make_shared<Governor>());
+        table.add_player(governor);
+        table.add_player(judge);
+        table.add_player(second_governor);
+        table.start_game();
+        table.next_turn();
+        judge->tax(table);
+        CHECK(table.run_reaction_window(decline) == nullptr);
+        CHECK(asked == std::vector<std::string>{"Governor2", "Governor"});
+        CHECK(judge->get_coins() == 4);
+    }
+}
+
+TEST_CASE("Timer wheel") {
+    TimerWheel wheel(100);
+    std::vector<std::pair<uint64_t, uint64_t>> fired;  // (tick, payload)
+    auto record = [&](uint64_t payload) { fired.push_back(std::make_pair(wheel.now(), payload)); };
+    
+    // Deadlines on every level, scheduled out of order
+    std::vector<uint64_t> delays = {70000, 1, 300, 255, 256, 65536, 5};
+    for (uint64_t delay : delays) {
+        wheel.schedule(delay, delay);
+    }
+    TimerWheel::TimerId cancelled = wheel.schedule(10, 999);
+    CHECK(wheel.size() == 8);
+    CHECK(wheel.cancel(cancelled));
+    CHECK_FALSE(wheel.cancel(cancelled));
+    CHECK_FALSE(wheel.cancel(0));
+    
+    wheel.advance(100 + 300, record);
+    CHECK(fired.size() == 5);
+    wheel.advance(100 + 80000, record);
+    REQUIRE(fired.size() == 7);
+    std::sort(delays.begin(), delays.end());
+    for (size_t i = 0; i < delays.size(); ++i) {
+        CHECK(fired[i].second == delays[i]);
+        CHECK(fired[i].first == 100 + delays[i]);
+    }
+    CHECK(wheel.size() == 0);
+    
+    // Callbacks may schedule further timers; a reused slot gets a fresh id
+    int repeats = 0;
+    std::function<void(uint64_t)> again = [&](uint64_t) {
+        if (++repeats < 3) wheel.schedule(0, 0);
+    };
+    TimerWheel::TimerId first = wheel.schedule(0, 0);
+    wheel.advance(wheel.now() + 10, again);
+    CHECK(repeats == 3);
+    CHECK_FALSE(wheel.cancel(first));
+}
+
+TEST_CASE("Game host") {
+    HostOptions options;
+    options.tick_ms = 10;
+    options.turn_timeout_ms = 1000;
+    options.block_window_ms = 200;
+    GameHost host(options);
+    std::vector<HostEventType> events;
+    host.set_listener([&](const HostEvent& event) { events.push_back(event.type); });
+    
+    uint64_t id = host.create_game({RoleType::GOVERNOR, RoleType::GOVERNOR});
+    const Game& game = host.get_game(id);
+    
+    SUBCASE("Turn timeout gathers") {
+        host.advance(990);
+        CHECK(game.get_current_player_index() == 0);
+        host.advance(1000);
+        CHECK(game.get_player_at(0)->get_coins() == 3);
+        CHECK(game.get_current_player_index() == 1);
+        CHECK(host.get_stats().turn_timeouts == 1);
+        CHECK(events == std::vector<HostEventType>{HostEventType::AUTO_MOVE, HostEventType::MOVE_PLAYED});
+        CHECK(host.pending_timers() == 1);
+    }
+    
+    SUBCASE("Block window") {
+        host.submit_move(id, 0, Move(MoveType::TAX));
+        CHECK(host.is_reaction_open(id));
+        CHECK(game.get_player_at(0)->get_coins() == 5);
+        CHECK_THROWS_AS(host.submit_block(id, 0), std::invalid_argument);
+        CHECK_THROWS_AS(host.submit_move(id, 1, Move(MoveType::GATHER)), std::invalid_argument);
+        host.submit_block(id, 1);
+        CHECK(game.get_player_at(0)->get_coins() == 2);
+        CHECK(game.get_current_player_index() == 1);
+        
+        // An unanswered window lets the action stand
+        host.submit_move(id, 1, Move(MoveType::TAX));
+        host.advance(300);
+        CHECK_FALSE(host.is_reaction_open(id));
+        CHECK(game.get_player_at(1)->get_coins() == 5);
+        CHECK(host.get_stats().windows_expired == 1);
+        CHECK(host.pending_timers() == 1);
+    }
+    
+    SUBCASE("Many idle games play themselves out") {
+        for (int i = 0; i < 999; ++i) {
+            host.create_game({RoleType::BARON, RoleType::JUDGE});
+        }
+        bool finished = false;
+        for (uint64_t now = 0; now <= 1000 * 60 && !finished; now += 1000) {
+            host.advance(now);
+            finished = host.pending_timers() == 0;
+        }
+        CHECK(finished);
+        CHECK(std::count(events.begin(), events.end(), HostEventType::GAME_OVER) == 1000);
+        CHECK_FALSE(host.get_game(0).is_game_active());
+        host.remove_game(0);
+        CHECK_THROWS(host.get_game(0));
+    }
+    
+    CHECK_THROWS_AS(host.submit_move(99999, 0, Move(MoveType::GATHER)), std::invalid_argument);
+}
+
+TEST_CASE("Turn pipeline") {
+    std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::BARON, RoleType::MERCHANT};
+    auto make_game = [&roles](Game& game) {
+        for (size_t i = 0; i < roles.size(); ++i) {
+            auto player = std::make_shared<Player>("P" + std::to_string(i + 1));
+            player->set_role(make_role(roles[i]));
+            game.add_player(player);
+        }
+        game.start_game();
+    };
+    
+    SUBCASE("Bots play many games on several threads") {
+        const int GAMES = 200;
+        std::vector<std::unique_ptr<Game>> games;
+        std::vector<std::unique_ptr<BotInput>> bots;
+        TurnPipeline pipeline;
+        for (int g = 0; g < GAMES; ++g) {
+            games.emplace_back(new Game());
+            make_game(*games.back());
+            auto rng = std::make_shared<std::mt19937_64>(g);
+            bots.emplace_back(new BotInput([rng](const Game& game, int) {
+                std::vector<Move> moves = legal_moves(game);
+                return moves[(*rng)() % moves.size()];
+            }));
+            pipeline.add_game(*games.back(), std::vector<SeatInput*>(roles.size(), bots.back().get()));
+        }
+        CHECK(pipeline.run(4) == GAMES);
+        for (const auto& game : games) {
+            CHECK_FALSE(game->is_game_active());
+        }
+        CHECK(GameTask::frame_bytes() > 0);
+        CHECK(GameTask::frame_bytes() <= 512);
+    }
+    
+    SUBCASE("Queued input suspends the game until a move arrives") {
+        Game game;
+        make_game(game);
+        QueuedInput human;
+        BotInput bot([](const Game&, int) { return Move(MoveType::GATHER); });
+        TurnPipeline pipeline;
+        pipeline.add_game(game, {&human, &bot, &bot});
+        
+        CHECK(pipeline.run() == 0);
+        CHECK(human.is_waiting());
+        
+        // An illegal move is refused and the seat is asked again
+        human.push_move(Move(MoveType::COUP, 1));
+        pipeline.run();
+        CHECK(human.is_waiting());
+        CHECK(game.get_current_player_index() == 0);
+        
+        // Answers may come from another thread, as from a socket reader
+        std::thread reader([&human]() { human.push_move(Move(MoveType::TAX)); });
+        reader.join();
+        pipeline.run();
+        CHECK(game.get_player_at(0)->get_coins() == 5);
+        CHECK(game.get_player_at(1)->get_coins() == 3);
+        CHECK(game.get_current_player_index() == 0);
+        CHECK(human.is_waiting());
+        
+        human.push_quit();
+        CHECK(pipeline.run() == 1);
+        CHECK(game.is_game_active());
+    }
+
+    SUBCASE("A seat that keeps sending illegal moves is played for") {
+        Game game;
+        make_game(game);
+        int asked = 0;
+        BotInput broken([&asked](const Game&, int) {
+            asked++;
+            return Move(MoveType::COUP, 1);
+        });
+        QueuedInput other;
+        TurnPipeline pipeline;
+        pipeline.add_game(game, {&broken, &other, &other});
+
+        CHECK(pipeline.run() == 0);
+        CHECK(asked == InputRequest::MAX_REJECTED);
+        CHECK(game.get_action_history().back().action == ActionType::GATHER);
+        CHECK(game.get_player_at(0)->get_coins() == 3);
+        CHECK(game.get_current_player_index() == 1);
+        CHECK(other.is_waiting());
+        other.push_quit();
+        pipeline.run();
+    }
+    
+    SUBCASE("Blocks are asked of eligible players") {
+        roles = {RoleType::GOVERNOR, RoleType::GOVERNOR};
+        Game game;
+        make_game(game);
+        QueuedInput first;
+        QueuedInput second;
+        TurnPipeline pipeline;
+        pipeline.add_game(game, {&first, &second});
+        pipeline.run();
+        
+        first.push_move(Move(MoveType::TAX));
+        pipeline.run();
+        CHECK(second.is_waiting());
+        CHECK(game.get_player_at(0)->get_coins() == 5);
+        second.push_block(true);
+        pipeline.run();
+        CHECK(game.get_player_at(0)->get_coins() == 2);
+        CHECK(game.get_action_history().back().blocker == game.get_player_at(1));
+        CHECK(game.get_current_player_index() == 1);
+    }
+    
+    SUBCASE("Replayed moves reproduce a game") {
+        Game original;
+        make_game(original);
+        std::vector<Move> played;
+        std::mt19937_64 rng(7);
+        while (original.is_game_active()) {
+            std::vector<Move> moves = legal_moves(original);
+            if (moves.empty()) {
+                original.next_turn();
+                continue;
+            }
+            played.push_back(moves[rng() % moves.size()]);
+            apply_move(original, played.back());
+        }
+        
+        std::string path = (std::filesystem::temp_directory_path() / "coup_pipeline_moves.txt").string();
+        {
+            std::ofstream out(path);
+            const char* names[] = {"gather", "tax", "bribe", "arrest", "sanction", "coup", "invest"};
+            out << "# recorded game\n";
+            for (const Move& move : played) {
+                out << names[static_cast<int>(move.type)] << " " << move.target << "\n";
+            }
+        }
+        ReplayInput replay(read_move_file(path));
+        std::filesystem::remove(path);
+        
+        Game copy;
+        make_game(copy);
+        TurnPipeline pipeline;
+        pipeline.add_game(copy, std::vector<SeatInput*>(roles.size(), &replay));
+        CHECK(pipeline.run() == 1);
+        CHECK(hash_state(copy.capture_state()) == hash_state(original.capture_state()));
+        CHECK(copy.winner() == original.winner());
+        CHECK_THROWS_AS(read_move_file(path), std::runtime_error);
+    }
+    
+    Game game;
+    make_game(game);
+    BotInput bot([](const Game&, int) { return Move(MoveType::GATHER); });
+    TurnPipeline pipeline;
+    CHECK_THROWS_AS(pipeline.add_game(game, {&bot}), std::invalid_argument);
+    CHECK_THROWS_AS(pipeline.add_game(game, {&bot, nullptr, &bot}), std::invalid_argument);
+}
+
+TEST_CASE("Spectator delta frames") {
+    Game game;
+    std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::BARON, RoleType::SPY, RoleType::JUDGE};
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("P" + std::to_string(i + 1));
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.start_game();
+    
+    SpectatorFeed feed(game);
+    const int VIEWERS = 50;
+    std::vector<GameState> views(VIEWERS);
+    std::vector<StateFrame> received;
+    for (int v = 0; v < VIEWERS; ++v) {
+        feed.subscribe([&views, &received, v](const StateFrame& frame) {
+            apply_state_frame(views[v], frame->data(), frame->size());
+            received.push_back(frame);
+        });
+    }
+    // Everyone who joined before the first publish shares one keyframe
+    CHECK(feed.get_frames_encoded() == 1);
+    CHECK(received.front() == received.back());
+    CHECK_FALSE(feed.publish());
+    
+    std::mt19937_64 rng(11);
+    uint64_t frames = 1;
+    size_t largest_delta = 0;
+    while (game.is_game_active()) {
+        std::vector<Move> moves = legal_moves(game);
+        if (moves.empty()) {
+            game.next_turn();
+        } else {
+            apply_move(game, moves[rng() % moves.size()]);
+        }
+        received.clear();
+        CHECK(feed.publish());
+        frames++;
+        CHECK(received.size() == VIEWERS);
+        CHECK(received.front().get() == received.back().get());
+        largest_delta = std::max(largest_delta, received.front()->size());
+        bool views_match = true;
+        for (const GameState& view : views) {
+            views_match = views_match && hash_state(view) == hash_state(game.capture_state());
+        }
+        CHECK(views_match);
+    }
+    CHECK(feed.get_frames_encoded() == frames);
+    CHECK(largest_delta < sizeof(GameState));
+    
+    // A late joiner starts from a keyframe of the current state
+    GameState late{};
+    uint64_t id = feed.subscribe([&late](const StateFrame& frame) { apply_state_frame(late, frame->data(), frame->size()); });
+    CHECK(hash_state(late) == hash_state(game.capture_state()));
+    CHECK(feed.unsubscribe(id));
+    CHECK_FALSE(feed.unsubscribe(id));
+    CHECK(feed.subscriber_count() == VIEWERS);
+    
+    SUBCASE("Gather delta is a few bytes") {
+        Game small;
+        small.add_player(std::make_shared<Player>("A"));
+        small.add_player(std::make_shared<Player>("B"));
+        small.start_game();
+        GameState before = small.capture_state();
+        apply_move(small, Move(MoveType::GATHER));
+        std::vector<uint8_t> frame;
+        encode_state_frame(&before, small.capture_state(), 7, frame);
+        CHECK(frame.size() <= 12);
+        GameState view = before;
+        CHECK(apply_state_frame(view, frame.data(), frame.size()) == 7);
+        CHECK(hash_state(view) == hash_state(small.capture_state()));
+        
+        // Malformed frames are rejected and leave the view untouched
+        CHECK_THROWS_AS(apply_state_frame(view, frame.data(), frame.size() - 1), std::runtime_error);
+        frame.push_back(0);
+        CHECK_THROWS_AS(apply_state_frame(view, frame.data(), frame.size()), std::runtime_error);
+        frame[0] = 9;
+        CHECK_THROWS_AS(apply_state_frame(view, frame.data(), frame.size()), std::runtime_error);
+        CHECK(hash_state(view) == hash_state(small.capture_state()));
+    }
+    
+    SUBCASE("Hosted games stream to spectators") {
+        GameHost host;
+        uint64_t hosted = host.create_game({RoleType::GOVERNOR, RoleType::GOVERNOR});
+        GameState view{};
+        int count = 0;
+        uint64_t watcher = host.watch(hosted, [&](const StateFrame& frame) {
+            apply_state_frame(view, frame->data(), frame->size());
+            count++;
+        });
+        host.submit_move(hosted, 0, Move(MoveType::TAX));
+        CHECK(view.players[0].coins == 5);
+        host.submit_block(hosted, 1);
+        CHECK(view.players[0].coins == 2);
+        CHECK(view.current_player == 1);
+        CHECK(count == 3);
+        CHECK(host.unwatch(hosted, watcher));
+        host.submit_move(hosted, 1, Move(MoveType::GATHER));
+        CHECK(count == 3);
+    }
+}
+
+TEST_CASE("Seqlock snapshots") {
+    SnapshotPublisher publisher;
+    CHECK(publisher.version() == 0);
+    CHECK(publisher.read().player_count == 0);
+    
+    SUBCASE("Readers never see a torn state") {
+        // Every published state has all its counters equal, so a mix of two publishes shows
+        const int PUBLISHES = 100000;
+        std::atomic<bool> done(false);
+        std::atomic<int> torn(0);
+        std::atomic<uint64_t> reads(0);
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; ++r) {
+            readers.emplace_back([&]() {
+                while (!done.load()) {
+                    GameState state = publisher.read();
+                    for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+                        if (state.players[seat].coins != state.treasury) {
+                            torn++;
+                        }
+                    }
+                    reads++;
+                }
+            });
+        }
+        GameState state{};
+        state.player_count = MAX_PLAYERS;
+        for (int i = 1; i <= PUBLISHES; ++i) {
+            state.treasury = i;
+            for (int seat = 0; seat < MAX_PLAYERS; ++seat) {
+                state.players[seat].coins = i;
+            }
+            publisher.publish(state);
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        CHECK(torn == 0);
+        CHECK(reads > 0);
+        CHECK(publisher.version() == PUBLISHES);
+        CHECK(publisher.read().treasury == PUBLISHES);
+    }
+    
+    SUBCASE("Hosted games publish after every change") {
+        GameHost host;
+        uint64_t id = host.create_game({RoleType::GOVERNOR, RoleType::BARON});
+        std::shared_ptr<const SnapshotPublisher> snapshot = host.get_snapshot(id);
+        CHECK(snapshot->version() == 1);
+        host.submit_move(id, 0, Move(MoveType::GATHER));
+        GameState state;
+        CHECK(snapshot->try_read(state));
+        CHECK(state.players[0].coins == 3);
+        CHECK(state.current_player == 1);
+        CHECK(hash_state(state) == hash_state(host.get_game(id).capture_state()));
+
+        // A reader keeps the publisher alive after the game leaves the host, even when its
+        // id is reused
+        uint64_t last = hash_state(host.get_game(id).capture_state());
+        host.detach_game(id);
+        CHECK(host.create_game({RoleType::JUDGE, RoleType::SPY}) == id);
+        CHECK(snapshot->version() == 2);
+        CHECK(hash_state(snapshot->read()) == last);
+        CHECK(host.get_snapshot(id) != snapshot);
+        host.remove_game(id);
+        CHECK(hash_state(snapshot->read()) == last);
+    }
+}
+
+TEST_CASE("Journal and crash recovery") {
+    std::string directory = (std::filesystem::temp_directory_path() / "coup_journal_test").string();
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    
+    SUBCASE("Group commit and torn tails") {
+        std::string path = directory + "/records";
+        JournalOptions options;
+        options.commit_interval_us = 50000;
+        {
+            Journal journal(path, options);
+            for (uint32_t i = 0; i < 1000; ++i) {
+                std::vector<uint8_t> payload(i % 7, static_cast<uint8_t>(i));
+                journal.append(static_cast<uint8_t>(i % 5), payload);
+            }
+            journal.sync();
+            CHECK(journal.get_appended() == 1000);
+            CHECK(journal.get_sync_count() < 10);
+        }
+        {
+            std::ofstream torn(path, std::ios::binary | std::ios::app);
+            torn.write("\x05\x00\x00\x00\x02" "ab", 7);
+        }
+        uint32_t next = 0;
+        bool in_order = true;
+        uint64_t intact = 0;
+        uint64_t records = Journal::read(path, [&](uint8_t type, const uint8_t* payload, size_t size) {
+            in_order = in_order && type == next % 5 && size == next % 7 && (size == 0 || payload[0] == (uint8_t)next);
+            next++;
+        }, &intact);
+        CHECK(records == 1000);
+        CHECK(in_order);
+        CHECK(intact + 7 == std::filesystem::file_size(path));
+        CHECK(Journal::read(directory + "/missing", [](uint8_t, const uint8_t*, size_t) {}) == 0);
+    }
+    
+    SUBCASE("Records wait for the work before the first commit") {
+        std::string path = directory + "/after";
+        JournalOptions options;
+        options.commit_interval_us = 100;
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        {
+            Journal journal(path, options, [released]() { released.wait(); });
+            journal.append(1, std::vector<uint8_t>(3, 1));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            CHECK(std::filesystem::file_size(path) == 0);
+            release.set_value();
+            journal.sync();
+            CHECK(std::filesystem::file_size(path) > 0);
+        }
+        
+        // Work that fails stops the journal
+        Journal failed(directory + "/failed", options, []() { throw std::runtime_error("no space"); });
+        CHECK_THROWS_AS(failed.sync(), std::runtime_error);
+        CHECK_THROWS_AS(failed.append(1, std::vector<uint8_t>(1, 0)), std::runtime_error);
+    }
+    
+    SUBCASE("Hosted games survive a restart") {
+        JournalOptions options;
+        options.snapshot_every = 0;
+        std::vector<GameState> states;
+        std::vector<bool> reaction_open;
+        std::vector<uint64_t> histories;
+        {
+            GameHost host;
+            CHECK(host.open_journal(directory, options) == 0);
+            uint64_t a = host.create_game({RoleType::GOVERNOR, RoleType::GOVERNOR});
+            uint64_t b = host.create_game({RoleType::BARON, RoleType::SPY, RoleType::MERCHANT});
+            uint64_t c = host.create_game({RoleType::JUDGE, RoleType::GENERAL});
+            host.submit_move(a, 0, Move(MoveType::TAX));
+            host.submit_block(a, 1);
+            host.submit_move(b, 0, Move(MoveType::ARREST, 2));
+            host.advance(6000);                      // b's block window expires
+            host.remove_game(c);
+            
+            // Checkpoint while a reaction window is open, then keep playing
+            host.submit_move(a, 1, Move(MoveType::TAX));
+            host.checkpoint();
+            host.submit_move(b, 1, Move(MoveType::GATHER));
+            host.advance(40000);                     // a's window and b's turn time out
+            uint64_t d = host.create_game({RoleType::JUDGE, RoleType::GOVERNOR});
+            CHECK(d == c);
+            host.submit_move(d, 0, Move(MoveType::TAX));
+            host.sync_journal();
+            
+            for (uint64_t id : {a, b, d}) {
+                states.push_back(host.get_game(id).capture_state());
+                reaction_open.push_back(host.is_reaction_open(id));
+                histories.push_back(host.get_game(id).get_public_history_hash());
+            }
+        }
+        
+        GameHost recovered;
+        CHECK(recovered.open_journal(directory, options) == 3);
+        for (uint64_t id = 0; id < 3; ++id) {
+            CHECK(hash_state(recovered.get_game(id).capture_state()) == hash_state(states[id]));
+            CHECK(recovered.is_reaction_open(id) == reaction_open[id]);
+            // History from before the checkpoint comes back with the save
+            CHECK(recovered.get_game(id).get_public_history_hash() == histories[id]);
+        }
+        CHECK(recovered.get_game(0).get_action_history().size() == 2);
+        CHECK(recovered.get_game(0).get_player_stats(1).blocks == 1);
+        CHECK(reaction_open[2]);
+        
+        // The recovered host keeps journaling, checkpoints included
+        recovered.submit_block(2, 1);
+        recovered.checkpoint();
+        recovered.checkpoint();                      // Finishes after the first one, in order
+        recovered.submit_move(0, recovered.get_game(0).get_current_player_index(), Move(MoveType::GATHER));
+        GameState expected = recovered.get_game(0).capture_state();
+        GameState blocked = recovered.get_game(2).capture_state();
+        recovered.sync_journal();
+        
+        GameHost again;
+        CHECK(again.open_journal(directory, options) == 3);
+        CHECK(hash_state(again.get_game(0).capture_state()) == hash_state(expected));
+        CHECK(hash_state(again.get_game(2).capture_state()) == hash_state(blocked));
+        CHECK(again.create_game({RoleType::SPY, RoleType::SPY}) == 3);
+        CHECK_THROWS(again.open_journal(directory, options));
+    }
+    
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Binary game save and load") {
+    Game game;
+    std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::SPY, RoleType::GENERAL, RoleType::BARON};
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("Player " + std::to_string(i + 1));
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.set_hidden_information(true, true);
+    game.start_game();
+    game.reveal_coins(game.get_player_at(1), game.get_player_at(3));
+    
+    std::mt19937_64 rng(5);
+    for (int turn = 0; turn < 12 && game.is_game_active(); ++turn) {
+        std::vector<Move> moves = legal_moves(game);
+        apply_move(game, moves[rng() % moves.size()], [](Player&, const ActionRecord&) { return true; });
+    }
+    // Leave a blockable tax pending so the undo point is part of the save
+    play_action(game, Move(MoveType::TAX));
+    
+    std::vector<uint8_t> save;
+    game.save(save);
+    Game copy;
+    copy.load(save.data(), save.size());
+    
+    CHECK(hash_state(copy.capture_state()) == hash_state(game.capture_state()));
+    CHECK(copy.players_names() == game.players_names());
+    CHECK(copy.get_public_history_hash() == game.get_public_history_hash());
+    CHECK(copy.get_action_history().size() == game.get_action_history().size());
+    for (size_t i = 0; i < game.get_action_history().size(); ++i) {
+        const ActionRecord& a = game.get_action_history()[i];
+        const ActionRecord& b = copy.get_action_history()[i];
+        CHECK(a.action == b.action);
+        CHECK(seat_of(game, a.actor) == seat_of(copy, b.actor));
+        CHECK(seat_of(game, a.target) == seat_of(copy, b.target));
+        CHECK(seat_of(game, a.blocker) == seat_of(copy, b.blocker));
+        CHECK(a.was_blocked == b.was_blocked);
+    }
+    CHECK(copy.are_roles_hidden());
+    CHECK(copy.are_coins_revealed(1, 3));
+    CHECK_FALSE(copy.are_coins_revealed(3, 1));
+    CHECK(copy.get_rules().coup_cost == game.get_rules().coup_cost);
+    CHECK(copy.get_player_at(0) != game.get_player_at(0));
+    
+    // Both continue identically, including undoing the pending tax
+    CHECK(copy.eligible_blocker_mask() == game.eligible_blocker_mask());
+    copy.run_reaction_window([](Player&, const ActionRecord&) { return true; });
+    game.run_reaction_window([](Player&, const ActionRecord&) { return true; });
+    complete_move(copy, Move(MoveType::TAX));
+    complete_move(game, Move(MoveType::TAX));
+    CHECK(hash_state(copy.capture_state()) == hash_state(game.capture_state()));
+    CHECK(copy.get_public_history_hash() == game.get_public_history_hash());
+    
+    // Corrupt saves are rejected without changing the game
+    GameState before = copy.capture_state();
+    CHECK_THROWS_AS(copy.load(save.data(), save.size() - 1), std::runtime_error);
+    std::vector<uint8_t> bad = save;
+    bad[0] ^= 1;
+    CHECK_THROWS_AS(copy.load(bad.data(), bad.size()), std::runtime_error);
+    bad = save;
+    bad.push_back(0);
+    CHECK_THROWS_AS(copy.load(bad.data(), bad.size()), std::runtime_error);
+    // The undo point a later block restores is checked like the state
+    size_t undo_seats = sizeof(uint32_t) + sizeof(GameRules) + sizeof(GameState) + offsetof(GameState, players);
+    bad = save;
+    bad[undo_seats + offsetof(PlayerState, last_arrested)] = 6;
+    CHECK_THROWS_AS(copy.load(bad.data(), bad.size()), std::runtime_error);
+    bad = save;
+    bad[undo_seats + sizeof(PlayerState) + offsetof(PlayerState, role)] = 9;
+    CHECK_THROWS_AS(copy.load(bad.data(), bad.size()), std::runtime_error);
+    CHECK(hash_state(copy.capture_state()) == hash_state(before));
+    
+    SUBCASE("Games migrate between hosts") {
+        std::string directory = (std::filesystem::temp_directory_path() / "coup_migrate_test").string();
+        std::filesystem::remove_all(directory);
+        GameHost source;
+        uint64_t id = source.create_game({RoleType::GOVERNOR, RoleType::GOVERNOR});
+        source.submit_move(id, 0, Move(MoveType::TAX));
+        CHECK_THROWS_AS(source.detach_game(id), std::invalid_argument);
+        source.submit_block(id, 1);
+        GameState moved = source.get_game(id).capture_state();
+        std::vector<uint8_t> migrated = source.detach_game(id);
+        CHECK_THROWS(source.get_game(id));
+        
+        {
+            GameHost target;
+            target.open_journal(directory);
+            target.create_game({RoleType::SPY, RoleType::JUDGE});
+            uint64_t adopted = target.adopt_game(migrated);
+            CHECK(adopted == 1);
+            CHECK(hash_state(target.get_game(adopted).capture_state()) == hash_state(moved));
+            CHECK(target.get_game(adopted).get_action_history().back().was_blocked);
+            target.submit_move(adopted, 1, Move(MoveType::GATHER));
+            moved = target.get_game(adopted).capture_state();
+            target.sync_journal();
+        }
+        std::vector<uint8_t> named;
+        game.save(named);
+        uint64_t renamed = 0;
+        {
+            GameHost recovered;
+            CHECK(recovered.open_journal(directory) == 2);
+            CHECK(hash_state(recovered.get_game(1).capture_state()) == hash_state(moved));
+            
+            // Adopted games keep who they are through a checkpoint, not just their state
+            renamed = recovered.adopt_game(named);
+            recovered.checkpoint();
+        }
+        GameHost reopened;
+        CHECK(reopened.open_journal(directory) == 3);
+        const Game& restored = reopened.get_game(renamed);
+        CHECK(restored.players_names() == game.players_names());
+        CHECK(restored.get_action_history().size() == game.get_action_history().size());
+        CHECK(restored.get_public_history_hash() == game.get_public_history_hash());
+        CHECK(restored.are_roles_hidden());
+        CHECK(restored.are_coins_revealed(1, 3));
+        CHECK(reopened.get_game(1).get_action_history().size() == 2);
+        std::filesystem::remove_all(directory);
+    }
+}
+
+TEST_CASE("Keyframe timeline") {
+    HostOptions options;
+    options.keyframe_interval = 4;
+    GameHost host(options);
+    uint64_t id = host.create_game({RoleType::GOVERNOR, RoleType::GENERAL, RoleType::JUDGE, RoleType::BARON});
+    
+    // Play through the host, blocking some windows and letting others expire
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> states = {hash_state(host.get_game(id).capture_state())};
+    std::vector<uint64_t> histories = {host.get_game(id).get_public_history_hash()};
+    uint64_t now = 0;
+    while (host.get_game(id).is_game_active() && states.size() < 60) {
+        const Game& game = host.get_game(id);
+        std::vector<Move> moves = legal_moves(game);
+        if (moves.empty()) {
+            now += options.turn_timeout_ms;
+            host.advance(now);
+        } else {
+            host.submit_move(id, game.get_current_player_index(), moves[rng() % moves.size()]);
+        }
+        if (host.is_reaction_open(id)) {
+            std::vector<Player*> blockers = game.eligible_blockers();
+            if (rng() % 2 == 0) {
+                host.submit_block(id, seat_of(game, blockers[0]));
+            } else {
+                now += options.block_window_ms;
+                host.advance(now);
+            }
+        }
+        states.push_back(hash_state(game.capture_state()));
+        histories.push_back(game.get_public_history_hash());
+    }
+    REQUIRE(host.get_turn_count(id) == states.size() - 1);
+    
+    bool matches = true;
+    Game past;
+    for (size_t turn = 0; turn < states.size(); ++turn) {
+        host.game_at_turn(id, turn, past);
+        matches = matches && hash_state(past.capture_state()) == states[turn] &&
+                  past.get_public_history_hash() == histories[turn];
+    }
+    CHECK(matches);
+    CHECK_THROWS_AS(host.game_at_turn(id, states.size(), past), std::out_of_range);
+    CHECK_THROWS_AS(GameHost().game_at_turn(GameHost().create_game({RoleType::SPY, RoleType::SPY}), 0, past),
+                    std::invalid_argument);
+    
+    // A shorter interval keeps more keyframes
+    Game start;
+    start.add_player(std::make_shared<Player>("A"));
+    start.add_player(std::make_shared<Player>("B"));
+    start.start_game();
+    GameTimeline dense(start, 1);
+    GameTimeline sparse(start, 8);
+    for (int turn = 0; turn < 8; ++turn) {
+        play_action(start, Move(MoveType::GATHER));
+        complete_move(start, Move(MoveType::GATHER));
+        dense.record(start, Move(MoveType::GATHER));
+        sparse.record(start, Move(MoveType::GATHER));
+    }
+    CHECK(dense.keyframe_count() == 9);
+    CHECK(sparse.keyframe_count() == 2);
+    
+    // Keyframes do not grow with the history, so timeline memory stays linear in turns
+    std::vector<uint8_t> one_record;
+    start.save(one_record, 1);
+    CHECK(dense.memory_bytes() <= 9 * one_record.size() + 8 * sizeof(RecordedTurn));
+    Game late;
+    dense.materialize(8, late);
+    CHECK(late.get_action_history().size() == 8);
+    CHECK(late.get_action_history().retained() == 1);
+    CHECK(late.get_public_history_hash() == start.get_public_history_hash());
+    CHECK(dense.memory_bytes() > sparse.memory_bytes());
+    sparse.materialize(5, past);
+    CHECK(past.get_player_at(0)->get_coins() == start.get_player_at(0)->get_coins() - 1);
+    CHECK_THROWS_AS(GameTimeline(start, 0), std::invalid_argument);
+}
+
+TEST_CASE("Bounded action history") {
+    std::string spill = (std::filesystem::temp_directory_path() / "coup_history_spill_test").string();
+    std::remove(spill.c_str());
+    std::vector<RoleType> roles = {RoleType::GOVERNOR, RoleType::JUDGE, RoleType::GENERAL};
+    Game bounded;
+    Game full;
+    for (Game* game : {&bounded, &full}) {
+        for (size_t i = 0; i < roles.size(); ++i) {
+            auto player = std::make_shared<Player>("Player " + std::to_string(i + 1));
+            player->set_role(make_role(roles[i]));
+            game->add_player(player);
+        }
+        game->start_game();
+    }
+    bounded.set_history_limit(4, spill);
+    
+    // The same moves and blocks in both games
+    std::mt19937_64 rng(3);
+    for (int turn = 0; turn < 40 && full.is_game_active(); ++turn) {
+        std::vector<Move> moves = legal_moves(full);
+        Move move = moves[rng() % moves.size()];
+        bool block = rng() % 2 == 0;
+        auto decide = [block](Player&, const ActionRecord&) { return block; };
+        apply_move(full, move, decide);
+        apply_move(bounded, move, decide);
+    }
+    const ActionHistory& kept = bounded.get_action_history();
+    REQUIRE(kept.size() == full.get_action_history().size());
+    REQUIRE(kept.size() > 4);
+    CHECK(kept.first_index() == kept.size() - 4);
+    CHECK(hash_state(bounded.capture_state()) == hash_state(full.capture_state()));
+    CHECK(bounded.get_public_history_hash() == full.get_public_history_hash());
+    
+    // Spilled records followed by the ring are the whole history
+    bounded.set_history_limit(4);
+    std::vector<SpilledRecord> spilled = read_history_spill(spill);
+    REQUIRE(spilled.size() == kept.first_index());
+    bool same = true;
+    for (size_t i = 0; i < kept.size(); ++i) {
+        const ActionRecord& record = full.get_action_history()[i];
+        if (i < spilled.size()) {
+            same = same && spilled[i].action == record.action && spilled[i].actor == seat_of(full, record.actor) &&
+                   spilled[i].target == seat_of(full, record.target) && spilled[i].was_blocked == record.was_blocked &&
+                   spilled[i].blocker == seat_of(full, record.blocker);
+        } else {
+            same = same && kept[i].action == record.action && kept[i].was_blocked == record.was_blocked &&
+                   seat_of(bounded, kept[i].actor) == seat_of(full, record.actor);
+        }
+    }
+    CHECK(same);
+    size_t count = 0;
+    for (const ActionRecord& record : kept) {
+        (void)record;
+        count++;
+    }
+    CHECK(count == 4);
+    
+    // Shrinking keeps the newest records; a save carries only those
+    bounded.set_history_limit(2);
+    CHECK(kept.back().action == full.get_action_history().back().action);
+    std::vector<uint8_t> save;
+    bounded.save(save);
+    Game copy;
+    copy.load(save.data(), save.size());
+    CHECK(copy.get_action_history().retained() == 2);
+    CHECK(copy.get_action_history().size() == kept.size());
+    std::remove(spill.c_str());
+}
+
+TEST_CASE("Packed action records") {
+    CHECK(sizeof(PackedAction) == 4);
+    PackedAction packed = PackedAction::make(ActionType::ARREST, 5, -1, 70000);
+    CHECK(packed.action() == ActionType::ARREST);
+    CHECK(packed.actor() == 5);
+    CHECK(packed.target() == -1);
+    CHECK(packed.turn() == 70000 % 65536);
+    CHECK_FALSE(packed.blocked());
+    packed.set_blocked(2);
+    CHECK(packed.blocked());
+    CHECK(packed.blocker() == 2);
+    CHECK(packed.actor() == 5);
+    CHECK(packed.is_valid(6));
+    CHECK_FALSE(packed.is_valid(5));
+    
+    Game game;
+    std::vector<RoleType> roles = {RoleType::SPY, RoleType::GOVERNOR, RoleType::JUDGE};
+    for (size_t i = 0; i < roles.size(); ++i) {
+        auto player = std::make_shared<Player>("Player " + std::to_string(i + 1));
+        player->set_role(make_role(roles[i]));
+        game.add_player(player);
+    }
+    game.start_game();
+    const ActionHistory& history = game.get_action_history();
+    CHECK(history.last_action_index(0, ActionType::ARREST) == -1);
+    CHECK(history.last_target(0, ActionType::ARREST) == -1);
+    
+    apply_move(game, Move(MoveType::ARREST, 1), block_coups_only);
+    apply_move(game, Move(MoveType::GATHER), block_coups_only);
+    apply_move(game, Move(MoveType::TAX), [](Player&, const ActionRecord&) { return true; });
+    apply_move(game, Move(MoveType::ARREST, 2), block_coups_only);
+    CHECK(history.last_action_index(0, ActionType::ARREST) == 3);
+    CHECK(history.last_target(0, ActionType::ARREST) == 2);
+    CHECK(history.last_target(1, ActionType::GATHER) == -1);
+    CHECK(history.last_action_index(1, ActionType::GATHER) == 1);
+    
+    // Decoded records carry players, the block and the turn
+    ActionRecord tax = history[2];
+    CHECK(tax.actor == game.get_player_at(2));
+    CHECK(tax.was_blocked);
+    CHECK(tax.blocker == game.get_player_at(1));
+    CHECK(tax.turn == 2);
+    CHECK(history.packed(2).blocker() == 1);
+    
+    // The index survives a bounded ring and a save
+    game.set_history_limit(1);
+    CHECK(history.last_target(0, ActionType::ARREST) == 2);
+    CHECK(history.last_target(1, ActionType::GATHER) == -1);
+    std::vector<uint8_t> save;
+    game.save(save);
+    Game copy;
+    copy.load(save.data(), save.size());
+    CHECK(copy.get_action_history().last_action_index(0, ActionType::ARREST) == 3);
+    CHECK(copy.get_turn_number() == game.get_turn_number());
+}
+
+TEST_CASE("Game archive and column queries") {
+    std::string path = (std::filesystem::temp_directory_path() / "coup_archive_test.cga").string();
+    GameRules rules = GameRules::defaults();
+    std::mt19937_64 rng(21);
+    std::vector<ArchivedGame> played;
+    {
+        ArchiveWriter writer(path, rules, 64);
+        for (int g = 0; g < 300; ++g) {
+            std::vector<RoleType> roles;
+            int players = 2 + g % 4;
+            for (int seat = 0; seat < players; ++seat) {
+                roles.push_back(static_cast<RoleType>(rng() % 6));
+            }
+            played.push_back(play_archived_game(rules, roles, rng, 200));
+            writer.add(played.back());
+        }
+        writer.close();
+    }
+    
+    ArchiveReader reader(path);
+    CHECK(reader.game_count() == 300);
+    CHECK(reader.block_count() == 5);
+    std::vector<ArchivedGame> block;
+    reader.read_block(1, block);
+    REQUIRE(block.size() == 64);
+    const ArchivedGame& a = block[7];
+    const ArchivedGame& b = played[71];
+    CHECK(a.player_count == b.player_count);
+    CHECK(a.winner == b.winner);
+    CHECK(a.turns == b.turns);
+    CHECK(std::equal(a.roles, a.roles + MAX_PLAYERS, b.roles));
+    CHECK(std::equal(a.final_coins, a.final_coins + MAX_PLAYERS, b.final_coins));
+    CHECK(std::equal(a.action_counts, a.action_counts + ACTION_TYPE_COUNT, b.action_counts));
+    REQUIRE(a.replay.size() == b.replay.size());
+    CHECK(std::memcmp(a.replay.data(), b.replay.data(), a.replay.size() * sizeof(RecordedTurn)) == 0);
+    
+    // A replay plays back to the same game
+    Game game(reader.get_rules());
+    for (int seat = 0; seat < a.player_count; ++seat) {
+        auto player = std::make_shared<Player>("P" + std::to_string(seat + 1), rules.starting_coins);
+        player->set_role(make_role(static_cast<RoleType>(a.roles[seat])));
+        game.add_player(player);
+    }
+    game.start_game();
+    for (const RecordedTurn& turn : a.replay) {
+        replay_turn(game, turn);
+    }
+    ArchivedGame summary;
+    summarize_game(game, static_cast<int>(a.replay.size()), summary);
+    CHECK(summary.winner == a.winner);
+    CHECK(std::equal(summary.final_coins, summary.final_coins + MAX_PLAYERS, a.final_coins));
+    
+    // Column scans agree with a plain loop over the rows
+    GameColumns columns;
+    reader.load_columns(columns);
+    CHECK(columns.size() == 300);
+    GameFilter filter;
+    filter.with_role = static_cast<int8_t>(RoleType::BARON);
+    filter.min_turns = 20;
+    uint64_t expected_count = 0;
+    uint64_t expected_turns = 0;
+    RoleStats expected;
+    for (const ArchivedGame& row : played) {
+        bool baron = std::find(row.roles, row.roles + MAX_PLAYERS, static_cast<int8_t>(RoleType::BARON)) !=
+                     row.roles + MAX_PLAYERS;
+        if (!baron || row.turns < 20) {
+            continue;
+        }
+        expected_count++;
+        expected_turns += row.turns;
+        for (int seat = 0; seat < row.player_count; ++seat) {
+            if (row.roles[seat] == static_cast<int8_t>(RoleType::BARON) && row.first_sanctioned[seat] < 10) {
+                expected.seats++;
+                expected.wins += row.winner == seat;
+            }
+        }
+    }
+    CHECK(columns.count(filter) == expected_count);
+    CHECK(columns.mean_turns(filter) == doctest::Approx(static_cast<double>(expected_turns) / expected_count));
+    RoleStats stats = columns.role_stats(RoleType::BARON, filter, 10);
+    CHECK(stats.seats == expected.seats);
+    CHECK(stats.wins == expected.wins);
+    CHECK(columns.count(GameFilter()) == 300);
+    GameFilter three;
+    three.players = 3;
+    CHECK(columns.count(three) == 75);
+    
+    // Truncated archives are rejected
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    CHECK_THROWS_AS(ArchiveReader{path}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Archive block index") {
+    std::string path = (std::filesystem::temp_directory_path() / "coup_archive_index_test.cga").string();
+    GameRules rules = GameRules::defaults();
+    std::mt19937_64 rng(8);
+    // One table configuration at a time, so every block holds a single configuration
+    std::vector<std::vector<RoleType>> tables = {{RoleType::GOVERNOR, RoleType::SPY},
+                                                 {RoleType::GENERAL, RoleType::JUDGE, RoleType::BARON},
+                                                 {RoleType::MERCHANT, RoleType::SPY}};
+    int limits[] = {30, 400, 400};
+    {
+        ArchiveWriter writer(path, rules, 32);
+        for (size_t t = 0; t < tables.size(); ++t) {
+            for (int g = 0; g < 64; ++g) {
+                writer.add(play_archived_game(rules, tables[t], rng, limits[t]));
+            }
+        }
+    }
+    
+    ArchiveReader reader(path);
+    REQUIRE(reader.block_count() == 6);
+    BlockSummary first = reader.summary(0);
+    CHECK(((first.present >> static_cast<int>(RoleType::GOVERNOR)) & 1) == 1);
+    CHECK(((first.present >> static_cast<int>(RoleType::GENERAL)) & 1) == 0);
+    CHECK(first.max_turns <= 30);
+    CHECK(first.min_coins <= first.max_coins);
+    
+    GameColumns all;
+    CHECK(reader.load_columns(all) == 6);
+    
+    GameFilter general;
+    general.with_role = static_cast<int8_t>(RoleType::GENERAL);
+    GameFilter long_games;
+    long_games.min_turns = 31;
+    GameFilter rich;
+    rich.min_final_coins = static_cast<int16_t>(first.max_coins + 1);
+    GameFilter sanctioned;
+    sanctioned.action = static_cast<int8_t>(ActionType::SANCTION);
+    sanctioned.min_action_count = 1;
+    size_t expected_blocks[] = {2, 4};
+    int index = 0;
+    for (const GameFilter& filter : {general, long_games, rich, sanctioned}) {
+        GameColumns pruned;
+        size_t loaded = reader.load_columns(pruned, filter);
+        if (index < 2) {
+            CHECK(loaded == expected_blocks[index]);
+        }
+        CHECK(loaded <= 6);
+        CHECK(pruned.count(filter) == all.count(filter));
+        CHECK(pruned.mean_turns(filter) == doctest::Approx(all.mean_turns(filter)));
+        CHECK(pruned.role_stats(RoleType::SPY, filter).wins == all.role_stats(RoleType::SPY, filter).wins);
+        index++;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Archive revalidation") {
+    GameRules rules = GameRules::defaults();
+    std::mt19937_64 rng(12);
+    std::vector<RoleType> roles = {RoleType::BARON, RoleType::GOVERNOR, RoleType::MERCHANT};
+    Divergence divergence;
+    for (int g = 0; g < 20; ++g) {
+        ArchivedGame game = play_archived_game(rules, roles, rng, 300);
+        CHECK(revalidate_game(rules, game, divergence));
+    }
+
+    ArchivedGame game = play_archived_game(rules, roles, rng, 300);
+    REQUIRE(game.replay.size() > 2);
+    ArchivedGame coins = game;
+    coins.final_coins[1]++;
+    CHECK_FALSE(revalidate_game(rules, coins, divergence));
+    CHECK(divergence.turn == static_cast<int>(game.replay.size()));
+    CHECK(divergence.reason.find("final coins") != std::string::npos);
+
+    // The first player always has a legal move, so a recorded skip there diverges
+    ArchivedGame skipped = game;
+    skipped.replay[0] = RecordedTurn{-1, -1, -1};
+    CHECK_FALSE(revalidate_game(rules, skipped, divergence));
+    CHECK(divergence.turn == 0);
+
+    ArchivedGame illegal = game;
+    illegal.replay[1] = RecordedTurn{static_cast<int8_t>(MoveType::COUP), 5, -1};
+    CHECK_FALSE(revalidate_game(rules, illegal, divergence));
+    CHECK(divergence.turn == 1);
+    
+    // Moves are checked against the legal ones before they are played, including moves that
+    // would play without an error: an investment the Baron cannot afford, an arrest of
+    // oneself, an unknown move type
+    for (RecordedTurn turn : {RecordedTurn{static_cast<int8_t>(MoveType::INVEST), -1, -1},
+                              RecordedTurn{static_cast<int8_t>(MoveType::ARREST), 0, -1}, RecordedTurn{9, -1, -1}}) {
+        illegal = game;
+        illegal.replay[0] = turn;
+        CHECK_FALSE(revalidate_game(rules, illegal, divergence));
+        CHECK(divergence.turn == 0);
+        CHECK(divergence.reason == "Recorded move is not legal");
+    }
+
+    // With a costlier coup some recorded coups are no longer affordable
+    GameRules costly = rules;
+    costly.coup_cost = 9;
+    bool same = true;
+    for (int g = 0; g < 20 && same; ++g) {
+        same = revalidate_game(costly, play_archived_game(rules, roles, rng, 300), divergence);
+    }
+    CHECK_FALSE(same);
+}
+
+TEST_CASE("State checksum") {
+    auto make_game = []() {
+        auto game = std::make_unique<Game>();
+        game->add_player(std::make_shared<Player>("A"));
+        game->add_player(std::make_shared<Player>("B"));
+        game->get_player_at(0)->set_role(make_role(RoleType::MERCHANT));
+        game->get_player_at(1)->set_role(make_role(RoleType::BARON));
+        game->start_game();
+        return game;
+    };
+    auto left = make_game();
+    auto right = make_game();
+    CHECK(left->get_state_checksum() == state_checksum(left->capture_state()));
+
+    // Lockstep copies agree after every action and turn advance
+    std::mt19937_64 rng(3);
+    for (int turn = 0; turn < 10 && left->is_game_active(); ++turn) {
+        std::vector<Move> moves = legal_moves(*left);
+        Move move = moves[rng() % moves.size()];
+        apply_move(*left, move);
+        apply_move(*right, move);
+        CHECK(left->get_state_checksum() == right->get_state_checksum());
+        CHECK(left->get_state_checksum() == state_checksum(left->capture_state()));
+    }
+
+    // Every role's moves keep the incremental checksum exact, investments included
+    int invests = 0;
+    for (int round = 0; round < 6; ++round) {
+        Game game;
+        for (int seat = 0; seat < 4; ++seat) {
+            auto player = std::make_shared<Player>("P" + std::to_string(seat), 4);
+            player->set_role(make_role(seat == 0 ? RoleType::BARON : static_cast<RoleType>((round + seat) % 6)));
+            game.add_player(player);
+        }
+        game.start_game();
+        for (int turn = 0; turn < 300 && game.is_game_active(); ++turn) {
+            std::vector<Move> moves = legal_moves(game);
+            if (moves.empty()) {
+                game.next_turn();
+            } else {
+                Move move = moves[rng() % moves.size()];
+                invests += move.type == MoveType::INVEST;
+                apply_move(game, move);
+            }
+            CHECK(game.get_state_checksum() == state_checksum(game.capture_state()));
+        }
+    }
+    CHECK(invests > 0);
+
+    // A bonus applied on one side only is caught on the turn it happens
+    Player* merchant = right->get_player_at(0);
+    merchant->add_coins(1);
+    apply_move(*left, Move(MoveType::GATHER));
+    apply_move(*right, Move(MoveType::GATHER));
+    CHECK(left->get_state_checksum() != right->get_state_checksum());
+
+    // Archived games carry the checksum of every turn
+    GameRules rules = GameRules::defaults();
+    std::vector<RoleType> roles = {RoleType::MERCHANT, RoleType::SPY, RoleType::JUDGE};
+    ArchivedGame game = play_archived_game(rules, roles, rng, 200);
+    REQUIRE(game.checksums.size() == game.replay.size());
+    REQUIRE(game.replay.size() > 5);
+    Divergence divergence;
+    CHECK(revalidate_game(rules, game, divergence));
+    game.checksums[4] ^= 1;
+    CHECK_FALSE(revalidate_game(rules, game, divergence));
+    CHECK(divergence.turn == 4);
+    CHECK(divergence.reason == "State checksum differs");
+
+    // Host events and spectator frames carry it too
+    GameHost host;
+    uint64_t hosted = host.create_game({RoleType::GOVERNOR, RoleType::SPY});
+    uint64_t reported = 0;
+    host.set_listener([&reported](const HostEvent& event) { reported = event.checksum; });
+    host.submit_move(hosted, 0, Move(MoveType::GATHER));
+    // A move is reported before the turn advances, as a client sees it after playing it
+    Game mirror;
+    mirror.add_player(std::make_shared<Player>("A"));
+    mirror.add_player(std::make_shared<Player>("B"));
+    mirror.get_player_at(0)->set_role(make_role(RoleType::GOVERNOR));
+    mirror.get_player_at(1)->set_role(make_role(RoleType::SPY));
+    mirror.start_game();
+    apply_move(mirror, Move(MoveType::GATHER));
+    play_action(mirror, Move(MoveType::GATHER));
+    host.submit_move(hosted, 1, Move(MoveType::GATHER));
+    CHECK(reported == mirror.get_state_checksum());
+
+    GameState base = left->capture_state();
+    apply_move(*left, Move(MoveType::GATHER));
+    std::vector<uint8_t> frame;
+    encode_state_frame(&base, left->capture_state(), 1, frame);
+    GameState stale = right->capture_state();
+    CHECK_THROWS_AS(apply_state_frame(stale, frame.data(), frame.size()), std::runtime_error);
+    CHECK(hash_state(stale) == hash_state(right->capture_state()));
+}
+
+TEST_CASE("Player statistics") {
+    Game game;
+    game.add_player(std::make_shared<Player>("A"));
+    game.add_player(std::make_shared<Player>("B"));
+    game.add_player(std::make_shared<Player>("C"));
+    game.get_player_at(0)->set_role(make_role(RoleType::SPY));
+    game.get_player_at(1)->set_role(make_role(RoleType::GOVERNOR));
+    game.get_player_at(2)->set_role(make_role(RoleType::SPY));
+    game.start_game();
+
+    auto always = [](Player&, const ActionRecord&) { return true; };
+    apply_move(game, Move(MoveType::TAX), always);  // A taxes, the Governor blocks
+    apply_move(game, Move(MoveType::TAX));          // B: 5 coins
+    apply_move(game, Move(MoveType::GATHER));       // C: 3 coins
+    apply_move(game, Move(MoveType::ARREST, 1));    // A arrests the leader
+    apply_move(game, Move(MoveType::GATHER));
+    apply_move(game, Move(MoveType::GATHER));
+    apply_move(game, Move(MoveType::ARREST, 2));    // A arrests C, who trails B
+
+    const PlayerStats& a = game.get_player_stats(0);
+    CHECK(a.actions == 3);
+    CHECK(a.counts[static_cast<int>(ActionType::ARREST)] == 2);
+    CHECK(a.rate(ActionType::TAX) == doctest::Approx(1.0 / 3));
+    CHECK(a.targeted == 2);
+    CHECK(a.targets[1] == 1);
+    CHECK(a.target_rate(2) == doctest::Approx(0.5));
+    CHECK(a.leader_targeted == 1);
+    CHECK(a.blocked == 1);
+    CHECK(game.get_player_stats(1).blocks == 1);
+
+    // The recent window forgets the oldest actions once full
+    for (int i = 0; i < 3 * PlayerStats::WINDOW; ++i) {
+        game.get_player_at(game.get_current_player_index())->set_coins(0);
+        apply_move(game, Move(MoveType::GATHER));
+    }
+    const PlayerStats& stats = game.get_player_stats(0);
+    CHECK(stats.recent_actions() == PlayerStats::WINDOW);
+    CHECK(stats.counts[static_cast<int>(ActionType::GATHER)] > 0);
+    CHECK(stats.recent_rate(ActionType::GATHER) == doctest::Approx(1.0));
+    CHECK(stats.rate(ActionType::GATHER) < 1.0);
+    CHECK(stats.is_valid());
+
+    // Statistics survive a save and load, and are reset with the history
+    std::vector<uint8_t> saved;
+    game.save(saved);
+    Game copy;
+    copy.load(saved.data(), saved.size());
+    CHECK(copy.get_player_stats(0).recent == stats.recent);
+    CHECK(copy.get_player_stats(2).actions == game.get_player_stats(2).actions);
+    copy.clear_action_history();
+    CHECK(copy.get_player_stats(0).actions == 0);
+
+    // The leader is judged on the coins before the action moves any
+    Game table;
+    for (RoleType role : {RoleType::SPY, RoleType::GOVERNOR, RoleType::BARON}) {
+        table.add_player(std::make_shared<Player>("P"));
+        table.get_player_at(table.get_player_count() - 1)->set_role(make_role(role));
+    }
+    table.start_game();
+    table.get_player_at(0)->set_coins(6);
+    table.get_player_at(1)->set_coins(4);
+    table.get_player_at(2)->set_coins(4);
+    table.get_player_at(0)->arrest(*table.get_player_at(1), table);   // Tied leader, then 3 vs 4
+    CHECK(table.get_player_stats(0).leader_targeted == 1);
+    table.get_player_at(2)->set_coins(3);
+    table.get_player_at(1)->set_coins(4);
+    table.get_player_at(0)->sanction(*table.get_player_at(2), table); // Trailing Baron, then 4 vs 4
+    CHECK(table.get_player_stats(0).leader_targeted == 1);
+    CHECK(table.get_player_stats(0).targeted == 2);
+}
+
+TEST_CASE("Value network") {
+    Game game;
+    for (const char* name : {"A", "B", "C"}) {
+        game.add_player(std::make_shared<Player>(name));
+    }
+    game.get_player_at(0)->set_role(make_role(RoleType::BARON));
+    game.get_player_at(1)->set_role(make_role(RoleType::JUDGE));
+    game.get_player_at(2)->set_role(make_role(RoleType::SPY));
+    game.start_game();
+    apply_move(game, Move(MoveType::ARREST, 2));
+    game.get_player_at(1)->set_coins(200);
+
+    // Seat 1's view: itself first, then seats 2 and 0; the table follows the seat slots
+    int8_t features[FEATURE_COUNT];
+    encode_features(game.capture_state(), 1, features);
+    CHECK(features[0] == 1);
+    CHECK(features[1] == 127);
+    CHECK(features[3] == 1);
+    CHECK(features[4 + static_cast<int>(RoleType::JUDGE)] == 1);
+    CHECK(features[SEAT_FEATURES + 4 + static_cast<int>(RoleType::SPY)] == 1);
+    CHECK(features[2 * SEAT_FEATURES + 1] == 3);         // Seat 0 took a coin with its arrest
+    CHECK(features[3 * SEAT_FEATURES] == 0);
+    CHECK(features[MAX_PLAYERS * SEAT_FEATURES + 2] == 3);
+    encode_features(game.capture_state(), 0, features);
+    CHECK(features[MAX_PLAYERS * SEAT_FEATURES + 3] == 3); // Seat 0 last arrested slot 2
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> uniform(-0.2f, 0.2f);
+    std::vector<DenseLayer> layers;
+    size_t sizes[] = {FEATURE_COUNT, 40, 24, 1};
+    for (int l = 0; l < 3; ++l) {
+        DenseLayer layer{sizes[l], sizes[l + 1], std::vector<float>(sizes[l] * sizes[l + 1]),
+                         std::vector<float>(sizes[l + 1])};
+        for (float& weight : layer.weights) weight = uniform(rng);
+        for (float& bias : layer.biases) bias = uniform(rng);
+        layers.push_back(layer);
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "coup_value_net_test.cvn").string();
+    write_value_net(path, layers);
+    ValueNet net(path);
+    CHECK(net.get_simd() == detect_simd());
+
+    // Plain reference forward pass
+    const size_t COUNT = 7;
+    std::vector<int8_t> batch(COUNT * FEATURE_COUNT);
+    for (int8_t& feature : batch) feature = static_cast<int8_t>(rng() % 12);
+    std::vector<float> expected;
+    for (size_t p = 0; p < COUNT; ++p) {
+        std::vector<double> activation(batch.begin() + p * FEATURE_COUNT, batch.begin() + (p + 1) * FEATURE_COUNT);
+        for (size_t l = 0; l < layers.size(); ++l) {
+            std::vector<double> next(layers[l].outputs);
+            for (size_t o = 0; o < next.size(); ++o) {
+                next[o] = layers[l].biases[o];
+                for (size_t i = 0; i < layers[l].inputs; ++i) {
+                    next[o] += layers[l].weights[o * layers[l].inputs + i] * activation[i];
+                }
+                if (l + 1 < layers.size()) next[o] = std::max(next[o], 0.0);
+            }
+            activation.swap(next);
+        }
+        expected.push_back(static_cast<float>(1.0 / (1.0 + std::exp(-activation[0]))));
+    }
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (static_cast<int>(level) > static_cast<int>(detect_simd())) {
+            CHECK_THROWS_AS(net.set_simd(level), std::invalid_argument);
+            continue;
+        }
+        net.set_simd(level);
+        std::vector<float> values(COUNT);
+        net.evaluate(batch.data(), COUNT, values.data());
+        for (size_t p = 0; p < COUNT; ++p) {
+            CHECK(values[p] == doctest::Approx(expected[p]).epsilon(1e-5));
+        }
+    }
+    encode_features(game.capture_state(), 2, features);
+    float single;
+    net.evaluate(features, 1, &single);
+    CHECK(net.evaluate(game, 2) == single);
+
+    // Malformed weights are rejected
+    layers[1].inputs = 39;
+    CHECK_THROWS_AS(ValueNet{layers}, std::invalid_argument);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 2);
+    CHECK_THROWS_AS(read_value_net(path), std::runtime_error);
+    std::filesystem::remove(path);
+}